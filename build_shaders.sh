@@ -8,3 +8,11 @@ echo "finished compiling shader.vert"
 
 glslc engine/shader/shader.frag -o engine/shader/shader.frag.spv
 echo "finished compiling shader.frag"
+
+
+glslc engine/shader/shader_bindless.frag -o engine/shader/shader_bindless.frag.spv
+echo "finished compiling shader_bindless.frag"
+
+
+glslc engine/shader/cull.comp -o engine/shader/cull.comp.spv
+echo "finished compiling cull.comp"
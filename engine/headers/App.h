@@ -13,13 +13,30 @@
 #include <functional>
 #include <cstdlib>
 #include <fstream>
+#include <chrono>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
 #include <glm/glm.hpp>
 
-
-const int MAX_FRAME_IN_FLIGHT = 2;
+#include "Config.h"
+#include "MemoryAllocator.h"
+#include "UploadQueue.h"
+#include "PipelineCache.h"
+#include "Benchmark.h"
+#include "GpuProfiler.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "VertexLayout.h"
+#include "UniformRing.h"
+#include "BindlessTextures.h"
+#include "AssetArchive.h"
+#include "TextureFile.h"
+#include "TextureLoader.h"
+#include "TransformStore.h"
+#include "FramePacer.h"
+#include "GpuTimeline.h"
+#include "DeletionQueue.h"
 
 VkResult CreateDebugUtilsMessengerEXT(
         VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreteInfo,
@@ -32,9 +49,13 @@ void DestroyDebugUtilsMessengerEXT(
 );
 
 struct QueueFamilyIndices {
-    uint32_t graphicalFamily = -1;
-    uint32_t presentFamily = -1;
-    bool is_complete() { return graphicalFamily >= 0 && presentFamily >= 0; }
+    uint32_t graphicalFamily = UINT32_MAX;
+    uint32_t presentFamily = UINT32_MAX;
+    // a transfer-only family when the device has one, the graphics family otherwise
+    uint32_t transferFamily = UINT32_MAX;
+    // the graphics family when it can dispatch compute work, any compute family otherwise
+    uint32_t computeFamily = UINT32_MAX;
+    bool is_complete() { return graphicalFamily != UINT32_MAX && presentFamily != UINT32_MAX; }
 };
 
 struct SwapChainSupportDetails {
@@ -43,29 +64,124 @@ struct SwapChainSupportDetails {
     std::vector<VkPresentModeKHR> presentMode;
 };
 
-struct Vertex {
-    glm::vec3 pos;
-    glm::vec3  color;
-    glm::vec2 texCoord;
+// per-object transform, streamed through vertex binding 1 at instance rate. Also the std430
+// element the culling shader reads and compacts, hence the padding
+struct InstanceData {
+    glm::mat4 model;
+    // index into sceneObjects, picks the material once culling reordered the instances
+    uint32_t object;
+    uint32_t padding[3];
 
     static VkVertexInputBindingDescription getBindingDescription();
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
+    static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptions();
+};
+
+// how an object starts out and spins, create_scene loads it into the TransformStore that animates it
+struct SceneObject {
+    glm::vec3 position;
+    glm::vec3 axis;
+    // degrees per second
+    float speed;
+    float phase;
 };
 
-struct UniformBufferObject {
+// written into the uniform ring every frame
+struct CameraUniform {
+    // proj * view, combined once on the CPU instead of per vertex
+    glm::mat4 viewProj;
+    // undoes the position quantization of the vertex layout
+    glm::vec4 positionScale;
+    glm::vec4 positionBias;
+    // world space planes (xyz normal pointing inwards, w distance) for GPU culling
+    glm::vec4 frustumPlanes[6];
+};
+
+// per-draw transforms of the push and uniform paths, 128 bytes is the guaranteed push constant minimum
+struct ObjectTransforms {
+    glm::mat4 mvp;
+    // rotates the normals
     glm::mat4 model;
-    glm::mat4 view;
-    glm::mat4 proj;
+};
+
+// push constants of cull.comp
+struct CullParameters {
+    uint32_t instanceCount;
+    uint32_t batchSize;
+    uint32_t batchCount;
+    uint32_t indexCount;
+};
+
+// std430 element of the material storage buffer (binding 3)
+struct MaterialData {
+    glm::vec4 baseColor;
+    // slot in the bindless texture array, unused when the texture is bound per frame slot
+    uint32_t textureSlot;
+    uint32_t padding[3];
+};
+
+// command pool owned by one recording thread for one frame slot, reset as a whole every frame
+struct RecordPool {
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    // secondary command buffers, allocated on first use and recycled by the pool reset
+    std::vector<VkCommandBuffer> commandBuffers;
+    uint32_t used = 0;
+};
+
+// everything a single frame needs while it is being recorded or is still executing on the GPU,
+// indexed by frame slot (not by swapchain image)
+struct FrameContext {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    // one per recording thread, empty when recording inline
+    std::vector<RecordPool> recordPools;
+    // secondary command buffer of every recording job, executed in draw order
+    std::vector<VkCommandBuffer> secondaryCommandBuffers;
+
+    VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+    VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
+    // timeline value of the slot's last submission, the slot is idle once the GPU reached it
+    uint64_t timelineValue = 0;
+
+    // dynamic offsets into the uniform ring: the camera, the first object of the uniform path
+    uint32_t cameraOffset = 0;
+    uint32_t objectOffset = 0;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    // texture binding 1 points at, rewritten once the slot is idle when the real texture arrives
+    VkImageView boundTextureView = VK_NULL_HANDLE;
+
+    // host visible, rewritten every frame the slot is used
+    VkBuffer instanceBuffer = VK_NULL_HANDLE;
+    Allocation instanceBufferAllocation;
+    InstanceData* instanceBufferMapped = nullptr;
+
+    // GPU culling: visible instances compacted per batch, the indirect draws and their counters
+    VkBuffer visibleInstanceBuffer = VK_NULL_HANDLE;
+    Allocation visibleInstanceBufferAllocation;
+    VkBuffer indirectBuffer = VK_NULL_HANDLE;
+    Allocation indirectBufferAllocation;
+    VkBuffer cullCountBuffer = VK_NULL_HANDLE;
+    Allocation cullCountBufferAllocation;
+    VkDescriptorSet cullDescriptorSet = VK_NULL_HANDLE;
+
+    // host visible copy of the materials, rewritten once the slot is idle after they changed
+    VkBuffer materialBuffer = VK_NULL_HANDLE;
+    Allocation materialBufferAllocation;
+    MaterialData* materialBufferMapped = nullptr;
+    uint64_t materialsVersion = 0;
+
+    // benchmark sample the frame is recorded into, -1 outside of the measured frames
+    int64_t benchmarkSample = -1;
 };
 
 class App {
+    AppConfig config;
+
     void init_window();
     void init_vulkan();
     void main_loop();
     void cleanup();
 
     // VULKAN INSTANCE
-    GLFWwindow* window;
+    GLFWwindow* window = nullptr;
     VkInstance instance;
 
     const std::vector<const char*> validationLayers = {
@@ -78,27 +194,34 @@ class App {
     VkDevice device;
     VkQueue graphicsQueue;
     VkQueue presentQueue;
-    const std::vector<const char*> deviceExtensions = {
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
+    VkQueue transferQueue;
+    // filled by the constructor, headless runs need no device extension
+    std::vector<const char*> deviceExtensions;
     bool is_device_suitable(VkPhysicalDevice device);
     bool check_device_extension_support(VkPhysicalDevice device);
+    // optional extensions, enabled in create_logical_device when present
+    bool has_device_extension(VkPhysicalDevice device, const char* name);
 
     void pickPhysicalDevice();
     uint32_t rate_device_suitability(VkPhysicalDevice device);
     void create_logical_device();
 
+    // device memory
+    MemoryAllocator allocator;
+    UploadQueue uploadQueue;
+    void create_upload_queue();
+
     void print_instance_device(std::vector<VkPhysicalDevice> devices);
     // Queue Families
     QueueFamilyIndices find_queue_families(VkPhysicalDevice device);
     void print_device_queue_family(std::vector<VkQueueFamilyProperties> properties);
 
     // Surface
-    VkSurfaceKHR surfaceKhr;
+    VkSurfaceKHR surfaceKhr = VK_NULL_HANDLE;
     void crete_surface();
 
     // debug / validations
-    VkDebugUtilsMessengerEXT callbacks;
+    VkDebugUtilsMessengerEXT callbacks = VK_NULL_HANDLE;
     void print_instance_extensions();
     bool check_validation_layers_support();
 
@@ -107,11 +230,20 @@ class App {
     std::vector<VkImage> swapchainImages;
     SwapChainSupportDetails query_swapchain_support(VkPhysicalDevice device);
     VkSurfaceFormatKHR choose_swapchain_format(const std::vector<VkSurfaceFormatKHR>& availableFormats);
+    // config.presentMode when the surface supports it, fifo otherwise
     VkPresentModeKHR choose_present_mode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
     VkExtent2D choose_swapchain_extent(const VkSurfaceCapabilitiesKHR& capabilitiesKhr);
-    void create_swapchain();
+    // oldSwapchain is retired by the new one, its images may be recycled into it
+    void create_swapchain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
     void setup_debug_callback();
 
+    // headless: offscreen color targets stand in for the swapchain images, one per frame slot
+    std::vector<Allocation> offscreenImageAllocations;
+    void create_offscreen_targets();
+    VkImageLayout color_final_layout() const;
+    void save_frame(const std::string& path, uint32_t imageIndex);
+
     // Image View
     std::vector<VkImageView> swapchainImageViews;
     VkFormat swapchainImageFormat;
@@ -120,11 +252,17 @@ class App {
 
 
     // pipeline
+    PipelineCache pipelineCache;
+    double pipelineCreationMs = 0.0;
     VkPipelineLayout pipelineLayout;
-    VkRenderPass renderPass;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
     VkPipeline graphicsPipeline;
     void create_graphics_pipeline();
     void create_render_pass();
+    // Vulkan 1.3 dynamic rendering: no render pass or framebuffers, the attachment layouts are
+    // changed by synchronization2 barriers around vkCmdBeginRendering/vkCmdEndRendering
+    bool dynamicRendering = false;
+    void record_attachment_barriers(VkCommandBuffer commandBuffer, uint32_t imageIndex, bool beforeRendering);
 
     // buffers
     std::vector<VkFramebuffer> swapchainFrameBuffers;
@@ -134,85 +272,203 @@ class App {
     VkCommandPool commandPool;
     void create_command_pool();
 
+    // frame ring
+    std::vector<FrameContext> frames;
+    uint32_t currentFrame = 0;
+    // timeline value of the frame that last rendered into each swapchain image
+    std::vector<uint64_t> imagesInFlight;
+
     // command buffer
-    std::vector<VkCommandBuffer> commandBuffer;
     void create_command_buffer();
-    void record_command_buffer(VkCommandBuffer vkCommandBuffer, uint32_t imageIndex);
+    void record_command_buffer(FrameContext& frame, uint32_t imageIndex);
+    // binds everything the draws need and records draws [firstDraw, firstDraw + drawCount)
+    void record_draws(VkCommandBuffer commandBuffer, const FrameContext& frame, uint32_t firstDraw, uint32_t drawCount);
+    uint32_t draw_count() const;
+    // instanced path: draws the instances are split into, and instances per draw
+    uint32_t batch_count() const;
+    uint32_t batch_size() const;
+
+    // multithreaded recording
+    JobSystem jobs;
+    bool inheritedQueries = false;
+    bool uses_secondaries() const { return config.recordThreads > 0; }
+    void create_record_pools();
+    void destroy_record_pools();
+    void record_secondaries(FrameContext& frame, uint32_t imageIndex);
 
     // shaders
     static std::vector<char> readFile(const std::string& filename);
-    VkShaderModule create_shader_module(const std::vector<char>& code);
-
-    // sync objects
-    std::vector<VkSemaphore> imageAvailableSemaphore;
-    std::vector<VkSemaphore> renderFinishedSemaphore;
-    std::vector<VkFence> inFlightFence;
+    VkShaderModule create_shader_module(const void* code, size_t size);
+    // from the asset archive when one is open, otherwise from the shader directory
+    VkShaderModule load_shader_module(const std::string& name);
+
+    // assets
+    AssetArchive assets;
+
+    // sync objects: binary semaphores for acquire and present, everything else waits on the timeline
+    GpuTimeline timeline;
+    bool timelineSemaphores = false;
+    // objects replaced at runtime, destroyed once the timeline passed their last use
+    DeletionQueue deletionQueue;
     void create_sync_objects();
 
     //drawing
     void drawFrame();
+    bool should_stop(uint64_t frameCount, double elapsedSeconds);
+
+    // benchmark
+    Benchmark benchmark;
+    void finish_benchmark();
+
+    // gpu profiling
+    GpuProfiler profiler;
+    bool pipelineStatisticsQuery = false;
+    void create_profiler();
+    // hands the results of the frame slot that just completed to the benchmark
+    void collect_gpu_results(uint32_t slot);
 
     // recreate swapchain
     void cleanup_swapchain();
-    void recreate_swapchain();
+    // sample is the benchmark sample the recreation time is recorded into
+    void recreate_swapchain(int64_t sample);
+
+    // GPU culling: a compute pass tests every instance against the frustum and writes the
+    // surviving ones and their draw commands, consumed by vkCmdDrawIndexed*Indirect*
+    bool gpuCulling = false;
+    // compacted draw list with the draw count in a buffer, otherwise one command per batch
+    bool drawIndirectCount = false;
+    bool multiDrawIndirect = false;
+    // commands a single indirect draw may consume, 1 without multiDrawIndirect
+    uint32_t maxDrawIndirectCount = 1;
+    // object space bounding sphere of every instance (center, radius)
+    VkBuffer boundsBuffer = VK_NULL_HANDLE;
+    Allocation boundsBufferAllocation;
+    VkDescriptorSetLayout cullSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool cullDescriptorPool = VK_NULL_HANDLE;
+    VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+    // cull.comp specialized for its two passes: per instance, then per batch
+    VkPipeline cullPipeline = VK_NULL_HANDLE;
+    VkPipeline cullCompactPipeline = VK_NULL_HANDLE;
+    void create_culling_resources();
+    void create_compute_pipeline();
+    void record_culling(VkCommandBuffer commandBuffer, const FrameContext& frame);
 
     // vertex buffer
     VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
+    Allocation vertexBufferAllocation;
     VkBuffer indexBuffer;
-    VkDeviceMemory indexBufferMemory;
+    Allocation indexBufferAllocation;
     VkMemoryRequirements memoryRequirements;
 
-    const std::vector<Vertex> vertices = {
-            {{-0.5f, -0.5f, .5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-            {{0.5f, -0.5f, .5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-            {{0.5f, 0.5f, .5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-            {{-0.5f, 0.5f, .5f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}},
-
-            {{-0.5f, -0.5f, -.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-            {{0.5f, -0.5f, -.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-            {{0.5f, 0.5f, -.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-            {{-0.5f, 0.5f, -.5f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}},
-    };
-    const std::vector<uint16_t> indices = {
-            0, 1, 2, 2, 3, 0,
-            4, 5, 6, 6, 7, 4
-    };
-
-    void create_buffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkBuffer& buffer, VkDeviceMemory& deviceMemory);
-    void copy_buffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+    // geometry every instance draws, vertices and indices live on the GPU only
+    VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+    uint32_t indexCount = 0;
+    // imported (or the built-in quads), deduplicated and optimized, freed once uploaded
+    Mesh mesh;
+    VertexCacheStats meshCacheStats;
+    // object space bounding sphere of the mesh (center, radius), what culling tests
+    glm::vec4 meshBounds = glm::vec4(0.0f);
+    void create_mesh();
+
+    // how the vertex buffer stores Vertex, resolved against the mesh and the device in create_mesh
+    VertexLayout vertexLayout;
+    PositionDequantization positionDequantization;
+    VertexLayout resolve_vertex_layout(VertexLayout layout);
+
+    void create_buffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkBuffer& buffer, Allocation& allocation);
     void create_vertex_buffer();
     void create_indices_buffer();
+
+    // scene: one object per instance, all drawn by a single vkCmdDrawIndexed
+    std::vector<SceneObject> sceneObjects;
+    // radius of the sphere around the origin that holds every object
+    float sceneRadius = 0.0f;
+    void create_scene();
+    void create_instance_buffer();
+    void update_instance_buffer(FrameContext& frame);
+    // SoA state of every object, integrated and composed into the frame's buffers
+    TransformStore transformStore;
+    JobSystem transformJobs;
+    std::chrono::steady_clock::time_point lastTransformUpdate;
     uint32_t find_memory_type(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
     // uniform buffer
-    std::vector<VkBuffer> uniformBuffers;
-    std::vector<VkDeviceMemory> uniformBufferMemory;
-    std::vector<void*> uniformBufferMapped;
-    std::vector<VkDescriptorSet> descriptorSets;
-
     VkDescriptorSetLayout descriptorSetLayout;
     VkDescriptorPool descriptorPool;
     void create_descriptor_set_layout();
-    void create_uniform_buffer();
+    // per-frame uniforms of every frame slot, bound with dynamic offsets
+    UniformRing uniformRing;
+    void create_uniform_ring();
     void create_descriptor_pool();
     void create_descriptor_set();
-    void update_uniform_buffer(uint32_t currentImage);
-
-    // texture image
-    VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
-    VkImageView textureImageView;
-
-    void create_image(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags propertyFlags, VkImage& image, VkDeviceMemory& imageMemory);
+    void update_uniform_buffer(FrameContext& frame);
+
+    // camera, rebuilt only after something marked it dirty (resize, new scene or mesh)
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 proj = glm::mat4(1.0f);
+    glm::mat4 viewProj = glm::mat4(1.0f);
+    // extracted from viewProj together with it
+    std::array<glm::vec4, 6> frustumPlanes = {};
+    bool cameraDirty = true;
+    void update_camera();
+
+    // push constant path: model matrices of the frame being recorded
+    std::vector<glm::mat4> objectTransforms;
+    // push and uniform paths draw every object on its own
+    bool draws_per_object() const { return config.transformPath != TransformPath::Instanced; }
+
+    // texture image, null until the loader delivered it and its upload was submitted
+    VkImage textureImage = VK_NULL_HANDLE;
+    Allocation textureImageAllocation;
+    VkImageView textureImageView = VK_NULL_HANDLE;
+    uint32_t textureMipLevels = 1;
+    VkFormat textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    // block compression families enabled on the device
+    bool textureCompressionBC = false;
+    bool textureCompressionETC2 = false;
+
+    void create_image(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags propertyFlags, VkImage& image, Allocation& allocation, uint32_t mipLevels = 1);
+    // linear filtering blits are what vkCmdBlitImage needs to build a mip chain on the GPU
+    bool supports_linear_blit(VkFormat format);
+
+    // sampled until the real texture is resident
+    VkImage placeholderImage = VK_NULL_HANDLE;
+    Allocation placeholderImageAllocation;
+    VkImageView placeholderImageView = VK_NULL_HANDLE;
+    void create_placeholder_texture();
+
+    // background decoding
+    TextureLoader textureLoader;
+    double textureRequestMs = 0.0;
+    double textureDecodeMs = 0.0;
+    uint32_t texturesDecoded = 0;
+    void request_textures();
+    // uploads whatever the loader finished, wait blocks until every request is resident
+    void poll_textures(bool wait);
+    VkImageView current_texture_view() const;
+    void update_texture_descriptor(FrameContext& frame);
+
+    // bindless: descriptor indexing is enabled and every texture sits in bindlessTextures
+    bool bindless = false;
+    // MAX_BINDLESS_TEXTURES clamped to the device's update-after-bind limits
+    uint32_t bindlessCapacity = MAX_BINDLESS_TEXTURES;
+    BindlessTextures bindlessTextures;
+    // bindless slot of every requested texture, the placeholder's until it is resident
+    std::vector<uint32_t> textureSlots;
+    // objects use material (object index % count), every material samples texture 0 for now
+    std::vector<MaterialData> materials;
+    std::vector<uint32_t> materialTextures;
+    // bumped whenever materials change, frame slots compare it with their copy
+    uint64_t materialsVersion = 1;
+    void create_materials();
+    void resolve_materials();
+    void update_material_buffer(FrameContext& frame);
 
     void create_texture_image_view();
-    void create_texture_image();
-    VkImageView create_image_views(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
-    VkCommandBuffer begin_single_time_command();
-    void end_single_time_command(VkCommandBuffer vkCommandBuffer);
-    void transition_image_layout(VkImage image, VkFormat format, VkImageLayout odlLayout, VkImageLayout newLayout);
-    void copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+    void upload_decoded_texture(const DecodedTexture& texture);
+    // .mtex written by texture_cooker, uploads the first variant the device can sample
+    void create_cooked_texture_image(const TextureFile& texture);
+    VkImageView create_image_views(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels = 1);
 
     // texture sampler
     VkSampler textureSampler;
@@ -220,8 +476,11 @@ class App {
 
     // depth buffering
     VkImage  depthImage;
-    VkDeviceMemory depthImageMemory;
+    Allocation depthImageAllocation;
     VkImageView depthImageView;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+    // size the depth image was created with, it serves any swapchain extent up to it
+    VkExtent2D depthExtent = {0, 0};
 
     void create_depth_resources();
     VkFormat find_supported_format(const std::vector<VkFormat>& candidates, VkImageTiling imageTiling, VkFormatFeatureFlags featureFlags);
@@ -230,6 +489,21 @@ class App {
 
     // resizes handle
     bool frameBufferResized = false;
+    // the window is minimized, nothing is rendered until it has a size again
+    bool swapchainOutOfDate = false;
+    // when the pending resize was noticed, -1 when none is; the latency ends with the first present after it
+    double resizeStartMs = -1.0;
+    bool resizePresentPending = false;
+
+    // frame pacing: target frame rate and queued frame limit, applied before a frame starts
+    FramePacer pacer;
+    // VK_KHR_present_id + VK_KHR_present_wait, the queue limit then waits for the display instead of the GPU
+    bool presentWait = false;
+    PFN_vkWaitForPresentKHR waitForPresent = nullptr;
+    // id of the last present, ids restart being waitable with the first present of a new swapchain
+    uint64_t presentId = 0;
+    uint64_t swapchainFirstPresentId = 1;
+    void pace_frame();
     static void frameBufferResizeCallback(GLFWwindow* window, int width, int height);
 
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
@@ -240,6 +514,7 @@ class App {
     );
 
 public:
+    explicit App(AppConfig config = {});
 
     void run();
 };
@@ -0,0 +1,74 @@
+#ifndef FAIR_ENGINE_ASSETARCHIVE_H
+#define FAIR_ENGINE_ASSETARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+const char ASSET_ARCHIVE_MAGIC[4] = {'M', 'P', 'A', 'K'};
+const uint32_t ASSET_ARCHIVE_VERSION = 1;
+// payload alignment inside the archive, enough for SPIR-V words and any staging copy
+const uint64_t ASSET_ARCHIVE_ALIGNMENT = 256;
+
+// on disk, all fields little endian:
+//   ArchiveHeader, entryCount * ArchiveEntry, name table, payloads (each ASSET_ARCHIVE_ALIGNMENT aligned)
+struct ArchiveHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t nameTableSize;
+};
+
+struct ArchiveEntry {
+    // into the name table, names are not null terminated
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint64_t offset;
+    uint64_t size;
+    // FNV-1a of the payload
+    uint64_t hash;
+};
+
+struct AssetView {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+uint64_t asset_hash(const uint8_t* data, size_t size);
+
+// Read-only, memory mapped .mpak archive written by asset_packer. Lookups hand out pointers
+// straight into the mapping, payloads are only touched (and paged in) when they are copied
+// into their final destination, e.g. the upload queue's staging ring.
+class AssetArchive {
+    std::string path;
+    const uint8_t* mapping = nullptr;
+    size_t mappingSize = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+    std::unordered_map<std::string, ArchiveEntry> entries;
+
+    void map_file();
+    void unmap_file();
+
+public:
+    AssetArchive() = default;
+    ~AssetArchive();
+    AssetArchive(const AssetArchive&) = delete;
+    AssetArchive& operator=(const AssetArchive&) = delete;
+
+    // throws std::runtime_error when the file is missing or its table of contents is malformed
+    void open(const std::string& path);
+    void close();
+    bool is_open() const { return mapping != nullptr; }
+
+    bool contains(const std::string& name) const { return entries.count(name) != 0; }
+    // throws when the archive has no such entry, or when verify is set and the hash does not match
+    AssetView view(const std::string& name, bool verify = false) const;
+    std::vector<std::string> names() const;
+};
+
+#endif //FAIR_ENGINE_ASSETARCHIVE_H
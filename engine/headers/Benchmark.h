@@ -0,0 +1,88 @@
+#ifndef FAIR_ENGINE_BENCHMARK_H
+#define FAIR_ENGINE_BENCHMARK_H
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// CPU stages of App::drawFrame, in the order they run
+enum class FrameStage {
+    Pace,       // frame rate cap and queued frame limit
+    Wait,       // frame slot timeline value
+    Acquire,
+    Uniform,
+    Record,
+    Submit,
+    Present,
+    Count
+};
+
+const char* frame_stage_name(FrameStage stage);
+
+struct TimingStats {
+    double min = 0.0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+    size_t count = 0;
+
+    static TimingStats from_samples(std::vector<double> samples);
+};
+
+struct FrameSample {
+    // wall time of the whole drawFrame call
+    double frameMs = 0.0;
+    std::array<double, (size_t) FrameStage::Count> stageMs = {};
+    // negative until the GPU result has been read back (or when timestamps are unsupported)
+    double gpuMs = -1.0;
+    // named GPU profiler scopes and counters (pipeline statistics) of the frame
+    std::vector<std::pair<std::string, double>> gpuScopes;
+    // occasional CPU timings that completed in the frame, e.g. swapchain recreation
+    std::vector<std::pair<std::string, double>> events;
+    std::vector<std::pair<std::string, uint64_t>> counters;
+};
+
+// Runs warmupFrames unrecorded frames, then collects measuredFrames samples and
+// reports min/mean/p50/p95/p99/max per metric, to stdout and to a JSON or CSV file.
+class Benchmark {
+    uint32_t warmupFrames = 0;
+    uint32_t measuredFrames = 0;
+    uint64_t frameCount = 0;
+    std::vector<FrameSample> samples;
+    std::vector<std::pair<std::string, std::string>> info;
+
+    double frameStartMs = 0.0;
+
+    void write_json(std::ostream& out) const;
+    void write_csv(std::ostream& out) const;
+
+public:
+    Benchmark() = default;
+    Benchmark(uint32_t warmupFrames, uint32_t measuredFrames);
+
+    bool enabled() const { return measuredFrames > 0; }
+    bool done() const { return enabled() && frameCount >= (uint64_t) warmupFrames + measuredFrames; }
+    uint64_t total_frames() const { return (uint64_t) warmupFrames + measuredFrames; }
+
+    // returns the index of the sample the frame is recorded into, -1 during warmup
+    int64_t begin_frame(double nowMs);
+    void end_frame(int64_t sample, double nowMs);
+    void record_stage(int64_t sample, FrameStage stage, double ms);
+    void set_gpu_time(int64_t sample, double ms);
+    void add_gpu_scope(int64_t sample, const std::string& name, double ms);
+    void add_counter(int64_t sample, const std::string& name, uint64_t value);
+    void add_event(int64_t sample, const std::string& name, double ms);
+
+    void add_info(const std::string& key, const std::string& value);
+
+    void print_summary(std::ostream& out) const;
+    // .csv writes one row per frame, anything else a JSON summary with all samples
+    void write_report(const std::string& path) const;
+};
+
+#endif //FAIR_ENGINE_BENCHMARK_H
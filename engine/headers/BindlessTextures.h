@@ -0,0 +1,39 @@
+#ifndef FAIR_ENGINE_BINDLESSTEXTURES_H
+#define FAIR_ENGINE_BINDLESSTEXTURES_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+
+// slots of the texture array, App clamps it to the update-after-bind limits of the device
+const uint32_t MAX_BINDLESS_TEXTURES = 4096;
+
+// Every sampled texture in one partially bound, update-after-bind array of combined image
+// samplers (set 1, binding 0), indexed by material in the fragment shader. The set is allocated
+// once and bound once per command buffer. Slots are handed out in order and never reused, a new
+// slot may be written while frames that never index it are still executing.
+class BindlessTextures {
+    VkDevice device = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    uint32_t capacity = 0;
+    uint32_t count = 0;
+
+public:
+    void init(VkDevice device, VkSampler sampler, uint32_t capacity = MAX_BINDLESS_TEXTURES);
+    void destroy();
+
+    // writes view (in SHADER_READ_ONLY_OPTIMAL) into the next slot and returns its index.
+    // Throws std::runtime_error once every slot is taken
+    uint32_t add(VkImageView view);
+
+    VkDescriptorSetLayout get_layout() const { return layout; }
+    VkDescriptorSet get_set() const { return set; }
+    uint32_t size() const { return count; }
+};
+
+#endif //FAIR_ENGINE_BINDLESSTEXTURES_H
@@ -0,0 +1,18 @@
+#ifndef FAIR_ENGINE_BLOCKCOMPRESSION_H
+#define FAIR_ENGINE_BLOCKCOMPRESSION_H
+
+#include <cstdint>
+#include <vector>
+
+// 4x4 block encoders used by the texture cooker. Input is tightly packed RGBA8, values are
+// encoded as they are (sRGB data stays sRGB). Partial blocks at the right and bottom edge
+// repeat the last row / column.
+
+// BC1 (DXT1) opaque four color mode, 8 bytes per block
+std::vector<uint8_t> encode_bc1(const uint8_t* rgba, uint32_t width, uint32_t height);
+// BC7 mode 6 (one subset, RGBA 7.7.7.7 endpoints with p-bits, 4 bit indices), 16 bytes per block
+std::vector<uint8_t> encode_bc7(const uint8_t* rgba, uint32_t width, uint32_t height);
+// ETC2 RGB8 using the ETC1 compatible individual / differential modes, 8 bytes per block
+std::vector<uint8_t> encode_etc2_rgb(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+#endif //FAIR_ENGINE_BLOCKCOMPRESSION_H
@@ -0,0 +1,121 @@
+#ifndef FAIR_ENGINE_CONFIG_H
+#define FAIR_ENGINE_CONFIG_H
+
+#include <cstdint>
+#include <string>
+
+const uint32_t MIN_FRAME_IN_FLIGHT = 1;
+const uint32_t MAX_FRAME_IN_FLIGHT = 4;
+const uint32_t MAX_INSTANCES = 1000000;
+const uint32_t MAX_RECORD_THREADS = 64;
+const uint32_t MAX_TRANSFORM_THREADS = 64;
+const uint32_t MAX_DECODE_THREADS = 64;
+const uint32_t MAX_MATERIALS = 65536;
+const uint32_t MAX_QUEUED_FRAMES = 16;
+
+enum class TransformPath {
+    // model matrices in a per-instance vertex buffer, one instanced draw
+    Instanced,
+    // one draw per object, MVP in push constants
+    Push,
+    // one draw per object, MVP in the uniform ring bound with a dynamic offset
+    Uniform
+};
+
+enum class RenderPath {
+    // VkRenderPass with one VkFramebuffer per swapchain image
+    RenderPass,
+    // vkCmdBeginRendering on the image views, synchronization2 barriers for the layouts
+    Dynamic
+};
+
+enum class PresentMode {
+    // mailbox when the surface supports it, fifo otherwise
+    Auto,
+    // vsync, the only mode every surface supports
+    Fifo,
+    // vsync, but a late frame is shown right away instead of waiting a whole refresh
+    FifoRelaxed,
+    // latest frame replaces the queued one, no tearing
+    Mailbox,
+    // no vsync, uncapped and tearing
+    Immediate
+};
+
+struct AppConfig {
+    // depth of the frame-context ring: how many frames the CPU may record ahead of the GPU
+    uint32_t framesInFlight = 2;
+    // file the VkPipelineCache is loaded from and saved to, empty disables persistence
+    std::string pipelineCachePath = "pipeline_cache.bin";
+
+    // render into offscreen images, no window, surface or VK_KHR_swapchain
+    bool headless = false;
+    uint32_t width = 800;
+    uint32_t height = 600;
+    // stop after this many frames / seconds, 0 runs until the window is closed
+    uint32_t frameLimit = 0;
+    double durationSeconds = 0.0;
+    bool validation = true;
+    // headless only: the last rendered frame is written to this PPM file
+    std::string outputPath;
+    // falls back to fifo when the surface does not support it
+    PresentMode presentMode = PresentMode::Auto;
+    // frames per second the CPU is held to, 0 is uncapped
+    double targetFps = 0.0;
+    // frames presented (or, without VK_KHR_present_wait, submitted) but not yet done before
+    // the next one may start, 0 leaves it to framesInFlight
+    uint32_t maxQueuedFrames = 0;
+    // track GPU progress with a Vulkan 1.2 timeline semaphore when supported, fences otherwise
+    bool timelineSemaphores = true;
+
+    // objects in the scene, all rendered with one instanced draw
+    uint32_t instanceCount = 1;
+    // instances per draw call, 0 draws all of them at once
+    uint32_t drawBatchSize = 0;
+    // falls back to the render pass when the device lacks Vulkan 1.3 dynamic rendering
+    RenderPath renderPath = RenderPath::RenderPass;
+    // where the per-object transforms come from
+    TransformPath transformPath = TransformPath::Instanced;
+    // frustum cull the instances in a compute pass and draw the survivors indirectly
+    bool gpuCulling = false;
+    // 0 records inline on the main thread, otherwise secondary command buffers on this many threads
+    uint32_t recordThreads = 0;
+    // 0 updates the transforms on the main thread, otherwise split across this many threads
+    uint32_t transformThreads = 0;
+
+    // .obj, .gltf or .glb drawn by every instance, empty uses the built-in quads
+    std::string meshPath;
+    // reorder triangles and vertices for the post-transform cache and vertex fetch
+    bool optimizeMesh = true;
+    // vertex buffer encoding, see parse_vertex_layout
+    std::string vertexLayout = "compact";
+
+    // memory mapped .mpak written by asset_packer, shaders and the texture are looked up in it
+    std::string assetArchivePath;
+    // image decoded at startup, or a .mtex cooked by texture_cooker
+    std::string texturePath = "../textures/mango.jpg";
+    // build texture mip chains on the CPU even when the GPU can blit them
+    bool cpuMipmaps = false;
+    // texture decoding threads, 0 picks one less than the hardware threads
+    uint32_t decodeThreads = 0;
+    // block init until every texture is resident instead of rendering with a placeholder first
+    bool syncTextures = false;
+    // objects cycle through this many tinted materials
+    uint32_t materialCount = 1;
+    // textures in one update-after-bind array indexed by material, when the device supports it
+    bool bindless = true;
+
+    // benchmark mode: warmupFrames unrecorded frames, then benchmarkFrames measured ones
+    uint32_t benchmarkFrames = 0;
+    uint32_t warmupFrames = 60;
+    // .json or .csv, empty prints the summary only
+    std::string reportPath;
+    // print the GPU timestamp scopes (and pipeline statistics when supported) on exit
+    bool gpuProfile = false;
+};
+
+// throws std::invalid_argument on unknown flags or out of range values
+AppConfig parse_args(int argc, char** argv);
+void print_usage(const char* program);
+
+#endif //FAIR_ENGINE_CONFIG_H
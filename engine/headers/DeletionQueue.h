@@ -0,0 +1,66 @@
+#ifndef FAIR_ENGINE_DELETIONQUEUE_H
+#define FAIR_ENGINE_DELETIONQUEUE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "GpuTimeline.h"
+#include "MemoryAllocator.h"
+
+// Destroys Vulkan objects once the GPU no longer uses them instead of right away. A retired
+// object is tagged with the timeline value of the latest submission, so everything submitted
+// before it was retired may still reference it, and it is destroyed by the first collect() that
+// finds the timeline past that value. Replacing a resource at runtime therefore never needs
+// vkDeviceWaitIdle: retire the old one after the last submission that reads it, create the new
+// one and keep rendering. Objects only referenced by commands that are not submitted yet have
+// to be retired after that submission.
+class DeletionQueue {
+    // everything retired while the timeline stood at the same value
+    struct Retired {
+        uint64_t value = 0;
+        std::vector<VkFramebuffer> framebuffers;
+        std::vector<VkImageView> imageViews;
+        std::vector<std::pair<VkImage, Allocation>> images;
+        std::vector<std::pair<VkBuffer, Allocation>> buffers;
+        std::vector<Allocation> allocations;
+        std::vector<VkSwapchainKHR> swapchains;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryAllocator* allocator = nullptr;
+    GpuTimeline* timeline = nullptr;
+
+    std::deque<Retired> pending;
+    uint64_t pendingObjects = 0;
+    uint64_t destroyedObjects = 0;
+
+    Retired& current();
+    void destroy_retired(Retired& retired);
+
+public:
+    void init(VkDevice device, MemoryAllocator& allocator, GpuTimeline& timeline);
+    // destroys everything still pending, the device has to be idle
+    void destroy();
+
+    // allocations are freed together with their object, empty ones are skipped
+    void retire_framebuffer(VkFramebuffer framebuffer);
+    void retire_image_view(VkImageView imageView);
+    void retire_image(VkImage image, Allocation allocation);
+    void retire_buffer(VkBuffer buffer, Allocation allocation);
+    void retire_allocation(Allocation allocation);
+    // destroyed after the views and framebuffers retired at the same time
+    void retire_swapchain(VkSwapchainKHR swapchain);
+
+    // destroys what the GPU is done with, never blocks; returns the number of objects destroyed
+    uint64_t collect();
+
+    uint64_t pending_objects() const { return pendingObjects; }
+    uint64_t destroyed_objects() const { return destroyedObjects; }
+};
+
+#endif //FAIR_ENGINE_DELETIONQUEUE_H
@@ -0,0 +1,54 @@
+#ifndef FAIR_ENGINE_FRAMEPACER_H
+#define FAIR_ENGINE_FRAMEPACER_H
+
+#include <cstdint>
+#include <ostream>
+
+struct FramePacingStats {
+    uint64_t count = 0;
+    double meanMs = 0.0;
+    // of the frame to frame intervals, in ms^2
+    double varianceMs2 = 0.0;
+    double stddevMs = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    // intervals more than 1.5 target periods long, 0 without a target
+    uint64_t missed = 0;
+};
+
+// Caps the frame rate at a target by holding each frame back until its deadline: the thread
+// sleeps until shortly before it, then spins the rest of the way, with the spin margin adapted to
+// how late the OS wakes the thread up. A frame that misses its deadline by more than a period
+// starts a new schedule instead of bursting to catch up. Also measures the achieved intervals
+// between frame_done calls, with or without a target.
+class FramePacer {
+    double periodMs = 0.0;
+    double nextDeadlineMs = -1.0;
+    double spinMarginMs = 1.0;
+
+    double lastFrameMs = -1.0;
+    // Welford's running mean and variance, the run can be arbitrarily long
+    uint64_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    uint64_t missed = 0;
+
+public:
+    // 0 leaves the frame rate uncapped
+    explicit FramePacer(double targetFps = 0.0);
+
+    bool limits_rate() const { return periodMs > 0.0; }
+    double period_ms() const { return periodMs; }
+
+    // blocks until the next frame may start, returns the time waited in ms
+    double wait();
+    // once per frame at the same point of it, e.g. right after present
+    void frame_done(double nowMs);
+
+    FramePacingStats stats() const;
+    void print_summary(std::ostream& out) const;
+};
+
+#endif //FAIR_ENGINE_FRAMEPACER_H
@@ -0,0 +1,113 @@
+#ifndef FAIR_ENGINE_GPUPROFILER_H
+#define FAIR_ENGINE_GPUPROFILER_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct GpuScopeResult {
+    std::string name;
+    // nesting level, 0 for top level scopes
+    uint32_t depth;
+    double ms;
+};
+
+struct GpuPipelineStatistics {
+    bool valid = false;
+    uint64_t inputAssemblyVertices = 0;
+    uint64_t inputAssemblyPrimitives = 0;
+    uint64_t vertexShaderInvocations = 0;
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentShaderInvocations = 0;
+};
+
+// Named, nestable GPU timestamp scopes (plus one pipeline statistics query) per frame slot.
+// Every slot has its own query pools, results are read once the slot's submission finished,
+// so reading them back never stalls. All calls are no-ops when the queue family has no
+// valid timestamp bits.
+class GpuProfiler {
+    struct Scope {
+        const char* name;
+        uint32_t depth;
+        uint32_t beginQuery;
+        uint32_t endQuery;
+    };
+
+    struct Totals {
+        uint64_t count = 0;
+        double sum = 0.0;
+        double max = 0.0;
+    };
+
+    struct Slot {
+        VkQueryPool timestampPool = VK_NULL_HANDLE;
+        VkQueryPool statisticsPool = VK_NULL_HANDLE;
+        std::vector<Scope> scopes;
+        uint32_t queryCount = 0;
+        bool statisticsWritten = false;
+        bool pending = false;
+        int64_t tag = -1;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    bool timestamps = false;
+    bool statistics = false;
+    float timestampPeriod = 1.0f;
+    uint64_t timestampMask = UINT64_MAX;
+    uint32_t maxQueries = 0;
+
+    std::vector<Slot> slots;
+    Slot* recording = nullptr;
+    std::vector<uint32_t> scopeStack;
+
+    std::vector<GpuScopeResult> lastResults;
+    GpuPipelineStatistics lastStatistics;
+    int64_t lastTag = -1;
+    std::map<std::string, Totals> totals;
+
+    void accumulate(const std::string& name, double ms);
+
+public:
+    // statistics must only be requested when the pipelineStatisticsQuery feature is enabled
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily,
+              uint32_t slotCount, uint32_t maxScopes, bool statistics);
+    void destroy();
+
+    bool timestamps_supported() const { return timestamps; }
+    bool statistics_supported() const { return statistics; }
+    float timestamp_period() const { return timestampPeriod; }
+    uint64_t timestamp_mask() const { return timestampMask; }
+    // what secondary command buffers have to inherit while the statistics query is active
+    VkQueryPipelineStatisticFlags statistics_flags() const;
+
+    // must be recorded outside of a render pass, before any scope of the frame
+    void begin_frame(VkCommandBuffer commandBuffer, uint32_t slot, int64_t tag);
+    void end_frame(VkCommandBuffer commandBuffer);
+    void begin_scope(VkCommandBuffer commandBuffer, const char* name);
+    void end_scope(VkCommandBuffer commandBuffer);
+    // one statistics query per frame, outside of a render pass
+    void begin_statistics(VkCommandBuffer commandBuffer);
+    void end_statistics(VkCommandBuffer commandBuffer);
+
+    // reads back the slot once its submission has completed, false if it held nothing new
+    bool collect(uint32_t slot);
+    // GPU time measured elsewhere (e.g. upload batches), only goes into the summary
+    void add_sample(const std::string& name, double ms);
+
+    const std::vector<GpuScopeResult>& last_results() const { return lastResults; }
+    const GpuPipelineStatistics& last_statistics() const { return lastStatistics; }
+    // tag passed to begin_frame for the frame last_results() belongs to
+    int64_t last_tag() const { return lastTag; }
+    // -1 when the scope was not part of the last collected frame
+    double last_scope_ms(const std::string& name) const;
+
+    void print_summary(std::ostream& out) const;
+};
+
+#endif //FAIR_ENGINE_GPUPROFILER_H
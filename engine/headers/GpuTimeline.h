@@ -0,0 +1,52 @@
+#ifndef FAIR_ENGINE_GPUTIMELINE_H
+#define FAIR_ENGINE_GPUTIMELINE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// GPU progress on one queue as a single increasing counter: every submission made through
+// submit() gets the next value, and the counter reaches it once the submission has finished.
+// Frame slots, upload batches and anything waiting to be destroyed only remember a value and
+// compare it with completed(), one vkGetSemaphoreCounterValue per poll. Backed by a Vulkan 1.2
+// timeline semaphore when the device supports it, otherwise by a recycled fence per submission.
+class GpuTimeline {
+    VkDevice device = VK_NULL_HANDLE;
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+
+    uint64_t lastSubmitted = 0;
+    uint64_t completedValue = 0;
+
+    // fallback: submissions not known to be finished, oldest first
+    std::deque<std::pair<uint64_t, VkFence>> pendingFences;
+    std::vector<VkFence> freeFences;
+
+    VkFence acquire_fence();
+    void retire_fence();
+
+public:
+    // timelineSemaphores: the timelineSemaphore feature was enabled on the device
+    void init(VkDevice device, bool timelineSemaphores);
+    // the queue has to be idle
+    void destroy();
+
+    bool uses_timeline_semaphore() const { return semaphore != VK_NULL_HANDLE; }
+
+    // submits one batch that additionally signals the next value, which is returned; binary
+    // wait and signal semaphores of the batch are kept
+    uint64_t submit(VkQueue queue, const VkSubmitInfo& submitInfo);
+
+    // value of the latest submission, 0 before the first one
+    uint64_t last_submitted() const { return lastSubmitted; }
+    // highest value the GPU is known to have reached, never blocks
+    uint64_t completed();
+    bool is_complete(uint64_t value) { return value <= completedValue || value <= completed(); }
+    // blocks until the counter reaches value
+    void wait(uint64_t value);
+};
+
+#endif //FAIR_ENGINE_GPUTIMELINE_H
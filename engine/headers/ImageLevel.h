@@ -0,0 +1,15 @@
+#ifndef FAIR_ENGINE_IMAGELEVEL_H
+#define FAIR_ENGINE_IMAGELEVEL_H
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// one mip level inside a buffer that holds the whole chain back to back
+struct ImageLevel {
+    VkDeviceSize offset = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+#endif //FAIR_ENGINE_IMAGELEVEL_H
@@ -0,0 +1,56 @@
+#ifndef FAIR_ENGINE_JOBSYSTEM_H
+#define FAIR_ENGINE_JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run batches of independent jobs. The calling thread takes
+// part as worker 0, so a job system with one worker runs everything inline. Every job is told
+// which worker runs it, which lets callers keep per-worker state (e.g. command pools) without
+// any locking.
+class JobSystem {
+public:
+    // job index, worker index
+    using Job = std::function<void(uint32_t, uint32_t)>;
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+
+    // current batch, guarded by mutex apart from the atomics
+    const Job* job = nullptr;
+    uint32_t jobCount = 0;
+    std::atomic<uint32_t> nextJob{0};
+    std::atomic<uint32_t> doneJobs{0};
+    uint64_t generation = 0;
+    // first exception thrown by a job of the current batch, rethrown by run
+    std::exception_ptr error;
+    // workers that took the current batch and have not left run_jobs yet
+    uint32_t activeWorkers = 0;
+    bool stopping = false;
+
+    void worker_main(uint32_t workerIndex);
+    void run_jobs(const Job* batch, uint32_t count, uint32_t workerIndex);
+
+public:
+    explicit JobSystem(uint32_t workerCount = 1);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    uint32_t worker_count() const { return static_cast<uint32_t>(threads.size()) + 1; }
+
+    // runs job(i, worker) for every i in [0, count) and returns once all of them finished,
+    // rethrows the first exception a job threw
+    void run(uint32_t count, const Job& job);
+};
+
+#endif //FAIR_ENGINE_JOBSYSTEM_H
@@ -0,0 +1,99 @@
+#ifndef FAIR_ENGINE_MEMORYALLOCATOR_H
+#define FAIR_ENGINE_MEMORYALLOCATOR_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+// Buffers and linear images may not share a bufferImageGranularity page with optimal images.
+enum class ResourceKind {
+    Linear,
+    Optimal
+};
+
+struct Suballocation {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    bool free;
+    ResourceKind kind;
+};
+
+struct MemoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;
+    uint32_t memoryType = 0;
+    bool dedicated = false;
+
+    // every byte of the block belongs to exactly one range, sorted by offset
+    std::list<Suballocation> suballocations;
+    uint32_t allocationCount = 0;
+    VkDeviceSize usedBytes = 0;
+};
+
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // persistently mapped pointer to offset, nullptr for memory that is not host visible
+    void* mapped = nullptr;
+    uint32_t memoryType = 0;
+    MemoryBlock* block = nullptr;
+};
+
+struct MemoryTypeStats {
+    uint32_t blockCount = 0;
+    uint32_t allocationCount = 0;
+    VkDeviceSize reservedBytes = 0;
+    VkDeviceSize usedBytes = 0;
+    uint32_t freeRangeCount = 0;
+    VkDeviceSize largestFreeRange = 0;
+
+    // 0 when all free space is one contiguous range, close to 1 when it is scattered
+    double fragmentation() const;
+};
+
+struct AllocatorStats {
+    std::vector<MemoryTypeStats> memoryTypes;
+    uint32_t deviceAllocationCount = 0;
+    uint32_t maxDeviceAllocationCount = 0;
+};
+
+// Takes large VkDeviceMemory blocks per memory type and hands out aligned ranges of them
+// (best fit with coalescing).
+class MemoryAllocator {
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memoryProperties = {};
+    VkDeviceSize bufferImageGranularity = 1;
+    uint32_t maxAllocationCount = 0;
+    uint32_t deviceAllocationCount = 0;
+
+    std::vector<std::unique_ptr<MemoryBlock>> blocks;
+
+    VkDeviceSize preferred_block_size(uint32_t memoryType) const;
+    MemoryBlock* create_block(uint32_t memoryType, VkDeviceSize size);
+    void destroy_block(MemoryBlock* block);
+    bool allocate_from_block(MemoryBlock* block, const VkMemoryRequirements& requirements, ResourceKind kind, Allocation& allocation);
+
+public:
+    void init(VkPhysicalDevice physicalDevice, VkDevice device);
+    void destroy();
+
+    uint32_t find_memory_type(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    const VkPhysicalDeviceMemoryProperties& memory_properties() const { return memoryProperties; }
+
+    Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+                        ResourceKind kind);
+    void free(Allocation& allocation);
+
+    AllocatorStats get_stats() const;
+    void print_stats(std::ostream& out) const;
+};
+
+#endif //FAIR_ENGINE_MEMORYALLOCATOR_H
@@ -0,0 +1,73 @@
+#ifndef FAIR_ENGINE_MESH_H
+#define FAIR_ENGINE_MESH_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
+#include <glm/glm.hpp>
+
+// CPU side vertex, VertexLayout decides how it is stored on the GPU
+struct Vertex {
+    glm::vec3 pos;
+    glm::vec3  color;
+    glm::vec2 texCoord;
+    glm::vec3 normal;
+};
+
+// entries of the FIFO post-transform cache the statistics simulate
+const uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+    // transformed vertices per triangle: 3 is no reuse at all, ~0.5 the limit for large regular meshes
+    float acmr = 0.0f;
+    // transformed vertices per unique vertex, 1 is the ideal
+    float atvr = 0.0f;
+};
+
+// indexed triangle list
+struct Mesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// contents of a glTF buffer uri, relative to the .gltf file
+using MeshResourceLoader = std::function<std::vector<uint8_t>(const std::string& uri)>;
+
+// Positions and normals are converted from the Y-up convention of both formats to the Z-up
+// world of the engine, missing normals are left zero. Parsers emit one vertex per face corner
+// (OBJ) or per accessor element (glTF), run deduplicate_vertices afterwards. Throw
+// std::runtime_error on malformed or unsupported files.
+Mesh parse_obj(const char* text, size_t size, const std::string& name);
+// .gltf (JSON, buffers embedded as data uris or loaded with loadResource) or binary .glb
+Mesh parse_gltf(const uint8_t* data, size_t size, const std::string& name, const MeshResourceLoader& loadResource);
+// picks the parser by extension, external glTF buffers are read next to the file
+Mesh load_mesh(const std::string& path);
+bool is_mesh_file(const std::string& path);
+
+// area weighted vertex normals, for meshes whose source has none
+void generate_normals(Mesh& mesh);
+// merges bit-identical vertices
+void deduplicate_vertices(Mesh& mesh);
+// reorders triangles for the post-transform cache (Forsyth's linear-speed algorithm)
+void optimize_vertex_cache(Mesh& mesh);
+// renumbers vertices in order of first use so vertex fetch walks the buffer forwards, drops unused ones
+void optimize_vertex_fetch(Mesh& mesh);
+// centers the bounding box on the origin and scales its largest side to 1
+void fit_unit_cube(Mesh& mesh);
+
+VertexCacheStats analyze_vertex_cache(const std::vector<uint32_t>& indices, uint32_t vertexCount,
+                                      uint32_t cacheSize = VERTEX_CACHE_SIZE);
+// 16 bit whenever every vertex can be addressed with it
+VkIndexType choose_index_type(uint32_t vertexCount);
+uint32_t index_type_size(VkIndexType indexType);
+// indices converted to indexType, ready to be uploaded
+std::vector<uint8_t> pack_indices(const std::vector<uint32_t>& indices, VkIndexType indexType);
+
+#endif //FAIR_ENGINE_MESH_H
@@ -0,0 +1,18 @@
+#ifndef FAIR_ENGINE_MIPCHAIN_H
+#define FAIR_ENGINE_MIPCHAIN_H
+
+#include <cstdint>
+#include <vector>
+
+#include "ImageLevel.h"
+
+// number of levels down to 1x1
+uint32_t mip_level_count(uint32_t width, uint32_t height);
+
+// CPU fallback for formats the device cannot blit with linear filtering. Builds the full chain
+// of an RGBA8 image with a 2x2 box filter (SSE2 / NEON when available). sRGB data is filtered in
+// linear space. Returns all levels packed one after the other, levels receives their layout.
+std::vector<uint8_t> build_mip_chain_rgba8(const uint8_t* pixels, uint32_t width, uint32_t height, bool srgb,
+                                           std::vector<ImageLevel>& levels);
+
+#endif //FAIR_ENGINE_MIPCHAIN_H
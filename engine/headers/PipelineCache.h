@@ -0,0 +1,32 @@
+#ifndef FAIR_ENGINE_PIPELINECACHE_H
+#define FAIR_ENGINE_PIPELINECACHE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+
+// VkPipelineCache backed by a file. Data written by a different driver or device is
+// discarded on load (the header's vendorID/deviceID/pipelineCacheUUID must match),
+// the file is replaced atomically on save so a crash never leaves a truncated cache.
+class PipelineCache {
+    VkDevice device = VK_NULL_HANDLE;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    std::string path;
+    bool warm = false;
+
+    bool validate_header(const std::vector<char>& data, const VkPhysicalDeviceProperties& properties, std::string& reason) const;
+
+public:
+    // an empty path keeps the cache in memory only
+    void init(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::string& path);
+    void save() const;
+    void destroy();
+
+    VkPipelineCache handle() const { return cache; }
+    // true when usable data was loaded from disk
+    bool is_warm() const { return warm; }
+};
+
+#endif //FAIR_ENGINE_PIPELINECACHE_H
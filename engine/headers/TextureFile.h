@@ -0,0 +1,57 @@
+#ifndef FAIR_ENGINE_TEXTUREFILE_H
+#define FAIR_ENGINE_TEXTUREFILE_H
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ImageLevel.h"
+
+const char TEXTURE_FILE_MAGIC[4] = {'M', 'T', 'E', 'X'};
+const uint32_t TEXTURE_FILE_VERSION = 1;
+
+// one encoding of the texture with its full mip chain, levels are packed one after the other
+struct TextureVariant {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    std::vector<ImageLevel> levels;
+    // points into data, into TextureFile::storage or into memory the caller keeps alive
+    // (e.g. a mapped asset archive)
+    const uint8_t* payload = nullptr;
+    VkDeviceSize size = 0;
+    // owned payload, only used while cooking
+    std::vector<uint8_t> data;
+};
+
+// Cooked texture (.mtex): the same image in several GPU formats, ordered from most to least
+// preferred. The loader uploads the first variant the device can sample from.
+struct TextureFile {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevels = 0;
+    std::vector<TextureVariant> variants;
+    // file contents when read_texture_file loaded it, empty for parsed views
+    std::vector<uint8_t> storage;
+};
+
+// true for the 4x4 block compressed formats the cooker writes
+bool is_block_compressed(VkFormat format);
+// bytes of a 4x4 block, or of a single texel for uncompressed formats
+uint32_t format_block_bytes(VkFormat format);
+VkDeviceSize texture_level_size(VkFormat format, uint32_t width, uint32_t height);
+// offsets and extents of every level packed back to back, returns the total size
+VkDeviceSize texture_level_layout(VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels,
+                                  std::vector<ImageLevel>& levels);
+const char* texture_format_name(VkFormat format);
+// the device feature a format needs, sRGB and UNORM encodings of a family need the same one
+enum class TextureCompression {None, BC, ETC2};
+TextureCompression texture_compression(VkFormat format);
+
+// throw std::runtime_error on I/O errors and malformed files
+void write_texture_file(const std::string& path, const TextureFile& texture);
+TextureFile read_texture_file(const std::string& path);
+// no copy, the variants point into data
+TextureFile parse_texture_file(const uint8_t* data, size_t size, const std::string& name);
+
+#endif //FAIR_ENGINE_TEXTUREFILE_H
@@ -0,0 +1,83 @@
+#ifndef FAIR_ENGINE_TEXTURELOADER_H
+#define FAIR_ENGINE_TEXTURELOADER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AssetArchive.h"
+#include "TextureFile.h"
+
+struct TextureRequest {
+    uint32_t id = 0;
+    std::string path;
+    // file contents when the texture comes from a mapped archive, read from path otherwise
+    AssetView asset;
+    // .mtex, parsed instead of decoded
+    bool cooked = false;
+    // RGBA8 only: build the whole mip chain on the worker (the device cannot blit it)
+    bool buildMipChain = false;
+};
+
+struct DecodedTexture {
+    uint32_t id = 0;
+    std::string path;
+    // empty when decoding succeeded
+    std::string error;
+
+    // RGBA8 sources: level 0, or every level when levels is not empty. Owns the decoder's
+    // buffer directly, no copy is made before the upload queue stages it
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::shared_ptr<const uint8_t> pixels;
+    size_t size = 0;
+    std::vector<ImageLevel> levels;
+
+    // cooked sources
+    bool cooked = false;
+    TextureFile file;
+
+    double decodeMs = 0.0;
+};
+
+// Decodes images on a small pool of worker threads. Requests are queued without blocking, the
+// main thread picks up finished textures with take_finished whenever it has time to upload them.
+class TextureLoader {
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::deque<TextureRequest> queue;
+    std::vector<DecodedTexture> finished;
+    uint32_t inFlight = 0;
+    bool stopping = false;
+
+    void worker_main();
+    static DecodedTexture decode(const TextureRequest& request);
+
+public:
+    TextureLoader() = default;
+    ~TextureLoader();
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    void start(uint32_t threadCount);
+    // drops queued requests and joins the workers
+    void stop();
+
+    uint32_t thread_count() const { return static_cast<uint32_t>(threads.size()); }
+    void request(TextureRequest request);
+    // never blocks
+    std::vector<DecodedTexture> take_finished();
+    // blocks until at least one texture finished or nothing is pending
+    std::vector<DecodedTexture> wait_finished();
+    // requests queued or being decoded, not counting finished ones
+    uint32_t pending();
+};
+
+#endif //FAIR_ENGINE_TEXTURELOADER_H
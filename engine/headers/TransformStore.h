@@ -0,0 +1,66 @@
+#ifndef FAIR_ENGINE_TRANSFORMSTORE_H
+#define FAIR_ENGINE_TRANSFORMSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// where update writes the column major matrices of object i: models + i * modelStride, e.g.
+// straight into a mapped instance or uniform buffer
+struct TransformOutput {
+    // translate * rotate * scale
+    uint8_t* models = nullptr;
+    size_t modelStride = sizeof(glm::mat4);
+    // viewProj * model, skipped when null
+    uint8_t* mvps = nullptr;
+    size_t mvpStride = sizeof(glm::mat4);
+    glm::mat4 viewProj = glm::mat4(1.0f);
+};
+
+// Structure of arrays state of the animated objects: position, orientation, scale and world
+// space angular velocity, one float array per component. update integrates the orientations by
+// dt and composes the model matrices, simd_width() objects at a time with AVX2/FMA, SSE2 or NEON,
+// whichever the build targets. Disjoint ranges may be updated concurrently, ranges that start
+// and end on multiples of simd_width() stay on the vector path entirely.
+class TransformStore {
+public:
+    enum Component { PX, PY, PZ, QX, QY, QZ, QW, SX, SY, SZ, WX, WY, WZ, COMPONENT_COUNT };
+
+private:
+    // every component array is 32 byte aligned and padded to a whole vector
+    std::vector<float> storage;
+    float* components[COMPONENT_COUNT] = {};
+    size_t count = 0;
+
+public:
+    TransformStore() = default;
+    // components point into storage, whose alignment a copy would not keep
+    TransformStore(const TransformStore&) = delete;
+    TransformStore& operator=(const TransformStore&) = delete;
+    TransformStore(TransformStore&&) = default;
+    TransformStore& operator=(TransformStore&&) = default;
+
+    static size_t simd_width();
+    // "avx2", "sse2", "neon" or "scalar"
+    static const char* simd_name();
+
+    // new objects sit at the origin with no rotation, unit scale and no angular velocity
+    void resize(size_t count);
+    size_t size() const { return count; }
+
+    void set(size_t index, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale,
+             const glm::vec3& angularVelocity);
+    glm::quat rotation(size_t index) const;
+
+    // rotates [first, last) by angular velocity * dt (first order, renormalized) and writes their matrices
+    void update(size_t first, size_t last, float dt, const TransformOutput& output);
+    // the same kernel one object at a time, what the SIMD paths are measured against
+    void update_scalar(size_t first, size_t last, float dt, const TransformOutput& output);
+};
+
+#endif //FAIR_ENGINE_TRANSFORMSTORE_H
@@ -0,0 +1,55 @@
+#ifndef FAIR_ENGINE_UNIFORMRING_H
+#define FAIR_ENGINE_UNIFORMRING_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+
+#include "MemoryAllocator.h"
+
+// One persistently mapped buffer for all uniform/storage data the CPU rewrites every frame.
+// It is split into one region per frame slot, a region is bump allocated while its frame is
+// recorded and reused once the GPU finished that slot. Allocations are aligned for dynamic
+// descriptor offsets, memory that is not host coherent is flushed explicitly.
+class UniformRing {
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryAllocator* allocator = nullptr;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    Allocation allocation;
+    uint8_t* mapped = nullptr;
+    bool coherent = true;
+
+    VkDeviceSize alignment = 256;
+    VkDeviceSize atomSize = 1;
+    VkDeviceSize regionSize = 0;
+    uint32_t regionCount = 0;
+
+    uint32_t region = 0;
+    VkDeviceSize head = 0;
+    VkDeviceSize flushedHead = 0;
+
+public:
+    // regionSize is rounded up to the offset alignment
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator,
+              VkDeviceSize regionSize, uint32_t regionCount);
+    void destroy();
+
+    // size of an allocation of size bytes including its alignment padding
+    VkDeviceSize aligned_size(VkDeviceSize size) const;
+
+    // starts the region of a frame slot whose previous submission has completed
+    void begin_frame(uint32_t slot);
+    // returns the offset of size bytes in buffer(), data receives their mapped address.
+    // Throws std::runtime_error when the region of the current frame is exhausted
+    VkDeviceSize allocate(VkDeviceSize size, void** data);
+    // makes everything written since the last flush visible to the device, call before submitting
+    void flush();
+
+    VkBuffer get_buffer() const { return buffer; }
+    bool is_coherent() const { return coherent; }
+    VkDeviceSize region_size() const { return regionSize; }
+};
+
+#endif //FAIR_ENGINE_UNIFORMRING_H
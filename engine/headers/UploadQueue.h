@@ -0,0 +1,122 @@
+#ifndef FAIR_ENGINE_UPLOADQUEUE_H
+#define FAIR_ENGINE_UPLOADQUEUE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "GpuTimeline.h"
+#include "ImageLevel.h"
+#include "MemoryAllocator.h"
+
+struct ImageUpload {
+    VkImage image = VK_NULL_HANDLE;
+    VkImageAspectFlags aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    const void* data = nullptr;
+    VkDeviceSize size = 0;
+
+    // mip levels of the image, all of them end up in finalLayout
+    uint32_t mipLevels = 1;
+    // levels contained in data, empty means data is level 0 at offset 0
+    std::vector<ImageLevel> levels;
+    // fill every level past the uploaded ones with linear blits on the graphics queue, the image
+    // needs TRANSFER_SRC usage and a format that supports linear filtering blits
+    bool generateMips = false;
+
+    // state the image is handed over to the graphics queue in
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    VkAccessFlags dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+};
+
+// Records any number of buffer/image uploads into one batch and submits it without stalling.
+// Copies run on a dedicated transfer queue family when the device has one, ownership is then
+// released there and acquired on the graphics queue. Staging data lives in a persistently mapped
+// ring buffer whose space is recycled as soon as the GPU timeline passes the batch that used it.
+class UploadQueue {
+    struct Batch {
+        // timeline value of the graphics submission
+        uint64_t ticket = 0;
+        VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+        VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+        VkSemaphore transferDone = VK_NULL_HANDLE;
+        // start/end timestamps of the graphics command buffer, only with gpu timing enabled
+        VkQueryPool timestampPool = VK_NULL_HANDLE;
+        // ring bytes (including alignment and wrap-around padding) this batch holds on to
+        VkDeviceSize stagingBytes = 0;
+        // uploads too large for the ring get their own staging buffer
+        std::vector<std::pair<VkBuffer, Allocation>> dedicatedStaging;
+        bool recording = false;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryAllocator* allocator = nullptr;
+    GpuTimeline* timeline = nullptr;
+
+    uint32_t graphicsFamily = 0;
+    uint32_t transferFamily = 0;
+    VkQueue graphicsQueue = VK_NULL_HANDLE;
+    VkQueue transferQueue = VK_NULL_HANDLE;
+    VkCommandPool graphicsCommandPool = VK_NULL_HANDLE;
+    VkCommandPool transferCommandPool = VK_NULL_HANDLE;
+
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+    Allocation stagingAllocation;
+    VkDeviceSize stagingCapacity = 0;
+    VkDeviceSize stagingHead = 0;
+    VkDeviceSize stagingUsed = 0;
+    VkDeviceSize stagingAlignment = 16;
+
+    Batch current;
+    std::deque<Batch> inFlight;
+    std::vector<Batch> freeBatches;
+    uint64_t completedTicket = 0;
+
+    bool gpuTiming = false;
+    float timestampPeriod = 1.0f;
+    uint64_t timestampMask = UINT64_MAX;
+    std::vector<double> gpuTimes;
+
+    bool dedicated_transfer() const { return transferFamily != graphicsFamily; }
+    Batch create_batch();
+    void destroy_batch(Batch& batch);
+    void begin_batch();
+    bool retire_oldest(bool wait);
+    VkDeviceSize reserve_staging(VkDeviceSize size, VkBuffer& buffer);
+    void copy_to_staging(const void* data, VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset);
+    void generate_mips(const ImageUpload& upload, uint32_t firstLevel);
+
+public:
+    void init(VkDevice device, MemoryAllocator& allocator, GpuTimeline& timeline,
+              uint32_t graphicsFamily, VkQueue graphicsQueue,
+              uint32_t transferFamily, VkQueue transferQueue,
+              VkDeviceSize stagingSize, VkDeviceSize optimalCopyOffsetAlignment);
+    void destroy();
+
+    void upload_buffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size,
+                       VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask);
+    void upload_image(const ImageUpload& upload);
+
+    // submits everything recorded so far, returns the ticket to poll/wait on (0 if nothing was
+    // recorded); tickets are values of the timeline, so they also order uploads against frames
+    uint64_t submit();
+    bool is_complete(uint64_t ticket);
+    void wait(uint64_t ticket);
+    // recycles command buffers and staging space of finished batches, never blocks
+    void collect();
+
+    bool uses_dedicated_transfer_queue() const { return dedicated_transfer(); }
+
+    // times every batch with a timestamp pair, only valid without a dedicated transfer queue
+    // since transfer-only queues cannot reset query pools
+    void enable_gpu_timing(float timestampPeriod, uint64_t timestampMask);
+    // GPU milliseconds of the batches retired since the last call
+    std::vector<double> take_gpu_times();
+};
+
+#endif //FAIR_ENGINE_UPLOADQUEUE_H
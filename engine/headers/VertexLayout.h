@@ -0,0 +1,60 @@
+#ifndef FAIR_ENGINE_VERTEXLAYOUT_H
+#define FAIR_ENGINE_VERTEXLAYOUT_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+
+// shader locations of the vertex attributes, 3-6 belong to the per-instance model matrix
+const uint32_t POSITION_LOCATION = 0;
+const uint32_t COLOR_LOCATION = 1;
+const uint32_t TEXCOORD_LOCATION = 2;
+const uint32_t NORMAL_LOCATION = 7;
+
+enum class PositionEncoding { Float32, Float16, Snorm16 };
+enum class NormalEncoding { Float32, Octahedral16 };
+enum class ColorEncoding { Float32, Unorm8 };
+enum class TexCoordEncoding { Float32, Float16, Unorm16 };
+
+// How Vertex is stored in the vertex buffer. Quantized positions are relative to the mesh bounds
+// and scaled back in the vertex shader, octahedral normals are decoded there as well, every other
+// encoding is expanded to float by the vertex fetch hardware.
+struct VertexLayout {
+    PositionEncoding position = PositionEncoding::Snorm16;
+    NormalEncoding normal = NormalEncoding::Octahedral16;
+    ColorEncoding color = ColorEncoding::Unorm8;
+    TexCoordEncoding texCoord = TexCoordEncoding::Unorm16;
+};
+
+// object space position = decoded attribute * scale + bias
+struct PositionDequantization {
+    glm::vec4 scale = glm::vec4(1.0f);
+    glm::vec4 bias = glm::vec4(0.0f);
+};
+
+// "float", "compact" or comma separated attribute=encoding pairs on top of compact, e.g.
+// "position=half,texcoord=float". Throws std::invalid_argument.
+VertexLayout parse_vertex_layout(const std::string& spec);
+std::string vertex_layout_name(const VertexLayout& layout);
+
+VkFormat position_format(PositionEncoding encoding);
+VkFormat normal_format(NormalEncoding encoding);
+VkFormat color_format(ColorEncoding encoding);
+VkFormat texcoord_format(TexCoordEncoding encoding);
+
+uint32_t vertex_stride(const VertexLayout& layout);
+VkVertexInputBindingDescription vertex_binding_description(const VertexLayout& layout, uint32_t binding);
+std::vector<VkVertexInputAttributeDescription> vertex_attribute_descriptions(const VertexLayout& layout, uint32_t binding);
+
+// unorm16 texture coordinates only cover [0, 1], wrapping ones fall back to half floats
+VertexLayout fit_vertex_layout(VertexLayout layout, const std::vector<Vertex>& vertices);
+// vertex buffer contents in the layout, dequantization receives the position scale and bias
+std::vector<uint8_t> encode_vertices(const std::vector<Vertex>& vertices, const VertexLayout& layout,
+                                     PositionDequantization& dequantization);
+
+#endif //FAIR_ENGINE_VERTEXLAYOUT_H
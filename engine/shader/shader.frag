@@ -4,10 +4,24 @@ layout(location=0) out vec4 outColor;
 
 layout(location=0) in vec3 fragColor;
 layout(location=1) in vec2 fragTexCoord;
+layout(location=2) in vec3 fragNormal;
+layout(location=3) flat in uint fragMaterial;
 
 layout(binding=1) uniform sampler2D texSampler;
 
+struct Material {
+    vec4 baseColor;
+    uint textureSlot;
+};
+
+layout(std430, binding=3) readonly buffer Materials {
+    Material materials[];
+};
+
+const vec3 LIGHT_DIRECTION = normalize(vec3(0.4, 0.6, 1.0));
 
 void main() {
-    outColor = texture(texSampler, fragTexCoord);
-}
\ No newline at end of file
+    float diffuse = max(dot(normalize(fragNormal), LIGHT_DIRECTION), 0.0);
+    vec4 albedo = texture(texSampler, fragTexCoord) * materials[fragMaterial].baseColor;
+    outColor = vec4(albedo.rgb * (0.35 + 0.65 * diffuse), albedo.a);
+}
@@ -1,20 +1,81 @@
 #version 450
 
+// formats with fewer components are expanded by the vertex fetch, w reads as 1
 layout(location=0) in vec3 inPosition;
 layout(location=1) in vec3 inColor;
 layout(location=2) in vec2 inTexCoord;
+// per instance, one column per location
+layout(location=3) in mat4 inModel;
+// xyz, or octahedral xy
+layout(location=7) in vec3 inNormal;
+// per instance, the object the instance draws; differs from gl_InstanceIndex once culled
+layout(location=8) in uint inObject;
 
-layout(binding=0) uniform UniformBufferObject {
+// matches NormalEncoding::Octahedral16 of the vertex layout
+layout(constant_id=0) const bool OCTAHEDRAL_NORMALS = true;
+// TransformPath: 0 instance buffer, 1 push constants, 2 dynamic uniform buffer offset
+layout(constant_id=1) const int TRANSFORM_PATH = 0;
+
+layout(binding=0) uniform CameraUniform {
+    mat4 viewProj;
+    vec4 positionScale;
+    vec4 positionBias;
+    vec4 frustumPlanes[6];
+} camera;
+
+layout(push_constant) uniform ObjectPushConstants {
+    mat4 mvp;
     mat4 model;
-    mat4 view;
-    mat4 proj;
-} ubo;
+} object;
+
+layout(binding=2) uniform ObjectUniform {
+    mat4 mvp;
+    mat4 model;
+} objectUniform;
+
+struct Material {
+    vec4 baseColor;
+    uint textureSlot;
+};
+
+layout(std430, binding=3) readonly buffer Materials {
+    Material materials[];
+};
 
 layout(location=0) out vec3 fragColor;
 layout(location=1) out vec2 fragTexCoord;
+layout(location=2) out vec3 fragNormal;
+layout(location=3) flat out uint fragMaterial;
+
+vec3 octahedral_decode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    vec4 position = vec4(inPosition * camera.positionScale.xyz + camera.positionBias.xyz, 1.0);
+    vec3 normal = OCTAHEDRAL_NORMALS ? octahedral_decode(inNormal.xy) : inNormal;
+
+    // one matrix-vector product per vertex, or two on the instanced path; no matrix products
+    mat4 model;
+    if (TRANSFORM_PATH == 1) {
+        model = object.model;
+        gl_Position = object.mvp * position;
+    } else if (TRANSFORM_PATH == 2) {
+        model = objectUniform.model;
+        gl_Position = objectUniform.mvp * position;
+    } else {
+        model = inModel;
+        gl_Position = camera.viewProj * (inModel * position);
+    }
     fragColor = inColor;
     fragTexCoord = inTexCoord;
-}
\ No newline at end of file
+    // the object transforms are rotations and translations only
+    fragNormal = mat3(model) * normal;
+    // the per-object paths draw object i as instance i
+    uint objectIndex = TRANSFORM_PATH == 0 ? inObject : uint(gl_InstanceIndex);
+    fragMaterial = objectIndex % uint(materials.length());
+}
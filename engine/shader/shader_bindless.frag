@@ -0,0 +1,31 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location=0) out vec4 outColor;
+
+layout(location=0) in vec3 fragColor;
+layout(location=1) in vec2 fragTexCoord;
+layout(location=2) in vec3 fragNormal;
+layout(location=3) flat in uint fragMaterial;
+
+// BindlessTextures, partially bound: only slots a material points at are valid
+layout(set=1, binding=0) uniform sampler2D textures[];
+
+struct Material {
+    vec4 baseColor;
+    uint textureSlot;
+};
+
+layout(std430, binding=3) readonly buffer Materials {
+    Material materials[];
+};
+
+const vec3 LIGHT_DIRECTION = normalize(vec3(0.4, 0.6, 1.0));
+
+void main() {
+    float diffuse = max(dot(normalize(fragNormal), LIGHT_DIRECTION), 0.0);
+    Material material = materials[fragMaterial];
+    // instances of one draw can use different materials, the index is not uniform across the subgroup
+    vec4 albedo = texture(textures[nonuniformEXT(material.textureSlot)], fragTexCoord) * material.baseColor;
+    outColor = vec4(albedo.rgb * (0.35 + 0.65 * diffuse), albedo.a);
+}
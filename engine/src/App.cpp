@@ -6,12 +6,17 @@
 #include <cstdint>
 #include <sstream>
 #include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "../headers/App.h"
+#include "../headers/MipChain.h"
+#include "../headers/TextureFile.h"
 
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -19,6 +24,20 @@
 
 #define SHADER_PATH "../engine/shader/"
 
+static double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+App::App(AppConfig config)
+        : config(config), jobs(std::max(config.recordThreads, 1u)),
+          benchmark(config.warmupFrames, config.benchmarkFrames),
+          transformJobs(std::max(config.transformThreads, 1u)), pacer(config.targetFps) {
+    frames.resize(config.framesInFlight);
+    if (!config.headless) {
+        deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
+}
+
 void App::run() {
     init_window();
     init_vulkan();
@@ -27,103 +46,227 @@ void App::run() {
 }
 
 void App::init_window() {
+    if (config.headless) return;
+
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 //    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); Can be removed
-    window = glfwCreateWindow(800, 600, "Vulkan", nullptr, nullptr);
+    window = glfwCreateWindow(config.width, config.height, "Vulkan", nullptr, nullptr);
     glfwSetWindowUserPointer(window, this);
     glfwSetFramebufferSizeCallback(window, frameBufferResizeCallback);
 }
 
 void App::init_vulkan() {
+    auto startTime = std::chrono::steady_clock::now();
+
     create_instance();
-    crete_surface();
-    setup_debug_callback();
+    if (!config.headless) {
+        crete_surface();
+    }
+    if (config.validation) {
+        setup_debug_callback();
+    }
     pickPhysicalDevice();
     create_logical_device();
+    if (!config.assetArchivePath.empty()) {
+        assets.open(config.assetArchivePath);
+        std::cout << "assets: " << config.assetArchivePath << " mapped\n";
+    }
+    allocator.init(physicalDevice, device);
+    create_upload_queue();
+    create_profiler();
+
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    pipelineCache.init(device, properties, config.pipelineCachePath);
+
     create_swapchain();
     create_image_view();
     create_render_pass();
     create_command_pool();
     create_command_buffer();
+    create_record_pools();
 
     create_depth_resources();
     create_frame_buffers();
 
-    create_texture_image();
-    create_texture_image_view();
+    // decoding runs in the background, frames sample the placeholder until the texture is resident
+    uint32_t decodeThreads = config.decodeThreads;
+    if (decodeThreads == 0) {
+        decodeThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    textureLoader.start(decodeThreads);
+    request_textures();
+    create_placeholder_texture();
     create_texture_sampler();
 
-    create_uniform_buffer();
+    create_scene();
+    create_materials();
+    create_uniform_ring();
+    create_instance_buffer();
     create_descriptor_pool();
     create_descriptor_set_layout();
     create_descriptor_set();
 
+    // the vertex layout of the pipeline depends on the mesh
+    create_mesh();
     create_graphics_pipeline();
     create_vertex_buffer();
     create_indices_buffer();
+    if (gpuCulling) {
+        create_culling_resources();
+        create_compute_pipeline();
+    }
     create_sync_objects();
+
+    // measured and saved frames must not show the placeholder
+    if (config.syncTextures || benchmark.enabled() || !config.outputPath.empty()) {
+        poll_textures(true);
+        for (auto& frame : frames) {
+            update_material_buffer(frame);
+            if (!bindless) {
+                update_texture_descriptor(frame);
+            }
+        }
+    }
+
+    // the copies run while the first frames are being recorded, the graphics queue
+    // orders them before any draw that reads the uploaded resources
+    uploadQueue.submit();
+    allocator.print_stats(std::cout);
+
+    double startupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "startup: " << startupMs << " ms, pipeline creation: " << pipelineCreationMs << " ms ("
+              << (pipelineCache.is_warm() ? "warm" : "cold") << " cache)\n";
 }
 
 void App::main_loop() {
-    int frames = 0;
+    int frameCount = 0;
+    uint64_t totalFrames = 0;
     double t, t0, fps;
     std::stringstream title;
 //    char title_string[100];
 
-    t0 = glfwGetTime();
+    auto startTime = std::chrono::steady_clock::now();
+    t = t0 = 0.0;
 
-    while(!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+    while(!should_stop(totalFrames, t)) {
+        if (!config.headless) {
+            // minimized: sleep until the window changes instead of spinning through empty frames
+            if (swapchainOutOfDate) glfwWaitEvents(); else glfwPollEvents();
+        }
         drawFrame();
-        t = glfwGetTime();
-        if((t - t0) > 1.0 || frames == 0)
+        totalFrames++;
+        t = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        if((t - t0) > 1.0 || frameCount == 0)
         {
-            fps = (double)frames / (t - t0);
-            title << "FPS: " << fps;
+            fps = (double)frameCount / (t - t0);
+            title << "FPS: " << fps << " (" << 1000.0 / fps << " ms) - frames in flight: " << frames.size();
 //            sprintf(title_string, "FPS: %.1f", fps);
-            glfwSetWindowTitle(window, title.str().c_str());
+            if (config.headless) {
+                if (frameCount > 0) std::cout << title.str() << "\n";
+            } else {
+                glfwSetWindowTitle(window, title.str().c_str());
+            }
             title.str(std::string());
             t0 = t;
-            frames = 0;
+            frameCount = 0;
         }
-        frames ++;
+        frameCount ++;
     }
 
     vkDeviceWaitIdle(device);
+    std::cout << "rendered " << totalFrames << " frames in " << t << " s\n";
+    pacer.print_summary(std::cout);
+
+    if (benchmark.enabled()) {
+        finish_benchmark();
+    }
+    if (config.gpuProfile) {
+        for (uint32_t slot = 0; slot < frames.size(); ++slot) {
+            collect_gpu_results(slot);
+        }
+        profiler.print_summary(std::cout);
+    }
+
+    if (!config.outputPath.empty() && totalFrames > 0) {
+        save_frame(config.outputPath, (currentFrame + frames.size() - 1) % frames.size());
+    }
+}
+
+bool App::should_stop(uint64_t frameCount, double elapsedSeconds) {
+    if (!config.headless && glfwWindowShouldClose(window)) return true;
+    if (benchmark.done()) return true;
+    if (config.frameLimit > 0 && frameCount >= config.frameLimit) return true;
+    if (config.durationSeconds > 0.0 && elapsedSeconds >= config.durationSeconds) return true;
+    return false;
 }
 
 void App::cleanup() {
-    for(size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++){
-        vkDestroySemaphore(device, imageAvailableSemaphore[i], nullptr);
-        vkDestroySemaphore(device, renderFinishedSemaphore[i], nullptr);
-        vkDestroyFence(device, inFlightFence[i], nullptr);
+    textureLoader.stop();
+    for (auto& frame : frames) {
+        vkDestroySemaphore(device, frame.imageAvailableSemaphore, nullptr);
+        vkDestroySemaphore(device, frame.renderFinishedSemaphore, nullptr);
     }
+    profiler.destroy();
+    destroy_record_pools();
     vkDestroyCommandPool(device, commandPool, nullptr);
     cleanup_swapchain();
     vkDestroySampler(device, textureSampler, nullptr);
     vkDestroyImageView(device, textureImageView, nullptr);
     vkDestroyImage(device, textureImage, nullptr);
-    vkFreeMemory(device, textureImageMemory, nullptr);
-    for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; ++i) {
-        vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-        vkFreeMemory(device, uniformBufferMemory[i], nullptr);
-    }
+    allocator.free(textureImageAllocation);
+    vkDestroyImageView(device, placeholderImageView, nullptr);
+    vkDestroyImage(device, placeholderImage, nullptr);
+    allocator.free(placeholderImageAllocation);
+    for (auto& frame : frames) {
+        vkDestroyBuffer(device, frame.instanceBuffer, nullptr);
+        allocator.free(frame.instanceBufferAllocation);
+        vkDestroyBuffer(device, frame.visibleInstanceBuffer, nullptr);
+        allocator.free(frame.visibleInstanceBufferAllocation);
+        vkDestroyBuffer(device, frame.indirectBuffer, nullptr);
+        allocator.free(frame.indirectBufferAllocation);
+        vkDestroyBuffer(device, frame.cullCountBuffer, nullptr);
+        allocator.free(frame.cullCountBufferAllocation);
+        vkDestroyBuffer(device, frame.materialBuffer, nullptr);
+        allocator.free(frame.materialBufferAllocation);
+    }
+    bindlessTextures.destroy();
+    vkDestroyBuffer(device, boundsBuffer, nullptr);
+    allocator.free(boundsBufferAllocation);
+    vkDestroyPipeline(device, cullPipeline, nullptr);
+    vkDestroyPipeline(device, cullCompactPipeline, nullptr);
+    vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+    vkDestroyDescriptorPool(device, cullDescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device, cullSetLayout, nullptr);
+    uniformRing.destroy();
     vkDestroyDescriptorPool(device, descriptorPool, nullptr);
     vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
     vkDestroyBuffer(device, indexBuffer, nullptr);
-    vkFreeMemory(device, indexBufferMemory, nullptr);
+    allocator.free(indexBufferAllocation);
     vkDestroyBuffer(device, vertexBuffer, nullptr);
-    vkFreeMemory(device, vertexBufferMemory, nullptr);
+    allocator.free(vertexBufferAllocation);
     vkDestroyPipeline(device, graphicsPipeline, nullptr);
+    pipelineCache.save();
+    pipelineCache.destroy();
     vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
     vkDestroyRenderPass(device, renderPass, nullptr);
+    uploadQueue.destroy();
+    deletionQueue.destroy();
+    timeline.destroy();
+    allocator.destroy();
     vkDestroyDevice(device, nullptr);
-    DestroyDebugUtilsMessengerEXT(instance, callbacks, nullptr);
-    vkDestroySurfaceKHR(instance, surfaceKhr, nullptr);
+    if (callbacks != VK_NULL_HANDLE) {
+        DestroyDebugUtilsMessengerEXT(instance, callbacks, nullptr);
+    }
+    if (surfaceKhr != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(instance, surfaceKhr, nullptr);
+    }
     vkDestroyInstance(instance, nullptr);
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (window != nullptr) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 }
 
 void App::create_instance() {
@@ -135,15 +278,20 @@ void App::create_instance() {
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.apiVersion = VK_API_VERSION_1_3;
 
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
+    std::vector<const char*> extensions;
+    if (!config.headless) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
 
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
-    extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
     print_instance_extensions();
-    if (!check_validation_layers_support()) {
-        throw std::runtime_error("no validation layers supported");
+    if (config.validation) {
+        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        if (!check_validation_layers_support()) {
+            throw std::runtime_error("no validation layers supported");
+        }
     }
 
 
@@ -152,7 +300,7 @@ void App::create_instance() {
     createInfo.pApplicationInfo = &appInfo;
     createInfo.enabledExtensionCount = extensions.size();
     createInfo.ppEnabledExtensionNames = extensions.data();
-    createInfo.enabledLayerCount = validationLayers.size();
+    createInfo.enabledLayerCount = config.validation ? validationLayers.size() : 0;
     createInfo.ppEnabledLayerNames = validationLayers.data();
 
     if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
@@ -263,14 +411,16 @@ void App::print_instance_device(std::vector<VkPhysicalDevice> devices) {
 
 bool App::is_device_suitable(VkPhysicalDevice device) {
     QueueFamilyIndices indices = find_queue_families(device);
-    bool swapchainAdequate = false;
+    bool swapchainAdequate = config.headless;
 
     VkPhysicalDeviceFeatures deviceFeatures;
     vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
-    SwapChainSupportDetails swapChainSupportDetails =
-            query_swapchain_support(device);
-    swapchainAdequate = !swapChainSupportDetails.formats.empty() && !swapChainSupportDetails.presentMode.empty();
+    if (!config.headless) {
+        SwapChainSupportDetails swapChainSupportDetails =
+                query_swapchain_support(device);
+        swapchainAdequate = !swapChainSupportDetails.formats.empty() && !swapChainSupportDetails.presentMode.empty();
+    }
 
     return indices.is_complete() && check_device_extension_support(device) && swapchainAdequate && deviceFeatures.samplerAnisotropy;
 }
@@ -307,22 +457,55 @@ QueueFamilyIndices App::find_queue_families(VkPhysicalDevice device) {
 
     // print_device_queue_family(queueFamilies);
 
-    int i = 0;
-    for(const auto& queueFamily : queueFamilies) {
+    for (uint32_t i = 0; i < queueFamilyCount; ++i) {
+        const auto& queueFamily = queueFamilies[i];
+        if (queueFamily.queueCount == 0) continue;
+
         VkBool32 presentSupport = false;
+        if (surfaceKhr != VK_NULL_HANDLE) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surfaceKhr, &presentSupport);
+        }
 
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surfaceKhr, &presentSupport);
+        bool graphics = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+        bool compute = queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT;
+        bool transfer = queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT;
 
-        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        // prefer a graphics family that can present as well, it saves an ownership transfer per frame
+        if (graphics && (indices.graphicalFamily == UINT32_MAX || (presentSupport && indices.graphicalFamily != indices.presentFamily))) {
             indices.graphicalFamily = i;
+            if (presentSupport) indices.presentFamily = i;
         }
 
-        if (queueFamily.queueCount > 0 && presentSupport) {
+        if (presentSupport && indices.presentFamily == UINT32_MAX) {
             indices.presentFamily = i;
         }
 
-        if (indices.is_complete()) break;
-        i++;
+        // transfer-only families map to the copy engines that run next to the graphics queue
+        if (transfer && !graphics && !compute && indices.transferFamily == UINT32_MAX) {
+            indices.transferFamily = i;
+        }
+    }
+
+    // culling is recorded into the frame's command buffer, which needs compute on the graphics family
+    if (indices.graphicalFamily != UINT32_MAX && (queueFamilies[indices.graphicalFamily].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+        indices.computeFamily = indices.graphicalFamily;
+    } else {
+        for (uint32_t i = 0; i < queueFamilyCount; ++i) {
+            if (queueFamilies[i].queueCount > 0 && (queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+                indices.computeFamily = i;
+                break;
+            }
+        }
+    }
+
+    // graphics families support transfers implicitly
+    if (indices.transferFamily == UINT32_MAX) {
+        indices.transferFamily = indices.graphicalFamily;
+    }
+
+    // nothing is presented without a surface
+    if (config.headless) {
+        indices.presentFamily = indices.graphicalFamily;
     }
 
     return indices;
@@ -339,28 +522,165 @@ void App::create_logical_device() {
     QueueFamilyIndices indices = find_queue_families(physicalDevice);
     float queuePriority = 1.0f;
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicalFamily, indices.presentFamily};
+    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicalFamily, indices.presentFamily, indices.transferFamily};
 
     for(auto queueFamily : uniqueQueueFamilies) {
         VkDeviceQueueCreateInfo queueCreateInfo = {};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfo.queueFamilyIndex = indices.graphicalFamily;
+        queueCreateInfo.queueFamilyIndex = queueFamily;
         queueCreateInfo.queueCount = 1;
         queueCreateInfo.pQueuePriorities = &queuePriority;
 
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+
+    // secondaries may only run inside an active statistics query when they can inherit it
+    inheritedQueries = uses_secondaries() && supportedFeatures.inheritedQueries;
+    if (uses_secondaries() && !inheritedQueries) {
+        pipelineStatisticsQuery = false;
+    }
+
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsQuery;
+    deviceFeatures.inheritedQueries = inheritedQueries;
+    // cooked textures pick whichever family is there
+    textureCompressionBC = supportedFeatures.textureCompressionBC;
+    textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+    deviceFeatures.textureCompressionBC = textureCompressionBC;
+    deviceFeatures.textureCompressionETC2 = textureCompressionETC2;
+
+    // descriptor indexing is core since 1.2, older devices keep the per-frame texture descriptor
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    bool vulkan12 = deviceProperties.apiVersion >= VK_API_VERSION_1_2;
+    VkPhysicalDeviceVulkan12Features supported12 = {};
+    supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    // present waits only matter to the queued frame limit
+    bool presentExtensions = !config.headless && config.maxQueuedFrames > 0
+                             && has_device_extension(physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME)
+                             && has_device_extension(physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    VkPhysicalDevicePresentIdFeaturesKHR supportedPresentId = {};
+    supportedPresentId.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    VkPhysicalDevicePresentWaitFeaturesKHR supportedPresentWait = {};
+    supportedPresentWait.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    if (presentExtensions) {
+        supported12.pNext = &supportedPresentId;
+        supportedPresentId.pNext = &supportedPresentWait;
+    }
+    bool vulkan13 = deviceProperties.apiVersion >= VK_API_VERSION_1_3;
+    VkPhysicalDeviceVulkan13Features supported13 = {};
+    supported13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    if (vulkan13) {
+        supported13.pNext = supported12.pNext;
+        supported12.pNext = &supported13;
+    }
+    if (vulkan12) {
+        VkPhysicalDeviceFeatures2 features2 = {};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &supported12;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+    }
+    bindless = config.bindless
+               && supported12.runtimeDescriptorArray
+               && supported12.shaderSampledImageArrayNonUniformIndexing
+               && supported12.descriptorBindingSampledImageUpdateAfterBind
+               && supported12.descriptorBindingUpdateUnusedWhilePending
+               && supported12.descriptorBindingPartiallyBound;
+    if (config.bindless && !bindless) {
+        std::cout << "bindless: descriptor indexing not supported, binding textures per frame slot\n";
+    }
+    if (bindless) {
+        // the array is one combined image sampler binding, it counts against both kinds of limit
+        VkPhysicalDeviceVulkan12Properties properties12 = {};
+        properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2 = {};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &properties12;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+        bindlessCapacity = std::min({MAX_BINDLESS_TEXTURES,
+                                     properties12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                     properties12.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                     properties12.maxDescriptorSetUpdateAfterBindSampledImages,
+                                     properties12.maxDescriptorSetUpdateAfterBindSamplers});
+        // the placeholder and the requested texture
+        if (bindlessCapacity < 2) {
+            bindless = false;
+            std::cout << "bindless: update-after-bind limits allow " << bindlessCapacity
+                      << " texture(s), binding textures per frame slot\n";
+        }
+    }
+
+    // culled batches start at their first instance, compacting them needs the draw count on the GPU
+    gpuCulling = config.gpuCulling && indices.computeFamily == indices.graphicalFamily
+                 && supportedFeatures.drawIndirectFirstInstance;
+    if (config.gpuCulling && !gpuCulling) {
+        std::cout << "gpu culling: needs compute on the graphics queue and drawIndirectFirstInstance, disabled\n";
+    }
+    multiDrawIndirect = gpuCulling && supportedFeatures.multiDrawIndirect;
+    drawIndirectCount = multiDrawIndirect && supported12.drawIndirectCount;
+    maxDrawIndirectCount = multiDrawIndirect ? deviceProperties.limits.maxDrawIndirectCount : 1;
+    deviceFeatures.drawIndirectFirstInstance = gpuCulling;
+    deviceFeatures.multiDrawIndirect = multiDrawIndirect;
+
+    VkPhysicalDeviceVulkan12Features enabled12 = {};
+    enabled12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    enabled12.drawIndirectCount = drawIndirectCount;
+    enabled12.runtimeDescriptorArray = bindless;
+    enabled12.shaderSampledImageArrayNonUniformIndexing = bindless;
+    enabled12.descriptorBindingSampledImageUpdateAfterBind = bindless;
+    enabled12.descriptorBindingUpdateUnusedWhilePending = bindless;
+    enabled12.descriptorBindingPartiallyBound = bindless;
+    // one counter for frames and uploads instead of a fence per submission
+    timelineSemaphores = config.timelineSemaphores && supported12.timelineSemaphore;
+    enabled12.timelineSemaphore = timelineSemaphores;
+
+    presentWait = vulkan12 && presentExtensions && supportedPresentId.presentId && supportedPresentWait.presentWait;
+    VkPhysicalDevicePresentIdFeaturesKHR enabledPresentId = {};
+    enabledPresentId.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    enabledPresentId.presentId = VK_TRUE;
+    VkPhysicalDevicePresentWaitFeaturesKHR enabledPresentWait = {};
+    enabledPresentWait.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    enabledPresentWait.presentWait = VK_TRUE;
+    if (presentWait) {
+        deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        enabled12.pNext = &enabledPresentId;
+        enabledPresentId.pNext = &enabledPresentWait;
+    }
+
+    dynamicRendering = config.renderPath == RenderPath::Dynamic && vulkan13
+                       && supported13.dynamicRendering && supported13.synchronization2;
+    VkPhysicalDeviceVulkan13Features enabled13 = {};
+    enabled13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    enabled13.dynamicRendering = VK_TRUE;
+    enabled13.synchronization2 = VK_TRUE;
+    if (dynamicRendering) {
+        enabled13.pNext = enabled12.pNext;
+        enabled12.pNext = &enabled13;
+    }
+    if (config.renderPath == RenderPath::Dynamic) {
+        std::cout << (dynamicRendering ? "render path: dynamic rendering\n"
+                                       : "render path: dynamic rendering needs Vulkan 1.3 with dynamicRendering and synchronization2, using the render pass\n");
+    }
+    if (config.maxQueuedFrames > 0 && !config.headless) {
+        std::cout << "queued frame limit: " << config.maxQueuedFrames
+                  << (presentWait ? " (present wait)" : " (fences, VK_KHR_present_wait not supported)") << "\n";
+    }
+
     VkDeviceCreateInfo createInfo = {};
+    createInfo.pNext = vulkan12 ? &enabled12 : nullptr;
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.queueCreateInfoCount = queueCreateInfos.size();
     createInfo.pEnabledFeatures = &deviceFeatures;
     createInfo.enabledExtensionCount = deviceExtensions.size();
     createInfo.ppEnabledExtensionNames = deviceExtensions.data();
-    createInfo.enabledLayerCount = validationLayers.size();
+    createInfo.enabledLayerCount = config.validation ? validationLayers.size() : 0;
     createInfo.ppEnabledLayerNames = validationLayers.data();
 
     if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
@@ -369,6 +689,31 @@ void App::create_logical_device() {
 
     vkGetDeviceQueue(device, indices.graphicalFamily, 0, &graphicsQueue);
     vkGetDeviceQueue(device, indices.presentFamily, 0, &presentQueue);
+    vkGetDeviceQueue(device, indices.transferFamily, 0, &transferQueue);
+
+    if (presentWait) {
+        waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+        presentWait = waitForPresent != nullptr;
+    }
+
+    timeline.init(device, timelineSemaphores);
+    deletionQueue.init(device, allocator, timeline);
+    std::cout << "gpu sync: " << (timelineSemaphores ? "timeline semaphore" : "fences") << "\n";
+}
+
+void App::create_upload_queue() {
+    QueueFamilyIndices indices = find_queue_families(physicalDevice);
+
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    uploadQueue.init(device, allocator, timeline,
+                     indices.graphicalFamily, graphicsQueue,
+                     indices.transferFamily, transferQueue,
+                     16 * 1024 * 1024, properties.limits.optimalBufferCopyOffsetAlignment);
+
+    std::cout << "upload queue family: " << indices.transferFamily
+              << (uploadQueue.uses_dedicated_transfer_queue() ? " (dedicated transfer)" : " (graphics)") << "\n";
 }
 
 void App::crete_surface() {
@@ -377,6 +722,17 @@ void App::crete_surface() {
     }
 }
 
+bool App::has_device_extension(VkPhysicalDevice device, const char* name) {
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, name) == 0) return true;
+    }
+    return false;
+}
+
 bool App::check_device_extension_support(VkPhysicalDevice device) {
     uint32_t extensionCount = 0;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -424,9 +780,27 @@ VkSurfaceFormatKHR App::choose_swapchain_format(const std::vector<VkSurfaceForma
     return availableFormats[0];
 }
 
+static const char* present_mode_name(VkPresentModeKHR mode) {
+    switch (mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo-relaxed";
+        default: return "unknown";
+    }
+}
+
 VkPresentModeKHR App::choose_present_mode(const std::vector<VkPresentModeKHR> &availablePresentModes) {
+    VkPresentModeKHR wanted = VK_PRESENT_MODE_MAILBOX_KHR;
+    switch (config.presentMode) {
+        case PresentMode::Auto: wanted = VK_PRESENT_MODE_MAILBOX_KHR; break;
+        case PresentMode::Fifo: wanted = VK_PRESENT_MODE_FIFO_KHR; break;
+        case PresentMode::FifoRelaxed: wanted = VK_PRESENT_MODE_FIFO_RELAXED_KHR; break;
+        case PresentMode::Mailbox: wanted = VK_PRESENT_MODE_MAILBOX_KHR; break;
+        case PresentMode::Immediate: wanted = VK_PRESENT_MODE_IMMEDIATE_KHR; break;
+    }
     for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+        if (availablePresentMode == wanted) {
             return availablePresentMode;
         }
     }
@@ -454,7 +828,12 @@ VkExtent2D App::choose_swapchain_extent(const VkSurfaceCapabilitiesKHR &capabili
     return actualExtent;
 }
 
-void App::create_swapchain() {
+void App::create_swapchain(VkSwapchainKHR oldSwapchain) {
+    if (config.headless) {
+        create_offscreen_targets();
+        return;
+    }
+
     SwapChainSupportDetails swapChainSupportDetails = query_swapchain_support(physicalDevice);
 
     VkSurfaceFormatKHR surfaceFormatKhr = choose_swapchain_format(swapChainSupportDetails.formats);
@@ -491,7 +870,7 @@ void App::create_swapchain() {
     createInfoKhr.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfoKhr.presentMode = presentModeKhr;
     createInfoKhr.clipped = VK_TRUE;
-    createInfoKhr.oldSwapchain = VK_NULL_HANDLE;
+    createInfoKhr.oldSwapchain = oldSwapchain;
 
     if (vkCreateSwapchainKHR(device, &createInfoKhr, nullptr, &swapchainKhr) != VK_SUCCESS) {
         throw std::runtime_error("failed to create swapchain");
@@ -499,9 +878,128 @@ void App::create_swapchain() {
 
     swapchainImageFormat = surfaceFormatKhr.format;
     swapchainExtent = extent2D;
+    presentMode = presentModeKhr;
+    swapchainFirstPresentId = presentId + 1;
+    if (oldSwapchain == VK_NULL_HANDLE) {
+        std::cout << "present mode: " << present_mode_name(presentMode) << "\n";
+    }
     vkGetSwapchainImagesKHR(device, swapchainKhr, &imageCount, nullptr);
     swapchainImages.resize(imageCount);
     vkGetSwapchainImagesKHR(device, swapchainKhr, &imageCount, swapchainImages.data());
+
+    imagesInFlight.assign(imageCount, 0);
+}
+
+void App::create_offscreen_targets() {
+    swapchainImageFormat = find_supported_format(
+            {VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB},
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT);
+    swapchainExtent = {config.width, config.height};
+
+    swapchainImages.resize(frames.size());
+    offscreenImageAllocations.resize(frames.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        create_image(swapchainExtent.width, swapchainExtent.height,
+                     swapchainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+                     VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     swapchainImages[i], offscreenImageAllocations[i]);
+    }
+
+    imagesInFlight.assign(swapchainImages.size(), 0);
+}
+
+VkImageLayout App::color_final_layout() const {
+    // offscreen targets are left ready to be copied out
+    return config.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
+
+void App::save_frame(const std::string& path, uint32_t imageIndex) {
+    VkDeviceSize size = (VkDeviceSize) swapchainExtent.width * swapchainExtent.height * 4;
+
+    VkBuffer readbackBuffer;
+    Allocation readbackAllocation;
+    create_buffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  readbackBuffer, readbackAllocation);
+
+    VkCommandBufferAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandPool = commandPool;
+    allocateInfo.commandBufferCount = 1;
+
+    VkCommandBuffer vkCommandBuffer;
+    vkAllocateCommandBuffers(device, &allocateInfo, &vkCommandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(vkCommandBuffer, &beginInfo);
+
+    VkImageMemoryBarrier imageBarrier = {};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.oldLayout = color_final_layout();
+    imageBarrier.newLayout = color_final_layout();
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = swapchainImages[imageIndex];
+    imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(vkCommandBuffer,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+    VkBufferImageCopy bufferImageCopy = {};
+    bufferImageCopy.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    bufferImageCopy.imageExtent = {swapchainExtent.width, swapchainExtent.height, 1};
+    vkCmdCopyImageToBuffer(vkCommandBuffer, swapchainImages[imageIndex], color_final_layout(),
+                           readbackBuffer, 1, &bufferImageCopy);
+
+    VkBufferMemoryBarrier bufferBarrier = {};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = readbackBuffer;
+    bufferBarrier.size = size;
+    vkCmdPipelineBarrier(vkCommandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+    vkEndCommandBuffer(vkCommandBuffer);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &vkCommandBuffer;
+    timeline.wait(timeline.submit(graphicsQueue, submitInfo));
+    vkFreeCommandBuffers(device, commandPool, 1, &vkCommandBuffer);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("failed to open " + path);
+    file << "P6\n" << swapchainExtent.width << " " << swapchainExtent.height << "\n255\n";
+
+    bool bgra = swapchainImageFormat == VK_FORMAT_B8G8R8A8_SRGB;
+    auto pixels = static_cast<const uint8_t*>(readbackAllocation.mapped);
+    std::vector<char> row(swapchainExtent.width * 3);
+    for (uint32_t y = 0; y < swapchainExtent.height; ++y) {
+        for (uint32_t x = 0; x < swapchainExtent.width; ++x) {
+            const uint8_t* pixel = pixels + ((size_t) y * swapchainExtent.width + x) * 4;
+            row[x * 3 + 0] = bgra ? pixel[2] : pixel[0];
+            row[x * 3 + 1] = pixel[1];
+            row[x * 3 + 2] = bgra ? pixel[0] : pixel[2];
+        }
+        file.write(row.data(), row.size());
+    }
+    std::cout << "wrote " << path << "\n";
+
+    vkDestroyBuffer(device, readbackBuffer, nullptr);
+    allocator.free(readbackAllocation);
 }
 
 void App::create_image_view() {
@@ -524,11 +1022,9 @@ std::vector<char> App::readFile(const std::string &filename) {
 }
 
 void App::create_graphics_pipeline() {
-    auto vertexShaderCode = readFile(SHADER_PATH "../shader/shader.vert.spv");
-    auto fragShaderCode = readFile(SHADER_PATH "../shader/shader.frag.spv");
-
-    VkShaderModule vertexShaderModule = create_shader_module(vertexShaderCode);
-    VkShaderModule fragShaderModule = create_shader_module(fragShaderCode);
+    VkShaderModule vertexShaderModule = load_shader_module("shader.vert.spv");
+    // the bindless variant indexes the texture array of set 1 instead of reading binding 1
+    VkShaderModule fragShaderModule = load_shader_module(bindless ? "shader_bindless.frag.spv" : "shader.frag.spv");
 
 
     VkPipelineShaderStageCreateInfo vertexShaderStageCreateInfo = {};
@@ -537,6 +1033,19 @@ void App::create_graphics_pipeline() {
     vertexShaderStageCreateInfo.module = vertexShaderModule;
     vertexShaderStageCreateInfo.pName = "main";
 
+    // constant_id 0 of shader.vert selects the normal decode, 1 where the transforms come from
+    std::array<uint32_t, 2> specializationData = {
+            vertexLayout.normal == NormalEncoding::Octahedral16,
+            static_cast<uint32_t>(config.transformPath)
+    };
+    std::array<VkSpecializationMapEntry, 2> specializationEntries = {{
+            {0, 0, sizeof(uint32_t)},
+            {1, sizeof(uint32_t), sizeof(uint32_t)}
+    }};
+    VkSpecializationInfo specializationInfo = {specializationEntries.size(), specializationEntries.data(),
+                                               sizeof(specializationData), specializationData.data()};
+    vertexShaderStageCreateInfo.pSpecializationInfo = &specializationInfo;
+
     VkPipelineShaderStageCreateInfo fragShaderStageCreateInfo = {};
     fragShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragShaderStageCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -553,13 +1062,17 @@ void App::create_graphics_pipeline() {
     dynamicStateCreateInfo.dynamicStateCount = dynamicStates.size();
     dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
 
-    auto bindingDescriptions = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {
+            vertex_binding_description(vertexLayout, 0),
+            InstanceData::getBindingDescription()
+    };
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions = vertex_attribute_descriptions(vertexLayout, 0);
+    for (const auto& attribute : InstanceData::getAttributeDescriptions()) attributeDescriptions.push_back(attribute);
 
     VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {};
     vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
-    vertexInputStateCreateInfo.pVertexBindingDescriptions = &bindingDescriptions;
+    vertexInputStateCreateInfo.vertexBindingDescriptionCount = bindingDescriptions.size();
+    vertexInputStateCreateInfo.pVertexBindingDescriptions = bindingDescriptions.data();
     vertexInputStateCreateInfo.vertexAttributeDescriptionCount = attributeDescriptions.size();
     vertexInputStateCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -626,8 +1139,13 @@ void App::create_graphics_pipeline() {
 
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
     pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutCreateInfo.setLayoutCount = 1;
-    pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayout;
+    std::array<VkDescriptorSetLayout, 2> setLayouts = {descriptorSetLayout, bindlessTextures.get_layout()};
+    pipelineLayoutCreateInfo.setLayoutCount = bindless ? 2 : 1;
+    pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
+    // shader.vert declares the block in both transform paths
+    VkPushConstantRange pushConstantRange = {VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ObjectTransforms)};
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 
     if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create pipeline layout");
@@ -652,19 +1170,92 @@ void App::create_graphics_pipeline() {
     pipelineCreateInfo.renderPass = renderPass;
     pipelineCreateInfo.pDepthStencilState = &depthStencilStateCreateInfo;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+    // without a render pass the pipeline only learns the attachment formats
+    VkPipelineRenderingCreateInfo renderingCreateInfo = {};
+    renderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingCreateInfo.colorAttachmentCount = 1;
+    renderingCreateInfo.pColorAttachmentFormats = &swapchainImageFormat;
+    renderingCreateInfo.depthAttachmentFormat = depthFormat;
+    if (dynamicRendering) {
+        pipelineCreateInfo.pNext = &renderingCreateInfo;
+    }
+
+    auto pipelineStart = std::chrono::steady_clock::now();
+    if (vkCreateGraphicsPipelines(device, pipelineCache.handle(), 1, &pipelineCreateInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline");
     }
+    pipelineCreationMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count();
 
     vkDestroyShaderModule(device, vertexShaderModule, nullptr);
     vkDestroyShaderModule(device, fragShaderModule, nullptr);
 }
 
-VkShaderModule App::create_shader_module(const std::vector<char>& code) {
+void App::create_compute_pipeline() {
+    VkShaderModule computeShaderModule = load_shader_module("cull.comp.spv");
+
+    VkPushConstantRange pushConstantRange = {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullParameters)};
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.setLayoutCount = 1;
+    pipelineLayoutCreateInfo.pSetLayouts = &cullSetLayout;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling pipeline layout");
+    }
+
+    // constant_id 0 selects the pass, 1 whether the draw list is compacted
+    std::array<VkSpecializationMapEntry, 2> specializationEntries = {{
+            {0, 0, sizeof(uint32_t)},
+            {1, sizeof(uint32_t), sizeof(uint32_t)}
+    }};
+    std::array<std::array<uint32_t, 2>, 2> specializationData = {{
+            {0, drawIndirectCount},
+            {1, drawIndirectCount}
+    }};
+    std::array<VkSpecializationInfo, 2> specializationInfos;
+    std::array<VkComputePipelineCreateInfo, 2> pipelineCreateInfos = {};
+    for (size_t pass = 0; pass < pipelineCreateInfos.size(); ++pass) {
+        specializationInfos[pass] = {specializationEntries.size(), specializationEntries.data(),
+                                     sizeof(specializationData[pass]), specializationData[pass].data()};
+
+        pipelineCreateInfos[pass].sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineCreateInfos[pass].stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineCreateInfos[pass].stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineCreateInfos[pass].stage.module = computeShaderModule;
+        pipelineCreateInfos[pass].stage.pName = "main";
+        pipelineCreateInfos[pass].stage.pSpecializationInfo = &specializationInfos[pass];
+        pipelineCreateInfos[pass].layout = cullPipelineLayout;
+    }
+
+    std::array<VkPipeline, 2> pipelines;
+    auto pipelineStart = std::chrono::steady_clock::now();
+    if (vkCreateComputePipelines(device, pipelineCache.handle(), pipelineCreateInfos.size(), pipelineCreateInfos.data(),
+                                 nullptr, pipelines.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling pipelines");
+    }
+    pipelineCreationMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count();
+    cullPipeline = pipelines[0];
+    cullCompactPipeline = pipelines[1];
+
+    vkDestroyShaderModule(device, computeShaderModule, nullptr);
+}
+
+VkShaderModule App::load_shader_module(const std::string& name) {
+    // archive payloads are aligned, SPIR-V words can be read from the mapping in place
+    if (assets.is_open()) {
+        AssetView code = assets.view(name, config.validation);
+        return create_shader_module(code.data, code.size);
+    }
+    auto code = readFile(SHADER_PATH "../shader/" + name);
+    return create_shader_module(code.data(), code.size());
+}
+
+VkShaderModule App::create_shader_module(const void* code, size_t size) {
     VkShaderModuleCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    createInfo.codeSize = size;
+    createInfo.pCode = static_cast<const uint32_t*>(code);
 
     VkShaderModule shaderModule;
     if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
@@ -676,6 +1267,8 @@ VkShaderModule App::create_shader_module(const std::vector<char>& code) {
 }
 
 void App::create_render_pass() {
+    if (dynamicRendering) return;
+
     VkAttachmentDescription attachmentDescription = {};
     attachmentDescription.format = swapchainImageFormat;
     attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -684,7 +1277,7 @@ void App::create_render_pass() {
     attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    attachmentDescription.finalLayout = color_final_layout();
 
     VkAttachmentDescription depthAttachment = {};
     depthAttachment.format = find_depth_format();
@@ -746,7 +1339,8 @@ void App::create_render_pass() {
 }
 
 void App::create_frame_buffers() {
-
+    // dynamic rendering attaches the image views directly
+    if (dynamicRendering) return;
 
     swapchainFrameBuffers.resize(swapchainImageViews.size());
     for (size_t i = 0; i < swapchainImageViews.size(); ++i) {
@@ -784,20 +1378,219 @@ void App::create_command_pool() {
 }
 
 void App::create_command_buffer() {
-    commandBuffer.resize(MAX_FRAME_IN_FLIGHT);
+    std::vector<VkCommandBuffer> commandBuffers(frames.size());
 
     VkCommandBufferAllocateInfo allocateInfo = {};
     allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocateInfo.commandPool = commandPool;
     allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocateInfo.commandBufferCount = commandBuffer.size();
+    allocateInfo.commandBufferCount = commandBuffers.size();
 
-    if (vkAllocateCommandBuffers(device, &allocateInfo, commandBuffer.data()) != VK_SUCCESS) {
+    if (vkAllocateCommandBuffers(device, &allocateInfo, commandBuffers.data()) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate command buffer");
     }
+
+    for (size_t i = 0; i < frames.size(); ++i) {
+        frames[i].commandBuffer = commandBuffers[i];
+    }
 }
 
-void App::record_command_buffer(VkCommandBuffer vkCommandBuffer, uint32_t imageIndex) {
+void App::create_record_pools() {
+    if (!uses_secondaries()) return;
+
+    QueueFamilyIndices indices = find_queue_families(physicalDevice);
+
+    // pools are never shared between threads, every buffer of a pool is recycled by one reset
+    VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = indices.graphicalFamily;
+
+    for (auto& frame : frames) {
+        frame.recordPools.resize(jobs.worker_count());
+        for (auto& recordPool : frame.recordPools) {
+            if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &recordPool.commandPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create recording command pool");
+            }
+        }
+    }
+    std::cout << "recording secondary command buffers on " << jobs.worker_count() << " thread(s)\n";
+}
+
+void App::destroy_record_pools() {
+    for (auto& frame : frames) {
+        for (auto& recordPool : frame.recordPools) {
+            vkDestroyCommandPool(device, recordPool.commandPool, nullptr);
+        }
+        frame.recordPools.clear();
+    }
+}
+
+uint32_t App::draw_count() const {
+    if (draws_per_object()) return sceneObjects.size();
+    // the GPU decides how many batches survive, one indirect count draw covers all of them
+    if (gpuCulling && drawIndirectCount) return 1;
+    return batch_count();
+}
+
+uint32_t App::batch_count() const {
+    uint32_t instanceCount = sceneObjects.size();
+    if (config.drawBatchSize == 0 || config.drawBatchSize >= instanceCount) return 1;
+    return (instanceCount + config.drawBatchSize - 1) / config.drawBatchSize;
+}
+
+uint32_t App::batch_size() const {
+    return batch_count() == 1 ? sceneObjects.size() : config.drawBatchSize;
+}
+
+void App::record_draws(VkCommandBuffer vkCommandBuffer, const FrameContext& frame, uint32_t firstDraw, uint32_t drawCount) {
+    vkCmdBindPipeline(vkCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+
+    // culled instances come compacted from the culling pass
+    VkBuffer vertexBuffers[] = {vertexBuffer, gpuCulling ? frame.visibleInstanceBuffer : frame.instanceBuffer};
+    VkDeviceSize offsets[] = {0, 0};
+    vkCmdBindVertexBuffers(vkCommandBuffer, 0, 2, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(vkCommandBuffer, indexBuffer, 0, indexType);
+
+    VkViewport viewport{
+            0.0f, 0.0f,
+            static_cast<float>(swapchainExtent.width), static_cast<float>(swapchainExtent.height),
+            0.0f, 1.0f
+    };
+    vkCmdSetViewport(vkCommandBuffer, 0, 1, &viewport);
+    VkRect2D scissor{
+            {0, 0}, swapchainExtent
+    };
+
+    vkCmdSetScissor(vkCommandBuffer, 0, 1, &scissor);
+
+    // camera and object uniforms both live in the ring, binding 2 is only read on the uniform path.
+    // The bindless texture array rides along in the same call and serves every material
+    uint32_t dynamicOffsets[] = {frame.cameraOffset, frame.objectOffset};
+    std::array<VkDescriptorSet, 2> descriptorSets = {frame.descriptorSet, bindlessTextures.get_set()};
+    vkCmdBindDescriptorSets(vkCommandBuffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            pipelineLayout,
+                            0,
+                            bindless ? 2 : 1,
+                            descriptorSets.data(),
+                            2,
+                            dynamicOffsets);
+
+    if (config.transformPath == TransformPath::Uniform) {
+        // the same set again, only the object offset moves
+        uint32_t objectStride = uniformRing.aligned_size(sizeof(ObjectTransforms));
+        for (uint32_t draw = firstDraw; draw < firstDraw + drawCount; ++draw) {
+            dynamicOffsets[1] = frame.objectOffset + draw * objectStride;
+            vkCmdBindDescriptorSets(vkCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                                    0, 1, &frame.descriptorSet, 2, dynamicOffsets);
+            vkCmdDrawIndexed(vkCommandBuffer, indexCount, 1, 0, 0, draw);
+        }
+        return;
+    }
+    if (config.transformPath == TransformPath::Push) {
+        ObjectTransforms object;
+        for (uint32_t draw = firstDraw; draw < firstDraw + drawCount; ++draw) {
+            object.model = objectTransforms[draw];
+            object.mvp = viewProj * object.model;
+            vkCmdPushConstants(vkCommandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(object), &object);
+            vkCmdDrawIndexed(vkCommandBuffer, indexCount, 1, 0, 0, draw);
+        }
+        return;
+    }
+
+    if (gpuCulling) {
+        uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        if (drawIndirectCount) {
+            // create_culling_resources keeps the batch count within maxDrawIndirectCount
+            vkCmdDrawIndexedIndirectCount(vkCommandBuffer, frame.indirectBuffer, 0, frame.cullCountBuffer, 0,
+                                          std::min(batch_count(), maxDrawIndirectCount), stride);
+        } else {
+            for (uint32_t draw = firstDraw; draw < firstDraw + drawCount; draw += maxDrawIndirectCount) {
+                vkCmdDrawIndexedIndirect(vkCommandBuffer, frame.indirectBuffer, draw * stride,
+                                         std::min(maxDrawIndirectCount, firstDraw + drawCount - draw), stride);
+            }
+        }
+        return;
+    }
+
+    uint32_t instanceCount = sceneObjects.size();
+    uint32_t batchSize = batch_size();
+    for (uint32_t draw = firstDraw; draw < firstDraw + drawCount; ++draw) {
+        uint32_t firstInstance = draw * batchSize;
+        vkCmdDrawIndexed(vkCommandBuffer, indexCount, std::min(batchSize, instanceCount - firstInstance),
+                         0, 0, firstInstance);
+    }
+}
+
+void App::record_secondaries(FrameContext& frame, uint32_t imageIndex) {
+    // the slot is idle, nothing recorded from these pools is in use any more
+    for (auto& recordPool : frame.recordPools) {
+        vkResetCommandPool(device, recordPool.commandPool, 0);
+        recordPool.used = 0;
+    }
+
+    // a few more jobs than threads so one slow thread does not hold up the whole frame
+    uint32_t drawCount = draw_count();
+    uint32_t jobCount = std::min(drawCount, jobs.worker_count() * 2);
+    frame.secondaryCommandBuffers.resize(jobCount);
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = dynamicRendering ? VK_NULL_HANDLE : swapchainFrameBuffers[imageIndex];
+    inheritanceInfo.pipelineStatistics = inheritedQueries ? profiler.statistics_flags() : 0;
+
+    VkCommandBufferInheritanceRenderingInfo inheritanceRenderingInfo = {};
+    inheritanceRenderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    inheritanceRenderingInfo.colorAttachmentCount = 1;
+    inheritanceRenderingInfo.pColorAttachmentFormats = &swapchainImageFormat;
+    inheritanceRenderingInfo.depthAttachmentFormat = depthFormat;
+    inheritanceRenderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    if (dynamicRendering) {
+        inheritanceInfo.pNext = &inheritanceRenderingInfo;
+    }
+
+    jobs.run(jobCount, [&](uint32_t job, uint32_t worker) {
+        RecordPool& recordPool = frame.recordPools[worker];
+        if (recordPool.used == recordPool.commandBuffers.size()) {
+            VkCommandBufferAllocateInfo allocateInfo = {};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocateInfo.commandPool = recordPool.commandPool;
+            allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocateInfo.commandBufferCount = 1;
+
+            VkCommandBuffer commandBuffer;
+            if (vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate secondary command buffer");
+            }
+            recordPool.commandBuffers.push_back(commandBuffer);
+        }
+        VkCommandBuffer commandBuffer = recordPool.commandBuffers[recordPool.used++];
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording secondary command buffer");
+        }
+
+        uint32_t firstDraw = drawCount * job / jobCount;
+        uint32_t lastDraw = drawCount * (job + 1) / jobCount;
+        record_draws(commandBuffer, frame, firstDraw, lastDraw - firstDraw);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record secondary command buffer");
+        }
+        frame.secondaryCommandBuffers[job] = commandBuffer;
+    });
+}
+
+void App::record_command_buffer(FrameContext& frame, uint32_t imageIndex) {
+    VkCommandBuffer vkCommandBuffer = frame.commandBuffer;
+
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = 0;
@@ -815,63 +1608,139 @@ void App::record_command_buffer(VkCommandBuffer vkCommandBuffer, uint32_t imageI
     renderPassBeginInfo.renderArea = {{0, 0}, swapchainExtent};
     renderPassBeginInfo.clearValueCount = clearValues.size();
     renderPassBeginInfo.pClearValues = clearValues.data();
+
+    VkRenderingAttachmentInfo colorAttachment = {};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    colorAttachment.imageView = swapchainImageViews[imageIndex];
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.clearValue = clearValues[0];
+    VkRenderingAttachmentInfo depthAttachment = {};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    depthAttachment.imageView = depthImageView;
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.clearValue = clearValues[1];
+    VkRenderingInfo renderingInfo = {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    renderingInfo.flags = uses_secondaries() ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+    renderingInfo.renderArea = {{0, 0}, swapchainExtent};
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    renderingInfo.pDepthAttachment = &depthAttachment;
+
+        if (uses_secondaries()) {
+            record_secondaries(frame, imageIndex);
+        }
+
         if (vkBeginCommandBuffer(vkCommandBuffer, &beginInfo) != VK_SUCCESS) {
             throw std::runtime_error("failed to begin recording command buffer");
         }
-        vkCmdBeginRenderPass(vkCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(vkCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-
-
-        VkBuffer vertexBuffers[] = {vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(vkCommandBuffer, 0, 1, vertexBuffers, offsets);
-        vkCmdBindIndexBuffer(vkCommandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
-
-        VkViewport viewport{
-                0.0f, 0.0f,
-                static_cast<float>(swapchainExtent.width), static_cast<float>(swapchainExtent.height),
-                0.0f, 1.0f
-        };
-        vkCmdSetViewport(vkCommandBuffer, 0, 1, &viewport);
-        VkRect2D scissor{
-                {0, 0}, swapchainExtent
-        };
-
-        vkCmdSetScissor(vkCommandBuffer, 0, 1, &scissor);
+        profiler.begin_frame(vkCommandBuffer, currentFrame, frame.benchmarkSample);
+        profiler.begin_scope(vkCommandBuffer, "frame");
+        if (gpuCulling) {
+            profiler.begin_scope(vkCommandBuffer, "culling");
+            record_culling(vkCommandBuffer, frame);
+            profiler.end_scope(vkCommandBuffer);
+        }
+        profiler.begin_scope(vkCommandBuffer, "render pass");
+        profiler.begin_statistics(vkCommandBuffer);
+
+        if (dynamicRendering) {
+            record_attachment_barriers(vkCommandBuffer, imageIndex, true);
+            vkCmdBeginRendering(vkCommandBuffer, &renderingInfo);
+        } else {
+            vkCmdBeginRenderPass(vkCommandBuffer, &renderPassBeginInfo,
+                                 uses_secondaries() ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+        }
 
-        vkCmdBindDescriptorSets(vkCommandBuffer, 
-                                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                pipelineLayout, 
-                                0,
-                                1,
-                                &descriptorSets[imageIndex],
-                                0,
-                                nullptr);
-        
-        vkCmdDrawIndexed(vkCommandBuffer, indices.size(), 1, 0, 0, 0);
+        if (uses_secondaries()) {
+            // secondary contents only allow vkCmdExecuteCommands, no timestamps in between
+            vkCmdExecuteCommands(vkCommandBuffer, frame.secondaryCommandBuffers.size(), frame.secondaryCommandBuffers.data());
+        } else {
+            profiler.begin_scope(vkCommandBuffer, "draws");
+            record_draws(vkCommandBuffer, frame, 0, draw_count());
+            profiler.end_scope(vkCommandBuffer);
+        }
 
-        vkCmdEndRenderPass(vkCommandBuffer);
+        if (dynamicRendering) {
+            vkCmdEndRendering(vkCommandBuffer);
+            record_attachment_barriers(vkCommandBuffer, imageIndex, false);
+        } else {
+            vkCmdEndRenderPass(vkCommandBuffer);
+        }
+        profiler.end_statistics(vkCommandBuffer);
+        profiler.end_scope(vkCommandBuffer);
+        profiler.end_scope(vkCommandBuffer);
+        profiler.end_frame(vkCommandBuffer);
 
         if (vkEndCommandBuffer(vkCommandBuffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer!");
         }
 }
 
+void App::record_attachment_barriers(VkCommandBuffer commandBuffer, uint32_t imageIndex, bool beforeRendering) {
+    std::array<VkImageMemoryBarrier2, 2> barriers = {};
+    VkImageMemoryBarrier2& color = barriers[0];
+    color.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    color.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    color.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    color.image = swapchainImages[imageIndex];
+    color.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    if (beforeRendering) {
+        // the previous contents are cleared anyway; the acquire semaphore is waited on at color
+        // attachment output, so starting the transition there orders it after the acquire
+        color.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        color.srcAccessMask = VK_ACCESS_2_NONE;
+        color.dstStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        color.dstAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+        color.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        color.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        // every slot shares the depth image, the previous frame's depth writes have to be done
+        VkImageMemoryBarrier2& depth = barriers[1];
+        depth.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        depth.srcStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+        depth.srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        depth.dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+        depth.dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        depth.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depth.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depth.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        depth.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        depth.image = depthImage;
+        VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+        if (has_stencil_component(depthFormat)) depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+        depth.subresourceRange = {depthAspect, 0, 1, 0, 1};
+    } else {
+        // presentation (or the readback's own barrier) picks it up after the submission
+        color.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        color.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+        color.dstStageMask = config.headless ? VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT : VK_PIPELINE_STAGE_2_NONE;
+        color.dstAccessMask = VK_ACCESS_2_NONE;
+        color.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        color.newLayout = color_final_layout();
+    }
+
+    VkDependencyInfo dependencyInfo = {};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.imageMemoryBarrierCount = beforeRendering ? 2 : 1;
+    dependencyInfo.pImageMemoryBarriers = barriers.data();
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
 void App::create_sync_objects() {
-    imageAvailableSemaphore.resize(MAX_FRAME_IN_FLIGHT);
-    renderFinishedSemaphore.resize(MAX_FRAME_IN_FLIGHT);
-    inFlightFence.resize(MAX_FRAME_IN_FLIGHT);
+    // swapchains only take binary semaphores, the slots themselves are tracked on the timeline
     VkSemaphoreCreateInfo semaphoreCreateInfo = {};
     semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceCreateInfo = {};
-    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-    for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; ++i) {
-        if (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &imageAvailableSemaphore[i]) != VK_SUCCESS
-            || vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr,  &renderFinishedSemaphore[i]) != VK_SUCCESS
-            || vkCreateFence(device, &fenceCreateInfo, nullptr, &inFlightFence[i]) != VK_SUCCESS) {
+    for (auto& frame : frames) {
+        if (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &frame.imageAvailableSemaphore) != VK_SUCCESS
+            || vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr,  &frame.renderFinishedSemaphore) != VK_SUCCESS) {
 
             throw std::runtime_error("failed to crate semaphores");
         }
@@ -881,91 +1750,271 @@ void App::create_sync_objects() {
 }
 
 void App::drawFrame() {
+    double stageStart = now_ms();
+    int64_t sample = benchmark.begin_frame(stageStart);
+    auto end_stage = [&](FrameStage stage) {
+        double now = now_ms();
+        benchmark.record_stage(sample, stage, now - stageStart);
+        stageStart = now;
+    };
 
-    uint32_t currentFrame = 0;
-    vkWaitForFences(device, 1, &inFlightFence[currentFrame], VK_TRUE, UINT64_MAX);
+    if (swapchainOutOfDate) {
+        recreate_swapchain(sample);
+        if (swapchainOutOfDate) {
+            benchmark.end_frame(sample, now_ms());
+            return;
+        }
+    }
 
-    uint32_t imageIndex;
-    auto result = vkAcquireNextImageKHR(device, swapchainKhr, UINT64_MAX, imageAvailableSemaphore[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    pace_frame();
+    end_stage(FrameStage::Pace);
 
-    update_uniform_buffer(imageIndex);
+    // only this slot's previous submission has to be finished, the other slots keep the GPU busy
+    FrameContext& frame = frames[currentFrame];
+    timeline.wait(frame.timelineValue);
+    deletionQueue.collect();
+    collect_gpu_results(currentFrame);
+    uploadQueue.collect();
+    for (double ms : uploadQueue.take_gpu_times()) {
+        profiler.add_sample("uploads", ms);
+    }
+    // the slot is idle, so its materials and descriptor set can pick up a texture that just arrived
+    poll_textures(false);
+    update_material_buffer(frame);
+    if (!bindless && frame.boundTextureView != current_texture_view()) {
+        update_texture_descriptor(frame);
+    }
+    end_stage(FrameStage::Wait);
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-        recreate_swapchain();
-        return;
-    } else if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-        throw std::runtime_error("failed to acquire swapchain image");
+    uint32_t imageIndex;
+    VkResult result;
+    if (config.headless) {
+        // every slot owns its offscreen target
+        imageIndex = currentFrame;
+    } else {
+        result = vkAcquireNextImageKHR(device, swapchainKhr, UINT64_MAX, frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            recreate_swapchain(sample);
+            benchmark.end_frame(sample, now_ms());
+            return;
+        } else if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            throw std::runtime_error("failed to acquire swapchain image");
+        }
     }
 
-    vkResetFences(device, 1, &inFlightFence[currentFrame]);
-    vkResetCommandBuffer(commandBuffer[currentFrame], 0);
-    record_command_buffer(commandBuffer[currentFrame], imageIndex);
+    // the swapchain can hand out an image that an other slot is still rendering into
+    timeline.wait(imagesInFlight[imageIndex]);
+    end_stage(FrameStage::Acquire);
+
+    update_uniform_buffer(frame);
+    update_instance_buffer(frame);
+    uniformRing.flush();
+    end_stage(FrameStage::Uniform);
+
+    frame.benchmarkSample = sample;
+
+    vkResetCommandBuffer(frame.commandBuffer, 0);
+    record_command_buffer(frame, imageIndex);
+    end_stage(FrameStage::Record);
 
     VkSemaphore waitSemaphores[] = {
-            imageAvailableSemaphore[currentFrame]
+            frame.imageAvailableSemaphore
     };
     VkPipelineStageFlags waitStages[] = {
             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
     };
     VkSemaphore  signalSemaphores[] = {
-            renderFinishedSemaphore[currentFrame]
+            frame.renderFinishedSemaphore
     };
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = config.headless ? 0 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer[currentFrame];
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pCommandBuffers = &frame.commandBuffer;
+    submitInfo.signalSemaphoreCount = config.headless ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence[currentFrame]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to submit draw command");
+    frame.timelineValue = timeline.submit(graphicsQueue, submitInfo);
+    imagesInFlight[imageIndex] = frame.timelineValue;
+    end_stage(FrameStage::Submit);
+
+    if (!config.headless) {
+        VkSwapchainKHR vkSwapchains[] = {swapchainKhr};
+        uint64_t id = ++presentId;
+        VkPresentIdKHR presentIdKhr = {};
+        presentIdKhr.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+        presentIdKhr.swapchainCount = 1;
+        presentIdKhr.pPresentIds = &id;
+        VkPresentInfoKHR presentInfoKhr = {};
+        presentInfoKhr.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfoKhr.pNext = presentWait ? &presentIdKhr : nullptr;
+        presentInfoKhr.waitSemaphoreCount = 1;
+        presentInfoKhr.pWaitSemaphores = signalSemaphores;
+        presentInfoKhr.swapchainCount = 1;
+        presentInfoKhr.pSwapchains = vkSwapchains;
+        presentInfoKhr.pImageIndices = &imageIndex;
+        presentInfoKhr.pResults = nullptr;
+
+        result = vkQueuePresentKHR(presentQueue, &presentInfoKhr);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || frameBufferResized) {
+            frameBufferResized = false;
+            recreate_swapchain(sample);
+        } else if(result != VK_SUCCESS) {
+            throw std::runtime_error("failed to present swapchain image!");
+        } else if (resizePresentPending) {
+            // the first frame of the new swapchain is queued for presentation
+            benchmark.add_event(sample, "resize_latency", now_ms() - resizeStartMs);
+            resizePresentPending = false;
+            resizeStartMs = -1.0;
+        }
+        end_stage(FrameStage::Present);
     }
 
+    pacer.frame_done(now_ms());
+    benchmark.end_frame(sample, now_ms());
+    currentFrame = (currentFrame + 1) % frames.size();
+}
+
+void App::pace_frame() {
+    // at most maxQueuedFrames frames in flight once this one starts: with present waits the
+    // oldest of them has to be on screen, otherwise its GPU work has to be done
+    uint32_t queueLimit = config.maxQueuedFrames;
+    if (queueLimit > 0 && presentWait) {
+        if (presentId + 1 >= swapchainFirstPresentId + queueLimit) {
+            // bounded, a present the compositor drops must not hang the loop
+            VkResult result = waitForPresent(device, swapchainKhr, presentId + 1 - queueLimit, 100000000);
+            if (result != VK_SUCCESS && result != VK_TIMEOUT && result != VK_SUBOPTIMAL_KHR
+                && result != VK_ERROR_OUT_OF_DATE_KHR) {
+                throw std::runtime_error("failed to wait for present");
+            }
+        }
+    } else if (queueLimit > 0 && queueLimit < frames.size()) {
+        // the slot wait in drawFrame already covers frames.size()
+        timeline.wait(frames[(currentFrame + frames.size() - queueLimit) % frames.size()].timelineValue);
+    }
 
-    VkSwapchainKHR vkSwapchains[] = {swapchainKhr};
-    VkPresentInfoKHR presentInfoKhr = {};
-    presentInfoKhr.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    presentInfoKhr.waitSemaphoreCount = 1;
-    presentInfoKhr.pWaitSemaphores = signalSemaphores;
-    presentInfoKhr.swapchainCount = 1;
-    presentInfoKhr.pSwapchains = vkSwapchains;
-    presentInfoKhr.pImageIndices = &imageIndex;
-    presentInfoKhr.pResults = nullptr;
+    pacer.wait();
+}
 
-    result = vkQueuePresentKHR(presentQueue, &presentInfoKhr);
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || frameBufferResized) {
-        frameBufferResized = false;
-        recreate_swapchain();
-    } else if(result != VK_SUCCESS) {
-        throw std::runtime_error("failed to present swapchain image!");
+void App::create_profiler() {
+    QueueFamilyIndices indices = find_queue_families(physicalDevice);
+    profiler.init(physicalDevice, device, indices.graphicalFamily, frames.size(), 16, pipelineStatisticsQuery);
+    if (!profiler.timestamps_supported()) {
+        std::cout << "GPU timestamps not supported on the graphics queue, GPU times are not reported\n";
+    }
+
+    // uploads are only timed where the copies run on a queue that can reset query pools
+    if (profiler.timestamps_supported() && !uploadQueue.uses_dedicated_transfer_queue()) {
+        uploadQueue.enable_gpu_timing(profiler.timestamp_period(), profiler.timestamp_mask());
     }
-    currentFrame = (currentFrame + 1) % MAX_FRAME_IN_FLIGHT;
 }
 
-void App::recreate_swapchain() {
+void App::collect_gpu_results(uint32_t slot) {
+    if (!profiler.collect(slot)) return;
+
+    int64_t sample = profiler.last_tag();
+    for (const auto& result : profiler.last_results()) {
+        benchmark.add_gpu_scope(sample, result.name, result.ms);
+        if (result.depth == 0) {
+            benchmark.set_gpu_time(sample, result.ms);
+        }
+    }
+
+    const GpuPipelineStatistics& statistics = profiler.last_statistics();
+    if (statistics.valid) {
+        benchmark.add_counter(sample, "ia_vertices", statistics.inputAssemblyVertices);
+        benchmark.add_counter(sample, "ia_primitives", statistics.inputAssemblyPrimitives);
+        benchmark.add_counter(sample, "vs_invocations", statistics.vertexShaderInvocations);
+        benchmark.add_counter(sample, "clipping_primitives", statistics.clippingPrimitives);
+        benchmark.add_counter(sample, "fs_invocations", statistics.fragmentShaderInvocations);
+    }
+}
+
+void App::finish_benchmark() {
+    for (uint32_t slot = 0; slot < frames.size(); ++slot) {
+        collect_gpu_results(slot);
+    }
+
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    benchmark.add_info("device", properties.deviceName);
+    benchmark.add_info("mode", config.headless ? "headless" : "windowed");
+    benchmark.add_info("extent", std::to_string(swapchainExtent.width) + "x" + std::to_string(swapchainExtent.height));
+    benchmark.add_info("frames_in_flight", std::to_string(frames.size()));
+    benchmark.add_info("instances", std::to_string(sceneObjects.size()));
+    benchmark.add_info("draws", std::to_string(draw_count()));
+    benchmark.add_info("record_threads", std::to_string(config.recordThreads));
+    benchmark.add_info("transform_threads", std::to_string(config.transformThreads));
+    benchmark.add_info("transform_simd", TransformStore::simd_name());
+    if (!config.headless) benchmark.add_info("present_mode", present_mode_name(presentMode));
+    benchmark.add_info("target_fps", std::to_string(config.targetFps));
+    benchmark.add_info("max_queued_frames", std::to_string(config.maxQueuedFrames));
+    benchmark.add_info("gpu_sync", timelineSemaphores ? "timeline" : "fences");
+    benchmark.add_info("render_path", dynamicRendering ? "dynamic" : "renderpass");
+    FramePacingStats pacing = pacer.stats();
+    benchmark.add_info("frame_interval_mean_ms", std::to_string(pacing.meanMs));
+    benchmark.add_info("frame_interval_stddev_ms", std::to_string(pacing.stddevMs));
+    const char* transformPaths[] = {"instanced", "push", "uniform"};
+    benchmark.add_info("transforms", transformPaths[static_cast<int>(config.transformPath)]);
+    benchmark.add_info("triangles", std::to_string(indexCount / 3));
+    benchmark.add_info("acmr", std::to_string(meshCacheStats.acmr));
+    benchmark.add_info("vertex_layout", vertex_layout_name(vertexLayout));
+    benchmark.add_info("vertex_bytes", std::to_string(vertex_stride(vertexLayout)));
+
+    benchmark.print_summary(std::cout);
+    if (!config.reportPath.empty()) {
+        benchmark.write_report(config.reportPath);
+        std::cout << "benchmark report written to " << config.reportPath << "\n";
+    }
+}
+
+void App::recreate_swapchain(int64_t sample) {
+    double startMs = now_ms();
+    if (resizeStartMs < 0.0) resizeStartMs = startMs;
+
+    // minimized, drawFrame retries once the window has a size again
     int width = 0, height = 0;
     glfwGetFramebufferSize(window, &width, &height);
-    while(width == 0 || height == 0) {
-        glfwGetFramebufferSize(window, &width, &height);
-        glfwWaitEvents();
-    }
-    vkDeviceWaitIdle(device);
+    swapchainOutOfDate = width == 0 || height == 0;
+    if (swapchainOutOfDate) return;
 
-    cleanup_swapchain();
+    // no vkDeviceWaitIdle: frames in flight finish with the old images, whatever they use goes
+    // to the deletion queue and is destroyed once the timeline passed the last of them
+    VkSwapchainKHR oldSwapchain = swapchainKhr;
+    for (auto framebuffer : swapchainFrameBuffers) {
+        deletionQueue.retire_framebuffer(framebuffer);
+    }
+    for (auto imageView : swapchainImageViews) {
+        deletionQueue.retire_image_view(imageView);
+    }
+    swapchainImageViews.clear();
+    swapchainFrameBuffers.clear();
 
-    create_swapchain();
+    create_swapchain(oldSwapchain);
+    deletionQueue.retire_swapchain(oldSwapchain);
     create_image_view();
-    create_depth_resources();
+    // framebuffers may be smaller than their attachments, so the depth image only ever grows
+    if (swapchainExtent.width > depthExtent.width || swapchainExtent.height > depthExtent.height) {
+        deletionQueue.retire_image_view(depthImageView);
+        deletionQueue.retire_image(depthImage, depthImageAllocation);
+        create_depth_resources();
+    }
     create_frame_buffers();
+    // the aspect ratio changed
+    cameraDirty = true;
+    deletionQueue.collect();
+
+    benchmark.add_event(sample, "resize", now_ms() - startMs);
+    resizePresentPending = true;
 }
 
 void App::cleanup_swapchain() {
     vkDestroyImageView(device, depthImageView, nullptr);
     vkDestroyImage(device, depthImage, nullptr);
-    vkFreeMemory(device, depthImageMemory, nullptr);
+    allocator.free(depthImageAllocation);
 
     for (auto & swapchainFrameBuffer : swapchainFrameBuffers) {
         vkDestroyFramebuffer(device, swapchainFrameBuffer, nullptr);
@@ -975,6 +2024,14 @@ void App::cleanup_swapchain() {
         vkDestroyImageView(device, imageView, nullptr);
     }
 
+    if (config.headless) {
+        for (size_t i = 0; i < swapchainImages.size(); ++i) {
+            vkDestroyImage(device, swapchainImages[i], nullptr);
+            allocator.free(offscreenImageAllocations[i]);
+        }
+        return;
+    }
+
     vkDestroySwapchainKHR(device, swapchainKhr, nullptr);
 }
 
@@ -982,81 +2039,160 @@ void App::frameBufferResizeCallback(GLFWwindow *window, int width, int height) {
     auto app =
             reinterpret_cast<App*>(glfwGetWindowUserPointer(window));
     app->frameBufferResized = true;
+    if (app->resizeStartMs < 0.0) app->resizeStartMs = now_ms();
 }
 
-VkVertexInputBindingDescription Vertex::getBindingDescription() {
+VkVertexInputBindingDescription InstanceData::getBindingDescription() {
     VkVertexInputBindingDescription bindingDescription = {};
-    bindingDescription.binding = 0;
-    bindingDescription.stride = sizeof(Vertex);
-    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    bindingDescription.binding = 1;
+    bindingDescription.stride = sizeof(InstanceData);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
     return bindingDescription;
 }
 
-std::array<VkVertexInputAttributeDescription, 3> Vertex::getAttributeDescriptions() {
-
-    std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = {};
-    attributeDescriptions[0].binding = 0;
-    attributeDescriptions[0].location = 0;
-    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-    attributeDescriptions[1].binding = 0;
-    attributeDescriptions[1].location = 1;
-    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-    attributeDescriptions[2].binding = 0;
-    attributeDescriptions[2].location = 2;
-    attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
+std::array<VkVertexInputAttributeDescription, 5> InstanceData::getAttributeDescriptions() {
+    // a mat4 attribute takes four consecutive locations, one vec4 column each
+    std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions = {};
+    for (uint32_t column = 0; column < 4; ++column) {
+        attributeDescriptions[column].binding = 1;
+        attributeDescriptions[column].location = 3 + column;
+        attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        attributeDescriptions[column].offset = offsetof(InstanceData, model) + column * sizeof(glm::vec4);
+    }
+    // location 7 is the vertex normal
+    attributeDescriptions[4].binding = 1;
+    attributeDescriptions[4].location = 8;
+    attributeDescriptions[4].format = VK_FORMAT_R32_UINT;
+    attributeDescriptions[4].offset = offsetof(InstanceData, object);
 
     return attributeDescriptions;
 }
 
-void App::create_vertex_buffer() {
-    VkDeviceSize deviceSize = sizeof(vertices[0]) * vertices.size();
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    create_buffer(deviceSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-                  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                  stagingBuffer, stagingBufferMemory);
+void App::create_mesh() {
+    double startMs = now_ms();
+    std::string name = "built-in quads";
+    if (config.meshPath.empty()) {
+        mesh.vertices = {
+                {{-0.5f, -0.5f, .5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+                {{0.5f, -0.5f, .5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
+                {{0.5f, 0.5f, .5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
+                {{-0.5f, 0.5f, .5f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}},
+
+                {{-0.5f, -0.5f, -.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+                {{0.5f, -0.5f, -.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
+                {{0.5f, 0.5f, -.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
+                {{-0.5f, 0.5f, -.5f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}},
+        };
+        mesh.indices = {
+                0, 1, 2, 2, 3, 0,
+                4, 5, 6, 6, 7, 4
+        };
+    } else {
+        name = config.meshPath.substr(config.meshPath.find_last_of("/\\") + 1);
+        // archive entries are named after the file, external glTF buffers by their uri
+        AssetView asset;
+        if (assets.is_open() && assets.contains(name)) {
+            asset = assets.view(name, config.validation);
+        }
+        if (asset.data == nullptr) {
+            mesh = load_mesh(config.meshPath);
+        } else if (name.size() >= 4 && name.compare(name.size() - 4, 4, ".obj") == 0) {
+            mesh = parse_obj(reinterpret_cast<const char*>(asset.data), asset.size, name);
+        } else {
+            std::string directory = config.meshPath.substr(0, config.meshPath.find_last_of("/\\") + 1);
+            mesh = parse_gltf(asset.data, asset.size, name, [&](const std::string& uri) {
+                if (assets.contains(uri)) {
+                    AssetView resource = assets.view(uri, config.validation);
+                    return std::vector<uint8_t>(resource.data, resource.data + resource.size);
+                }
+                std::vector<char> resource = readFile(directory + uri);
+                return std::vector<uint8_t>(resource.begin(), resource.end());
+            });
+        }
+        // the scene is laid out for unit sized objects
+        fit_unit_cube(mesh);
+    }
+
+    size_t corners = mesh.vertices.size();
+    deduplicate_vertices(mesh);
+    bool hasNormals = std::any_of(mesh.vertices.begin(), mesh.vertices.end(), [](const Vertex& vertex) {
+        return vertex.normal.x != 0.0f || vertex.normal.y != 0.0f || vertex.normal.z != 0.0f;
+    });
+    if (!hasNormals) {
+        generate_normals(mesh);
+    }
+    VertexCacheStats before = analyze_vertex_cache(mesh.indices, mesh.vertices.size());
+    if (config.optimizeMesh) {
+        optimize_vertex_cache(mesh);
+        optimize_vertex_fetch(mesh);
+    }
+    VertexCacheStats after = analyze_vertex_cache(mesh.indices, mesh.vertices.size());
+
+    // center of the bounds, radius to the farthest vertex
+    glm::vec3 lower(0.0f), upper(0.0f);
+    if (!mesh.vertices.empty()) lower = upper = mesh.vertices[0].pos;
+    for (const auto& vertex : mesh.vertices) {
+        lower = glm::min(lower, vertex.pos);
+        upper = glm::max(upper, vertex.pos);
+    }
+    glm::vec3 center = (lower + upper) * 0.5f;
+    float radius = 0.0f;
+    for (const auto& vertex : mesh.vertices) {
+        radius = std::max(radius, glm::length(vertex.pos - center));
+    }
+    // quantized positions may land a little outside
+    meshBounds = glm::vec4(center, radius * 1.001f);
+
+    indexType = choose_index_type(mesh.vertices.size());
+    indexCount = mesh.indices.size();
+    std::cout << "mesh: " << name << ", " << mesh.vertices.size() << " vertices (" << corners << " before dedup), "
+              << indexCount / 3 << " triangles, " << (indexType == VK_INDEX_TYPE_UINT16 ? "16" : "32") << " bit indices, "
+              << now_ms() - startMs << " ms\n"
+              << "mesh: ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr
+              << " (" << VERTEX_CACHE_SIZE << " entry FIFO" << (config.optimizeMesh ? "" : ", optimization disabled") << ")\n";
+    meshCacheStats = after;
+
+    vertexLayout = resolve_vertex_layout(fit_vertex_layout(parse_vertex_layout(config.vertexLayout), mesh.vertices));
+    uint32_t floatStride = vertex_stride(parse_vertex_layout("float"));
+    std::cout << "vertex layout: " << vertex_layout_name(vertexLayout) << ", " << vertex_stride(vertexLayout)
+              << " bytes per vertex (" << floatStride << " as float), "
+              << mesh.vertices.size() * vertex_stride(vertexLayout) / 1024 << " KiB\n";
+}
+
+VertexLayout App::resolve_vertex_layout(VertexLayout layout) {
+    auto supported = [&](VkFormat format) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+        return (properties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT) != 0;
+    };
+    // the 32 bit float formats are always there
+    if (!supported(position_format(layout.position))) layout.position = PositionEncoding::Float32;
+    if (!supported(normal_format(layout.normal))) layout.normal = NormalEncoding::Float32;
+    if (!supported(color_format(layout.color))) layout.color = ColorEncoding::Float32;
+    if (!supported(texcoord_format(layout.texCoord))) layout.texCoord = TexCoordEncoding::Float32;
+    return layout;
+}
 
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, deviceSize, 0, &data);
-    memcpy(data, vertices.data(), (size_t) deviceSize);
-    vkUnmapMemory(device, stagingBufferMemory);
+void App::create_vertex_buffer() {
+    std::vector<uint8_t> encoded = encode_vertices(mesh.vertices, vertexLayout, positionDequantization);
+    cameraDirty = true;
+    VkDeviceSize deviceSize = encoded.size();
 
     create_buffer(deviceSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer,
-                  vertexBufferMemory);
-
-    copy_buffer(stagingBuffer, vertexBuffer, deviceSize);
-
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+                  vertexBufferAllocation);
 
+    uploadQueue.upload_buffer(vertexBuffer, 0, encoded.data(), deviceSize,
+                              VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
 }
 
 uint32_t App::find_memory_type(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memoryProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
-
-    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
-        if (typeFilter & (1 << i)
-           && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("failed to create suitable memory type");
+    return allocator.find_memory_type(typeFilter, properties);
 }
 
 void App::create_buffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags,
-                        VkBuffer &buffer, VkDeviceMemory &deviceMemory) {
+                        VkBuffer &buffer, Allocation &allocation) {
     VkBufferCreateInfo bufferCreateInfo = {};
     bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferCreateInfo.size = size;
@@ -1070,61 +2206,33 @@ void App::create_buffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkMemo
     VkMemoryRequirements memoryRequirements;
     vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
 
-    VkMemoryAllocateInfo allocateInfo = {};
-    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocateInfo.allocationSize = memoryRequirements.size;
-    allocateInfo.memoryTypeIndex = find_memory_type(memoryRequirements.memoryTypeBits, propertyFlags);
-
-    if (vkAllocateMemory(device, &allocateInfo, nullptr, &deviceMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate buffer memory!");
-    }
+    allocation = allocator.allocate(memoryRequirements, propertyFlags, ResourceKind::Linear);
 
-    vkBindBufferMemory(device, buffer, deviceMemory, 0);
-}
-
-void App::copy_buffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-    VkCommandBuffer  vkCommandBuffer = begin_single_time_command();
-
-    VkBufferCopy bufferCopy = {};
-    bufferCopy.size = size;
-
-    vkCmdCopyBuffer(vkCommandBuffer, srcBuffer, dstBuffer, 1, &bufferCopy);
-
-    end_single_time_command(vkCommandBuffer);
+    vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
 }
 
 void App::create_indices_buffer() {
-    VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stageingBufferMemory;
-    create_buffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-                  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stageingBufferMemory);
-
-    void* data;
-    vkMapMemory(device, stageingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, indices.data(), (size_t) bufferSize);
-    vkUnmapMemory(device, stageingBufferMemory);
+    std::vector<uint8_t> packed = pack_indices(mesh.indices, indexType);
+    VkDeviceSize bufferSize = packed.size();
 
     create_buffer(bufferSize,
                   VK_BUFFER_USAGE_TRANSFER_DST_BIT
                   | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                  VK_MEMORY_HEAP_DEVICE_LOCAL_BIT,
-                  indexBuffer, indexBufferMemory);
-
-    copy_buffer(stagingBuffer, indexBuffer, bufferSize);
+                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                  indexBuffer, indexBufferAllocation);
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stageingBufferMemory, nullptr);
+    uploadQueue.upload_buffer(indexBuffer, 0, packed.data(), bufferSize,
+                              VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
 
+    // both buffers are in the staging ring now
+    mesh = Mesh();
 }
 
 void App::create_descriptor_set_layout() {
     VkDescriptorSetLayoutBinding layoutBinding = {};
     layoutBinding.binding = 0;
     layoutBinding.descriptorType =
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     layoutBinding.descriptorCount = 1;
     layoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
@@ -1134,9 +2242,24 @@ void App::create_descriptor_set_layout() {
     samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     samplerLayoutBinding.pImmutableSamplers = nullptr;
     samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    std::array<VkDescriptorSetLayoutBinding, 2> binding = {
-            layoutBinding, samplerLayoutBinding
+
+    VkDescriptorSetLayoutBinding objectLayoutBinding = layoutBinding;
+    objectLayoutBinding.binding = 2;
+
+    // the vertex stage picks the material, the fragment stage reads it
+    VkDescriptorSetLayoutBinding materialLayoutBinding = {};
+    materialLayoutBinding.binding = 3;
+    materialLayoutBinding.descriptorCount = 1;
+    materialLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    materialLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // bindless pipelines sample through the array of set 1 instead of binding 1
+    std::vector<VkDescriptorSetLayoutBinding> binding = {
+            layoutBinding, objectLayoutBinding, materialLayoutBinding
     };
+    if (!bindless) {
+        binding.push_back(samplerLayoutBinding);
+    }
     VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
     layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layoutCreateInfo.bindingCount = binding.size();
@@ -1146,171 +2269,642 @@ void App::create_descriptor_set_layout() {
     }
 }
 
-void App::create_uniform_buffer() {
-    VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-    uniformBuffers.resize(MAX_FRAME_IN_FLIGHT);
-    uniformBufferMemory.resize(MAX_FRAME_IN_FLIGHT);
-    uniformBufferMapped.resize(MAX_FRAME_IN_FLIGHT);
+void App::create_uniform_ring() {
+    // the camera, plus every object's transforms on the uniform path
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    VkDeviceSize alignment = std::max(properties.limits.minUniformBufferOffsetAlignment,
+                                      properties.limits.minStorageBufferOffsetAlignment);
+    auto aligned = [&](VkDeviceSize size) { return (size + alignment - 1) / alignment * alignment; };
+    VkDeviceSize regionSize = aligned(sizeof(CameraUniform));
+    if (config.transformPath == TransformPath::Uniform) {
+        regionSize += aligned(sizeof(ObjectTransforms)) * sceneObjects.size();
+    }
+
+    uniformRing.init(physicalDevice, device, allocator, regionSize, frames.size());
+    std::cout << "uniform ring: " << frames.size() << " x " << uniformRing.region_size() / 1024 << " KiB, "
+              << alignment << " byte offset alignment, " << (uniformRing.is_coherent() ? "coherent" : "flushed") << "\n";
+}
+
+void App::create_scene() {
+    uint32_t count = config.instanceCount;
+    // smallest cube grid that fits every object
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(count))));
+    while (side * side * side < count) side++;
+    const float spacing = 1.5f;
+    float halfExtent = (side - 1) * spacing * 0.5f;
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    sceneObjects.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        SceneObject& object = sceneObjects[i];
+        uint32_t x = i % side, y = (i / side) % side, z = i / (side * side);
+        object.position = glm::vec3(x, y, z) * spacing - glm::vec3(halfExtent);
+
+        // the first object keeps the original spin around z
+        if (i == 0) {
+            object.axis = glm::vec3(0.0f, 0.0f, 1.0f);
+            object.speed = 90.0f;
+            object.phase = 0.0f;
+            continue;
+        }
+        glm::vec3 axis(unit(random), unit(random), unit(random));
+        object.axis = glm::length(axis) > 0.01f ? glm::normalize(axis) : glm::vec3(0.0f, 0.0f, 1.0f);
+        object.speed = 45.0f + 90.0f * (unit(random) * 0.5f + 0.5f);
+        object.phase = glm::radians(180.0f * unit(random));
+    }
+
+    transformStore.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const SceneObject& object = sceneObjects[i];
+        transformStore.set(i, object.position, glm::angleAxis(object.phase, object.axis), glm::vec3(1.0f),
+                           object.axis * glm::radians(object.speed));
+    }
+    lastTransformUpdate = std::chrono::steady_clock::time_point();
+    sceneRadius = halfExtent * std::sqrt(3.0f);
+    objectTransforms.assign(config.transformPath == TransformPath::Push ? count : 0, glm::mat4(1.0f));
+    cameraDirty = true;
+
+    std::cout << "scene: " << count << " instances on a " << side << "^3 grid\n";
+}
+
+void App::create_instance_buffer() {
+    VkDeviceSize bufferSize = sizeof(InstanceData) * sceneObjects.size();
 
-    for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; ++i) {
-        create_buffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+    // the culling pass reads the instances as a storage buffer
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | (gpuCulling ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : 0);
+    for (auto& frame : frames) {
+        create_buffer(bufferSize, usage,
                       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
                       | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-                      uniformBuffers[i], uniformBufferMemory[i]);
+                      frame.instanceBuffer, frame.instanceBufferAllocation);
+
+        frame.instanceBufferMapped = static_cast<InstanceData*>(frame.instanceBufferAllocation.mapped);
+        // only the matrices change from frame to frame
+        for (uint32_t i = 0; i < sceneObjects.size(); ++i) frame.instanceBufferMapped[i].object = i;
+    }
+}
+
+void App::create_culling_resources() {
+    uint32_t instanceCount = sceneObjects.size();
+    uint32_t batchCount = batch_count();
+    // a compacted list is drawn by a single count draw, more batches than it can take fall back
+    // to one command per batch drawn in chunks
+    if (drawIndirectCount && batchCount > maxDrawIndirectCount) {
+        drawIndirectCount = false;
+    }
+
+    // every instance draws the same mesh for now, the shader does not rely on it
+    std::vector<glm::vec4> bounds(instanceCount, meshBounds);
+    VkDeviceSize boundsSize = sizeof(glm::vec4) * bounds.size();
+    create_buffer(boundsSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, boundsBuffer, boundsBufferAllocation);
+    uploadQueue.upload_buffer(boundsBuffer, 0, bounds.data(), boundsSize,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    // counters: the number of compacted draws, then the surviving instances of every batch
+    VkDeviceSize countSize = sizeof(uint32_t) * (1 + batchCount);
+    for (auto& frame : frames) {
+        create_buffer(sizeof(InstanceData) * instanceCount,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.visibleInstanceBuffer, frame.visibleInstanceBufferAllocation);
+        create_buffer(sizeof(VkDrawIndexedIndirectCommand) * batchCount,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.indirectBuffer, frame.indirectBufferAllocation);
+        create_buffer(countSize,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.cullCountBuffer, frame.cullCountBufferAllocation);
+    }
+
+    // 0 camera (frustum planes), 1 instances, 2 bounds, 3 visible instances, 4 counters, 5 draw commands
+    std::array<VkDescriptorSetLayoutBinding, 6> bindings = {};
+    for (uint32_t binding = 0; binding < bindings.size(); ++binding) {
+        bindings[binding].binding = binding;
+        bindings[binding].descriptorType = binding == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[binding].descriptorCount = 1;
+        bindings[binding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+    layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutCreateInfo.bindingCount = bindings.size();
+    layoutCreateInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(device, &layoutCreateInfo, nullptr, &cullSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling descriptor set layout");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes = {{
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, static_cast<uint32_t>(frames.size())},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>(frames.size() * 5)}
+    }};
+    VkDescriptorPoolCreateInfo poolCreateInfo = {};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCreateInfo.poolSizeCount = poolSizes.size();
+    poolCreateInfo.pPoolSizes = poolSizes.data();
+    poolCreateInfo.maxSets = frames.size();
+    if (vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &cullDescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling descriptor pool");
+    }
+
+    for (auto& frame : frames) {
+        VkDescriptorSetAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.descriptorPool = cullDescriptorPool;
+        allocateInfo.descriptorSetCount = 1;
+        allocateInfo.pSetLayouts = &cullSetLayout;
+        if (vkAllocateDescriptorSets(device, &allocateInfo, &frame.cullDescriptorSet) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate culling descriptor set");
+        }
 
-        vkMapMemory(device, uniformBufferMemory[i], 0, bufferSize, 0, &uniformBufferMapped[i]);
+        std::array<VkDescriptorBufferInfo, 6> bufferInfos = {{
+                {uniformRing.get_buffer(), 0, sizeof(CameraUniform)},
+                {frame.instanceBuffer, 0, VK_WHOLE_SIZE},
+                {boundsBuffer, 0, VK_WHOLE_SIZE},
+                {frame.visibleInstanceBuffer, 0, VK_WHOLE_SIZE},
+                {frame.cullCountBuffer, 0, VK_WHOLE_SIZE},
+                {frame.indirectBuffer, 0, VK_WHOLE_SIZE}
+        }};
+        std::array<VkWriteDescriptorSet, 6> descriptorWrites = {};
+        for (uint32_t binding = 0; binding < descriptorWrites.size(); ++binding) {
+            descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[binding].dstSet = frame.cullDescriptorSet;
+            descriptorWrites[binding].dstBinding = binding;
+            descriptorWrites[binding].descriptorType = bindings[binding].descriptorType;
+            descriptorWrites[binding].descriptorCount = 1;
+            descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+        }
+        vkUpdateDescriptorSets(device, descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
     }
-}
 
-void App::update_uniform_buffer(uint32_t currentImage) {
-    static auto startTime =
-            std::chrono::high_resolution_clock::now();
+    std::cout << "gpu culling: " << batchCount << " batch(es) of " << batch_size() << " instances, "
+              << (drawIndirectCount ? "compacted with vkCmdDrawIndexedIndirectCount" : "one indirect command per batch") << "\n";
+}
+
+void App::record_culling(VkCommandBuffer commandBuffer, const FrameContext& frame) {
+    CullParameters parameters = {static_cast<uint32_t>(sceneObjects.size()), batch_size(), batch_count(), indexCount};
+    const uint32_t groupSize = 64;
+
+    // the slot's previous frame is done with the counters, they only have to start from zero
+    vkCmdFillBuffer(commandBuffer, frame.cullCountBuffer, 0, VK_WHOLE_SIZE, 0);
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1,
+                            &frame.cullDescriptorSet, 1, &frame.cameraOffset);
+    vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(parameters), &parameters);
+
+    // one invocation per instance: frustum test, survivors are appended to their batch
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+    vkCmdDispatch(commandBuffer, (parameters.instanceCount + groupSize - 1) / groupSize, 1, 1);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+
+    // one invocation per batch: writes its draw command
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullCompactPipeline);
+    vkCmdDispatch(commandBuffer, (parameters.batchCount + groupSize - 1) / groupSize, 1, 1);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void App::update_instance_buffer(FrameContext& frame) {
+    // every frame slot is rewritten from the store, so the state advances once per frame
+    auto currentTime = std::chrono::steady_clock::now();
+    float dt = lastTransformUpdate == std::chrono::steady_clock::time_point()
+               ? 0.0f : std::chrono::duration<float>(currentTime - lastTransformUpdate).count();
+    lastTransformUpdate = currentTime;
+
+    TransformOutput output;
+    switch (config.transformPath) {
+        case TransformPath::Instanced:
+            output.models = reinterpret_cast<uint8_t*>(frame.instanceBufferMapped) + offsetof(InstanceData, model);
+            output.modelStride = sizeof(InstanceData);
+            break;
+        case TransformPath::Push:
+            // kept on the CPU, record_draws combines them with the camera while recording
+            output.models = reinterpret_cast<uint8_t*>(objectTransforms.data());
+            output.modelStride = sizeof(glm::mat4);
+            break;
+        case TransformPath::Uniform: {
+            // one block of the ring for all objects, draw i binds it at i * objectStride
+            VkDeviceSize objectStride = uniformRing.aligned_size(sizeof(ObjectTransforms));
+            void* data;
+            frame.objectOffset = uniformRing.allocate(objectStride * sceneObjects.size(), &data);
+            output.models = static_cast<uint8_t*>(data) + offsetof(ObjectTransforms, model);
+            output.modelStride = objectStride;
+            output.mvps = static_cast<uint8_t*>(data) + offsetof(ObjectTransforms, mvp);
+            output.mvpStride = objectStride;
+            output.viewProj = viewProj;
+            break;
+        }
+    }
 
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    size_t objectCount = transformStore.size();
+    if (config.transformThreads == 0) {
+        transformStore.update(0, objectCount, dt, output);
+        return;
+    }
+    // a few chunks per thread, each a whole number of SIMD vectors
+    size_t width = TransformStore::simd_width();
+    size_t jobCount = std::max<size_t>(std::min<size_t>(objectCount / (width * 64), transformJobs.worker_count() * 2), 1);
+    size_t chunk = ((objectCount + jobCount - 1) / jobCount + width - 1) / width * width;
+    transformJobs.run(static_cast<uint32_t>(jobCount), [&](uint32_t job, uint32_t) {
+        transformStore.update(job * chunk, std::min(objectCount, (job + 1) * chunk), dt, output);
+    });
+}
 
-    UniformBufferObject ubo = {};
-    ubo.model =
-            glm::rotate(
-                    glm::mat4(1.0f),
-                    time * glm::radians(90.0f),
-                    glm::vec3(0.0f, 0.0f, 1.0f)
-            );
+void App::update_camera() {
+    if (!cameraDirty) return;
 
-    ubo.view = glm::lookAt(
-            glm::vec3(1.5f, 1.5f, 1.5f),
+    // pull the camera back far enough to see the whole grid
+    float distance = 1.0f + sceneRadius * 1.5f;
+    view = glm::lookAt(
+            glm::vec3(1.5f, 1.5f, 1.5f) * distance,
             glm::vec3(0.0f, 0.0f, 0.0f),
             glm::vec3(0.0f, 0.0f, 1.0f)
     );
-    ubo.proj = glm::perspective(
+    proj = glm::perspective(
             glm::radians(45.0f),
             (float) swapchainExtent.width / (float) swapchainExtent.height,
             0.1f,
-            10.0f
+            10.0f * distance
     );
-    ubo.proj[1][1] *= -1;
-    memcpy(uniformBufferMapped[currentImage], &ubo, sizeof(ubo));
+    proj[1][1] *= -1;
+    viewProj = proj * view;
+
+    // Gribb/Hartmann: left, right, bottom, top, near (depth 0..1), far
+    glm::vec4 rows[4];
+    for (int row = 0; row < 4; ++row) {
+        rows[row] = glm::vec4(viewProj[0][row], viewProj[1][row], viewProj[2][row], viewProj[3][row]);
+    }
+    frustumPlanes = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2]};
+    for (auto& plane : frustumPlanes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    cameraDirty = false;
+}
+
+void App::update_uniform_buffer(FrameContext& frame) {
+    update_camera();
+
+    // the slot is idle, its region of the ring is free again
+    uniformRing.begin_frame(currentFrame);
+    void* data;
+    frame.cameraOffset = uniformRing.allocate(sizeof(CameraUniform), &data);
+
+    CameraUniform camera = {};
+    camera.viewProj = viewProj;
+    camera.positionScale = positionDequantization.scale;
+    camera.positionBias = positionDequantization.bias;
+    for (size_t i = 0; i < frustumPlanes.size(); ++i) {
+        camera.frustumPlanes[i] = frustumPlanes[i];
+    }
+    memcpy(data, &camera, sizeof(camera));
 }
 
 void App::create_descriptor_pool() {
-    std::array<VkDescriptorPoolSize, 2> poolSizes = {};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = MAX_FRAME_IN_FLIGHT;
-    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = MAX_FRAME_IN_FLIGHT;
+    std::vector<VkDescriptorPoolSize> poolSizes = {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, static_cast<uint32_t>(frames.size() * 2)},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>(frames.size())}
+    };
+    if (!bindless) {
+        poolSizes.push_back({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<uint32_t>(frames.size())});
+    }
 
     VkDescriptorPoolCreateInfo poolCreateInfo = {};
     poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolCreateInfo.poolSizeCount = poolSizes.size();
     poolCreateInfo.pPoolSizes = poolSizes.data();
-    poolCreateInfo.maxSets = MAX_FRAME_IN_FLIGHT;
+    poolCreateInfo.maxSets = frames.size();
     if (vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor pool!");
     }
 }
 
 void App::create_descriptor_set() {
-    std::vector<VkDescriptorSetLayout> layout(MAX_FRAME_IN_FLIGHT, descriptorSetLayout);
+    std::vector<VkDescriptorSetLayout> layout(frames.size(), descriptorSetLayout);
 
     VkDescriptorSetAllocateInfo allocateInfo{
         VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
         nullptr, //pNext;
         descriptorPool,
-        MAX_FRAME_IN_FLIGHT,
+        static_cast<uint32_t>(frames.size()),
         layout.data()
     };
 
-    descriptorSets.resize(MAX_FRAME_IN_FLIGHT);
+    std::vector<VkDescriptorSet> descriptorSets(frames.size());
     if (vkAllocateDescriptorSets(device, &allocateInfo, descriptorSets.data()) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate descriptor sets");
     }
 
-    std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
-    for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; ++i) {
+    std::array<VkWriteDescriptorSet, 4> descriptorWrites = {};
+    for (size_t i = 0; i < frames.size(); ++i) {
+        frames[i].descriptorSet = descriptorSets[i];
 
+        // dynamic offsets select the frame's region and the object
         VkDescriptorBufferInfo bufferInfo = {
-            .buffer = uniformBuffers[i],
+            .buffer = uniformRing.get_buffer(),
             .offset = 0,
-            .range = sizeof(UniformBufferObject)
+            .range = sizeof(CameraUniform)
+        };
+        VkDescriptorBufferInfo objectBufferInfo = {
+            .buffer = uniformRing.get_buffer(),
+            .offset = 0,
+            .range = sizeof(ObjectTransforms)
         };
 
         VkDescriptorImageInfo imageInfo = {};
         imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfo.imageView = textureImageView;
+        imageInfo.imageView = current_texture_view();
         imageInfo.sampler = textureSampler;
+        frames[i].boundTextureView = bindless ? VK_NULL_HANDLE : imageInfo.imageView;
 
         descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         descriptorWrites[0].dstSet = descriptorSets[i];
         descriptorWrites[0].dstBinding = 0;
         descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         descriptorWrites[0].descriptorCount = 1;
         descriptorWrites[0].pBufferInfo = &bufferInfo;
 
-        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet = descriptorSets[i];
-        descriptorWrites[1].dstBinding = 1;
-        descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pImageInfo = &imageInfo;
+        descriptorWrites[1] = descriptorWrites[0];
+        descriptorWrites[1].dstBinding = 2;
+        descriptorWrites[1].pBufferInfo = &objectBufferInfo;
 
-        vkUpdateDescriptorSets(device, descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
+        // every slot reads its own copy of the materials
+        VkDescriptorBufferInfo materialBufferInfo = {
+            .buffer = frames[i].materialBuffer,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE
+        };
+        descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[2].dstSet = descriptorSets[i];
+        descriptorWrites[2].dstBinding = 3;
+        descriptorWrites[2].dstArrayElement = 0;
+        descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[2].descriptorCount = 1;
+        descriptorWrites[2].pBufferInfo = &materialBufferInfo;
+
+        descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[3].dstSet = descriptorSets[i];
+        descriptorWrites[3].dstBinding = 1;
+        descriptorWrites[3].dstArrayElement = 0;
+        descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[3].descriptorCount = 1;
+        descriptorWrites[3].pImageInfo = &imageInfo;
+
+        // binding 1 does not exist in the bindless layout
+        uint32_t writeCount = bindless ? 3 : 4;
+        vkUpdateDescriptorSets(device, writeCount, descriptorWrites.data(), 0, nullptr);
     }
 
 }
 
-void App::create_texture_image() {
-    int texWidth, texHeight, texChannels;
-    stbi_uc* pixels = stbi_load("../textures/mango.jpg", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+void App::request_textures() {
+    const std::string& path = config.texturePath;
+    bool cooked = path.size() >= 5 && path.compare(path.size() - 5, 5, ".mtex") == 0;
 
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
+    TextureRequest request;
+    request.id = 0;
+    request.path = path;
+    request.cooked = cooked;
+    // archive entries are named after the file, their payloads are used straight from the mapping
+    if (assets.is_open()) {
+        request.asset = assets.view(path.substr(path.find_last_of("/\\") + 1), config.validation);
+    }
+    // without linear blits the whole chain has to come from the CPU, do it on the worker as well
+    request.buildMipChain = !cooked && (config.cpuMipmaps || !supports_linear_blit(VK_FORMAT_R8G8B8A8_SRGB));
 
-    if (!pixels) {
-        throw std::runtime_error("failed to load texture!");
+    textureRequestMs = now_ms();
+    textureLoader.request(std::move(request));
+}
+
+void App::poll_textures(bool wait) {
+    if (textureImage != VK_NULL_HANDLE) return;
+
+    do {
+        std::vector<DecodedTexture> textures = wait ? textureLoader.wait_finished() : textureLoader.take_finished();
+        for (const auto& texture : textures) {
+            if (!texture.error.empty()) {
+                throw std::runtime_error(texture.error);
+            }
+            upload_decoded_texture(texture);
+            create_texture_image_view();
+            if (bindless) {
+                // a fresh slot, no frame in flight indexes it yet
+                textureSlots[texture.id] = bindlessTextures.add(textureImageView);
+                resolve_materials();
+            }
+            texturesDecoded++;
+            textureDecodeMs += texture.decodeMs;
+        }
+        if (!textures.empty()) {
+            // ordered before the draws of this frame on the graphics queue
+            uploadQueue.submit();
+        }
+    } while (wait && textureLoader.pending() > 0);
+
+    if (texturesDecoded > 0 && textureLoader.pending() == 0) {
+        std::cout << "textures: " << texturesDecoded << " decoded on " << textureLoader.thread_count() << " thread(s), "
+                  << now_ms() - textureRequestMs << " ms until resident, " << textureDecodeMs << " ms decoding\n";
     }
+}
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    create_buffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-                  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                  stagingBuffer, stagingBufferMemory);
+VkImageView App::current_texture_view() const {
+    return textureImageView != VK_NULL_HANDLE ? textureImageView : placeholderImageView;
+}
 
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, imageSize);
-    vkUnmapMemory(device, stagingBufferMemory);
+void App::update_texture_descriptor(FrameContext& frame) {
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = current_texture_view();
+    imageInfo.sampler = textureSampler;
+
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = frame.descriptorSet;
+    descriptorWrite.dstBinding = 1;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+    frame.boundTextureView = imageInfo.imageView;
+}
+
+void App::create_materials() {
+    if (bindless) {
+        // slot 0 is the placeholder, every texture samples it until it is resident
+        bindlessTextures.init(device, textureSampler, bindlessCapacity);
+        textureSlots.assign(1, bindlessTextures.add(placeholderImageView));
+    }
+
+    // white first, then tints spread around the hue circle by the golden ratio
+    materials.resize(config.materialCount);
+    materialTextures.assign(config.materialCount, 0);
+    for (uint32_t i = 0; i < config.materialCount; ++i) {
+        glm::vec3 tint(1.0f);
+        if (i > 0) {
+            float hue = std::fmod(i * 0.618034f, 1.0f) * 6.0f;
+            glm::vec3 rgb = glm::clamp(glm::vec3(std::abs(hue - 3.0f) - 1.0f,
+                                                 2.0f - std::abs(hue - 2.0f),
+                                                 2.0f - std::abs(hue - 4.0f)), 0.0f, 1.0f);
+            tint = (glm::vec3(1.0f) + rgb) * 0.5f;
+        }
+        materials[i] = {};
+        materials[i].baseColor = glm::vec4(tint, 1.0f);
+    }
+    resolve_materials();
 
-    stbi_image_free(pixels);
+    VkDeviceSize bufferSize = sizeof(MaterialData) * materials.size();
+    for (auto& frame : frames) {
+        create_buffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                      | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                      frame.materialBuffer, frame.materialBufferAllocation);
+
+        frame.materialBufferMapped = static_cast<MaterialData*>(frame.materialBufferAllocation.mapped);
+        update_material_buffer(frame);
+    }
+    std::cout << "materials: " << materials.size() << ", textures "
+              << (bindless ? "indexed from a bindless array of " + std::to_string(bindlessCapacity) : "bound per frame slot")
+              << "\n";
+}
 
-    create_image(texWidth, texHeight,
+void App::resolve_materials() {
+    if (bindless) {
+        for (size_t i = 0; i < materials.size(); ++i) {
+            materials[i].textureSlot = textureSlots[materialTextures[i]];
+        }
+    }
+    materialsVersion++;
+}
+
+void App::update_material_buffer(FrameContext& frame) {
+    if (frame.materialsVersion == materialsVersion) return;
+    memcpy(frame.materialBufferMapped, materials.data(), sizeof(MaterialData) * materials.size());
+    frame.materialsVersion = materialsVersion;
+}
+
+void App::create_placeholder_texture() {
+    // 8x8 magenta/grey checker, obviously not the real thing
+    const uint32_t size = 8;
+    std::vector<uint32_t> pixels(size * size);
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            pixels[y * size + x] = ((x ^ y) & 1) ? 0xffff00ff : 0xff808080;
+        }
+    }
+
+    create_image(size, size,
                  VK_FORMAT_R8G8B8A8_SRGB,
                  VK_IMAGE_TILING_OPTIMAL,
                  VK_IMAGE_USAGE_TRANSFER_DST_BIT
                  | VK_IMAGE_USAGE_SAMPLED_BIT,
                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                 textureImage, textureImageMemory);
+                 placeholderImage, placeholderImageAllocation);
 
-    transition_image_layout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    ImageUpload upload = {};
+    upload.image = placeholderImage;
+    upload.width = size;
+    upload.height = size;
+    upload.data = pixels.data();
+    upload.size = pixels.size() * sizeof(uint32_t);
+    uploadQueue.upload_image(upload);
 
-    copy_buffer_to_image(stagingBuffer,
-                         textureImage,
-                         texWidth,
-                         texHeight);
+    placeholderImageView = create_image_views(placeholderImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+}
 
-    transition_image_layout(textureImage,
-                            VK_FORMAT_R8G8B8A8_SRGB,
-                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+void App::upload_decoded_texture(const DecodedTexture& texture) {
+    if (texture.cooked) {
+        create_cooked_texture_image(texture.file);
+        return;
+    }
 
+    textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    textureMipLevels = mip_level_count(texture.width, texture.height);
+    bool gpuMipmaps = texture.levels.empty();
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    create_image(texture.width, texture.height,
+                 VK_FORMAT_R8G8B8A8_SRGB,
+                 VK_IMAGE_TILING_OPTIMAL,
+                 VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+                 | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+                 | VK_IMAGE_USAGE_SAMPLED_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 textureImage, textureImageAllocation, textureMipLevels);
+
+    ImageUpload upload = {};
+    upload.image = textureImage;
+    upload.width = texture.width;
+    upload.height = texture.height;
+    upload.mipLevels = textureMipLevels;
+    upload.levels = texture.levels;
+    upload.data = texture.pixels.get();
+    upload.size = texture.size;
+    upload.generateMips = gpuMipmaps;
+    // the pixels are copied into the staging ring right away
+    uploadQueue.upload_image(upload);
+    std::cout << "texture: " << texture.width << "x" << texture.height << ", " << textureMipLevels << " mip levels built on the "
+              << (gpuMipmaps ? "GPU" : "CPU") << ", decoded in " << texture.decodeMs << " ms\n";
+}
+
+void App::create_cooked_texture_image(const TextureFile& texture) {
+    std::vector<VkFormat> candidates;
+    for (const auto& variant : texture.variants) {
+        TextureCompression compression = texture_compression(variant.format);
+        if ((compression == TextureCompression::BC && !textureCompressionBC)
+            || (compression == TextureCompression::ETC2 && !textureCompressionETC2)) continue;
+        candidates.push_back(variant.format);
+    }
+    textureFormat = find_supported_format(candidates, VK_IMAGE_TILING_OPTIMAL,
+                                          VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+                                          | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+    const TextureVariant& variant = *std::find_if(texture.variants.begin(), texture.variants.end(),
+                                                  [&](const TextureVariant& v) { return v.format == textureFormat; });
+    textureMipLevels = texture.mipLevels;
+
+    create_image(texture.width, texture.height,
+                 textureFormat,
+                 VK_IMAGE_TILING_OPTIMAL,
+                 VK_IMAGE_USAGE_TRANSFER_DST_BIT
+                 | VK_IMAGE_USAGE_SAMPLED_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 textureImage, textureImageAllocation, textureMipLevels);
+
+    ImageUpload upload = {};
+    upload.image = textureImage;
+    upload.width = texture.width;
+    upload.height = texture.height;
+    upload.mipLevels = textureMipLevels;
+    upload.levels = variant.levels;
+    upload.data = variant.payload;
+    upload.size = variant.size;
+    uploadQueue.upload_image(upload);
+
+    std::vector<ImageLevel> rgba8Levels;
+    VkDeviceSize rgba8Size = texture_level_layout(VK_FORMAT_R8G8B8A8_SRGB, texture.width, texture.height,
+                                                  texture.mipLevels, rgba8Levels);
+    std::cout << "texture: " << texture.width << "x" << texture.height << ", " << textureMipLevels << " mip levels, "
+              << texture_format_name(textureFormat) << " " << variant.size / 1024 << " KiB ("
+              << rgba8Size / 1024 << " KiB as RGBA8)\n";
 }
 
 void App::create_image(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-                       VkMemoryPropertyFlags propertyFlags, VkImage &image, VkDeviceMemory &imageMemory) {
+                       VkMemoryPropertyFlags propertyFlags, VkImage &image, Allocation &allocation, uint32_t mipLevels) {
 
     VkImageCreateInfo imageCreateInfo = {};
     imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -1320,7 +2914,7 @@ void App::create_image(uint32_t width, uint32_t height, VkFormat format, VkImage
         static_cast<uint32_t>(height),
         1
     };
-    imageCreateInfo.mipLevels = 1;
+    imageCreateInfo.mipLevels = mipLevels;
     imageCreateInfo.arrayLayers = 1;
     imageCreateInfo.format = format;
     imageCreateInfo.tiling = tiling;
@@ -1336,137 +2930,27 @@ void App::create_image(uint32_t width, uint32_t height, VkFormat format, VkImage
     VkMemoryRequirements memoryRequirements;
     vkGetImageMemoryRequirements(device, image, &memoryRequirements);
 
-    VkMemoryAllocateInfo allocateInfo = {};
-    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocateInfo.allocationSize = memoryRequirements.size;
-    allocateInfo.memoryTypeIndex = find_memory_type(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    allocation = allocator.allocate(memoryRequirements, propertyFlags,
+                                    tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceKind::Optimal : ResourceKind::Linear);
 
-    if (vkAllocateMemory(device, &allocateInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory");
-    }
-
-    vkBindImageMemory(device, image, imageMemory, 0);
+    vkBindImageMemory(device, image, allocation.memory, allocation.offset);
 }
 
-VkCommandBuffer App::begin_single_time_command() {
-    VkCommandBufferAllocateInfo allocateInfo = {};
-    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocateInfo.commandPool = commandPool;
-    allocateInfo.commandBufferCount = 1;
-
-    VkCommandBuffer vkCommandBuffer;
-    vkAllocateCommandBuffers(device, &allocateInfo, &vkCommandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(vkCommandBuffer, &beginInfo);
-
-    return vkCommandBuffer;
-}
-
-void App::end_single_time_command(VkCommandBuffer vkCommandBuffer) {
-    vkEndCommandBuffer(vkCommandBuffer);
-
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &vkCommandBuffer;
-
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
-
-    vkFreeCommandBuffers(device, commandPool, 1, &vkCommandBuffer);
-}
-
-void App::transition_image_layout(VkImage image, VkFormat format, VkImageLayout odlLayout, VkImageLayout newLayout) {
-    VkCommandBuffer vkCommandBuffer = begin_single_time_command();
-
-    VkImageMemoryBarrier vkImageMemoryBarrier = {};
-    vkImageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    vkImageMemoryBarrier.oldLayout = odlLayout;
-    vkImageMemoryBarrier.newLayout = newLayout;
-    vkImageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    vkImageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    vkImageMemoryBarrier.image = image;
-    VkImageAspectFlags aspectFlags;
-    if (newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) {
-        aspectFlags = VK_IMAGE_ASPECT_DEPTH_BIT;
-
-        if (has_stencil_component(format)) {
-            aspectFlags |= VK_IMAGE_ASPECT_STENCIL_BIT;
-        }
-    } else {
-        aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
-    }
-
-    vkImageMemoryBarrier.subresourceRange = {
-            aspectFlags,
-            0, 1, 0, 1
-    };
-
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
-
-    if (odlLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        vkImageMemoryBarrier.srcAccessMask = 0;
-        vkImageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-
-    } else if (odlLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        vkImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        vkImageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    }
-    else {
-        throw std::invalid_argument("unsupported layout transition!");
-    }
-
-    vkCmdPipelineBarrier(vkCommandBuffer,
-                         sourceStage, destinationStage,
-                         0,
-                         0, nullptr,
-                         0, nullptr,
-                         1, &vkImageMemoryBarrier);
-
-    end_single_time_command(vkCommandBuffer);
+void App::create_texture_image_view() {
+    textureImageView = create_image_views(textureImage, textureFormat, VK_IMAGE_ASPECT_COLOR_BIT, textureMipLevels);
 }
 
-void App::copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-    VkCommandBuffer vkCommandBuffer = begin_single_time_command();
-
-    VkBufferImageCopy bufferImageCopy = {};
-    bufferImageCopy.bufferOffset = 0;
-    bufferImageCopy.bufferRowLength = 0;
-    bufferImageCopy.bufferImageHeight = 0;
-
-    bufferImageCopy.imageSubresource = {
-            VK_IMAGE_ASPECT_COLOR_BIT,
-            0, 0, 1
-    };
-    bufferImageCopy.imageOffset = {0, 0, 0};
-    bufferImageCopy.imageExtent = {
-            width, height, 1
-    };
-
-    vkCmdCopyBufferToImage(vkCommandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
-
-
+bool App::supports_linear_blit(VkFormat format) {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
 
-    end_single_time_command(vkCommandBuffer);
-}
-
-void App::create_texture_image_view() {
-    textureImageView = create_image_views(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT
+                                    | VK_FORMAT_FEATURE_BLIT_DST_BIT
+                                    | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (formatProperties.optimalTilingFeatures & required) == required;
 }
 
-VkImageView App::create_image_views(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) {
+VkImageView App::create_image_views(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) {
     VkImageViewCreateInfo  viewCreateInfo = {};
     viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     viewCreateInfo.image = image;
@@ -1474,7 +2958,7 @@ VkImageView App::create_image_views(VkImage image, VkFormat format, VkImageAspec
     viewCreateInfo.format = format;
     viewCreateInfo.subresourceRange = {
             aspectFlags,
-            0, 1, 0, 1
+            0, mipLevels, 0, 1
     };
 
     VkImageView imageView;
@@ -1505,7 +2989,8 @@ void App::create_texture_sampler() {
     samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerCreateInfo.mipLodBias = 0.0f;
     samplerCreateInfo.minLod = 0.0f;
-    samplerCreateInfo.maxLod = 0.0f;
+    // created before the texture arrives, the view limits the levels
+    samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
 
     if (vkCreateSampler(device, &samplerCreateInfo, nullptr, &textureSampler) != VK_SUCCESS) {
         throw std::runtime_error("failed to create texture sampler!");
@@ -1513,13 +2998,14 @@ void App::create_texture_sampler() {
 }
 
 void App::create_depth_resources() {
-    VkFormat depthFormat = find_depth_format();
+    depthFormat = find_depth_format();
 
     create_image(swapchainExtent.width, swapchainExtent.height,
                  depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageAllocation);
 
     depthImageView = create_image_views(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+    depthExtent = swapchainExtent;
 
 //    transition_image_layout(depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 
@@ -0,0 +1,151 @@
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../headers/AssetArchive.h"
+
+uint64_t asset_hash(const uint8_t* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+AssetArchive::~AssetArchive() {
+    close();
+}
+
+#ifdef _WIN32
+void AssetArchive::map_file() {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("failed to open asset archive " + path);
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    HANDLE fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = fileMapping ? MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+        if (fileMapping) CloseHandle(fileMapping);
+        CloseHandle(file);
+        throw std::runtime_error("failed to map asset archive " + path);
+    }
+    fileHandle = file;
+    mappingHandle = fileMapping;
+    mapping = static_cast<const uint8_t*>(view);
+    mappingSize = static_cast<size_t>(size.QuadPart);
+}
+
+void AssetArchive::unmap_file() {
+    UnmapViewOfFile(mapping);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+}
+#else
+void AssetArchive::map_file() {
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw std::runtime_error("failed to open asset archive " + path);
+    }
+    struct stat status = {};
+    if (fstat(file, &status) != 0 || status.st_size == 0) {
+        ::close(file);
+        throw std::runtime_error("asset archive " + path + " is empty");
+    }
+    void* view = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // the mapping keeps the file alive
+    ::close(file);
+    if (view == MAP_FAILED) {
+        throw std::runtime_error("failed to map asset archive " + path);
+    }
+    mapping = static_cast<const uint8_t*>(view);
+    mappingSize = status.st_size;
+}
+
+void AssetArchive::unmap_file() {
+    munmap(const_cast<uint8_t*>(mapping), mappingSize);
+}
+#endif
+
+void AssetArchive::open(const std::string& archivePath) {
+    close();
+    path = archivePath;
+    map_file();
+
+    try {
+        ArchiveHeader header;
+        if (mappingSize < sizeof(header)) {
+            throw std::runtime_error(path + ": not an asset archive");
+        }
+        memcpy(&header, mapping, sizeof(header));
+        if (memcmp(header.magic, ASSET_ARCHIVE_MAGIC, sizeof(header.magic)) != 0) {
+            throw std::runtime_error(path + ": not an asset archive");
+        }
+        if (header.version != ASSET_ARCHIVE_VERSION) {
+            throw std::runtime_error(path + ": unsupported archive version " + std::to_string(header.version));
+        }
+
+        uint64_t nameTableOffset = sizeof(header) + uint64_t(header.entryCount) * sizeof(ArchiveEntry);
+        if (nameTableOffset + header.nameTableSize > mappingSize) {
+            throw std::runtime_error(path + ": truncated table of contents");
+        }
+        const char* nameTable = reinterpret_cast<const char*>(mapping + nameTableOffset);
+
+        for (uint32_t i = 0; i < header.entryCount; ++i) {
+            ArchiveEntry entry;
+            memcpy(&entry, mapping + sizeof(header) + i * sizeof(ArchiveEntry), sizeof(entry));
+            if (uint64_t(entry.nameOffset) + entry.nameLength > header.nameTableSize
+                || entry.offset > mappingSize || mappingSize - entry.offset < entry.size) {
+                throw std::runtime_error(path + ": entry " + std::to_string(i) + " is out of bounds");
+            }
+            entries[std::string(nameTable + entry.nameOffset, entry.nameLength)] = entry;
+        }
+    } catch (...) {
+        close();
+        throw;
+    }
+}
+
+void AssetArchive::close() {
+    if (mapping != nullptr) {
+        unmap_file();
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    entries.clear();
+}
+
+AssetView AssetArchive::view(const std::string& name, bool verify) const {
+    auto it = entries.find(name);
+    if (it == entries.end()) {
+        throw std::runtime_error(path + ": no asset named " + name);
+    }
+
+    AssetView assetView;
+    assetView.data = mapping + it->second.offset;
+    assetView.size = it->second.size;
+    if (verify && asset_hash(assetView.data, assetView.size) != it->second.hash) {
+        throw std::runtime_error(path + ": asset " + name + " is corrupt (hash mismatch)");
+    }
+    return assetView;
+}
+
+std::vector<std::string> AssetArchive::names() const {
+    std::vector<std::string> result;
+    for (const auto& entry : entries) {
+        result.push_back(entry.first);
+    }
+    return result;
+}
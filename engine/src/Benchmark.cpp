@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "../headers/Benchmark.h"
+
+const char* frame_stage_name(FrameStage stage) {
+    switch (stage) {
+        case FrameStage::Pace: return "pace";
+        case FrameStage::Wait: return "wait";
+        case FrameStage::Acquire: return "acquire";
+        case FrameStage::Uniform: return "uniform";
+        case FrameStage::Record: return "record";
+        case FrameStage::Submit: return "submit";
+        case FrameStage::Present: return "present";
+        default: return "unknown";
+    }
+}
+
+TimingStats TimingStats::from_samples(std::vector<double> samples) {
+    TimingStats stats;
+    if (samples.empty()) return stats;
+
+    std::sort(samples.begin(), samples.end());
+    stats.count = samples.size();
+    stats.min = samples.front();
+    stats.max = samples.back();
+
+    double sum = 0.0;
+    for (double sample : samples) sum += sample;
+    stats.mean = sum / samples.size();
+
+    // nearest rank
+    auto percentile = [&](double p) {
+        size_t rank = (size_t) std::ceil(p / 100.0 * samples.size());
+        return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+    };
+    stats.p50 = percentile(50.0);
+    stats.p95 = percentile(95.0);
+    stats.p99 = percentile(99.0);
+
+    return stats;
+}
+
+Benchmark::Benchmark(uint32_t warmupFrames, uint32_t measuredFrames)
+    : warmupFrames(warmupFrames), measuredFrames(measuredFrames) {
+    samples.reserve(measuredFrames);
+}
+
+int64_t Benchmark::begin_frame(double nowMs) {
+    uint64_t frame = frameCount++;
+    frameStartMs = nowMs;
+    if (!enabled() || frame < warmupFrames || frame >= total_frames()) return -1;
+
+    samples.emplace_back();
+    return (int64_t) samples.size() - 1;
+}
+
+void Benchmark::end_frame(int64_t sample, double nowMs) {
+    if (sample < 0) return;
+    samples[sample].frameMs = nowMs - frameStartMs;
+}
+
+void Benchmark::record_stage(int64_t sample, FrameStage stage, double ms) {
+    if (sample < 0) return;
+    samples[sample].stageMs[(size_t) stage] = ms;
+}
+
+void Benchmark::set_gpu_time(int64_t sample, double ms) {
+    if (sample < 0 || sample >= (int64_t) samples.size()) return;
+    samples[sample].gpuMs = ms;
+}
+
+void Benchmark::add_gpu_scope(int64_t sample, const std::string& name, double ms) {
+    if (sample < 0 || sample >= (int64_t) samples.size()) return;
+    samples[sample].gpuScopes.emplace_back(name, ms);
+}
+
+void Benchmark::add_counter(int64_t sample, const std::string& name, uint64_t value) {
+    if (sample < 0 || sample >= (int64_t) samples.size()) return;
+    samples[sample].counters.emplace_back(name, value);
+}
+
+void Benchmark::add_event(int64_t sample, const std::string& name, double ms) {
+    if (sample < 0 || sample >= (int64_t) samples.size()) return;
+    samples[sample].events.emplace_back(name, ms);
+}
+
+void Benchmark::add_info(const std::string& key, const std::string& value) {
+    info.emplace_back(key, value);
+}
+
+// names in order of first appearance
+template<typename T>
+static std::vector<std::string> collect_names(const std::vector<FrameSample>& samples,
+                                              std::vector<std::pair<std::string, T>> FrameSample::* member) {
+    std::vector<std::string> names;
+    for (const auto& sample : samples) {
+        for (const auto& entry : sample.*member) {
+            if (std::find(names.begin(), names.end(), entry.first) == names.end()) {
+                names.push_back(entry.first);
+            }
+        }
+    }
+    return names;
+}
+
+template<typename T>
+static bool find_value(const std::vector<std::pair<std::string, T>>& entries, const std::string& name, T& value) {
+    for (const auto& entry : entries) {
+        if (entry.first == name) {
+            value = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::vector<std::pair<std::string, TimingStats>> collect_stats(const std::vector<FrameSample>& samples) {
+    std::vector<std::pair<std::string, TimingStats>> stats;
+    std::vector<double> values;
+
+    for (const auto& sample : samples) values.push_back(sample.frameMs);
+    stats.emplace_back("frame", TimingStats::from_samples(values));
+
+    for (size_t stage = 0; stage < (size_t) FrameStage::Count; ++stage) {
+        values.clear();
+        for (const auto& sample : samples) values.push_back(sample.stageMs[stage]);
+        stats.emplace_back(frame_stage_name((FrameStage) stage), TimingStats::from_samples(values));
+    }
+
+    // only over the frames that had the event
+    for (const auto& name : collect_names(samples, &FrameSample::events)) {
+        values.clear();
+        double ms;
+        for (const auto& sample : samples) {
+            if (find_value(sample.events, name, ms)) values.push_back(ms);
+        }
+        stats.emplace_back(name, TimingStats::from_samples(values));
+    }
+
+    values.clear();
+    for (const auto& sample : samples) {
+        if (sample.gpuMs >= 0.0) values.push_back(sample.gpuMs);
+    }
+    stats.emplace_back("gpu", TimingStats::from_samples(values));
+
+    for (const auto& name : collect_names(samples, &FrameSample::gpuScopes)) {
+        values.clear();
+        double ms;
+        for (const auto& sample : samples) {
+            if (find_value(sample.gpuScopes, name, ms)) values.push_back(ms);
+        }
+        stats.emplace_back("gpu:" + name, TimingStats::from_samples(values));
+    }
+
+    return stats;
+}
+
+void Benchmark::print_summary(std::ostream& out) const {
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << "benchmark: " << warmupFrames << " warmup + " << samples.size() << " measured frames (ms)\n";
+    out << std::left << std::setw(18) << "metric" << std::right
+        << std::setw(10) << "min" << std::setw(10) << "mean" << std::setw(10) << "p50"
+        << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "max" << "\n";
+
+    out << std::fixed << std::setprecision(3);
+    for (const auto& [name, stats] : collect_stats(samples)) {
+        out << std::left << std::setw(18) << name << std::right;
+        if (stats.count == 0) {
+            out << std::setw(10) << "n/a" << "\n";
+            continue;
+        }
+        out << std::setw(10) << stats.min << std::setw(10) << stats.mean << std::setw(10) << stats.p50
+            << std::setw(10) << stats.p95 << std::setw(10) << stats.p99 << std::setw(10) << stats.max << "\n";
+    }
+    out << std::defaultfloat;
+
+    for (const auto& name : collect_names(samples, &FrameSample::counters)) {
+        uint64_t value, sum = 0, count = 0;
+        for (const auto& sample : samples) {
+            if (find_value(sample.counters, name, value)) {
+                sum += value;
+                count++;
+            }
+        }
+        out << std::left << std::setw(18) << name << std::right << std::setw(10) << (count ? sum / count : 0) << " per frame\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void Benchmark::write_report(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open benchmark report " + path);
+    }
+
+    bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    if (csv) {
+        write_csv(file);
+    } else {
+        write_json(file);
+    }
+}
+
+static void write_json_string(std::ostream& out, const std::string& value) {
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+    out << '"';
+}
+
+void Benchmark::write_json(std::ostream& out) const {
+    std::streamsize precision = out.precision();
+    out << std::setprecision(6);
+    out << "{\n  \"info\": {";
+    for (size_t i = 0; i < info.size(); ++i) {
+        out << (i ? ",\n    " : "\n    ");
+        write_json_string(out, info[i].first);
+        out << ": ";
+        write_json_string(out, info[i].second);
+    }
+    out << "\n  },\n";
+    out << "  \"warmup_frames\": " << warmupFrames << ",\n";
+    out << "  \"measured_frames\": " << samples.size() << ",\n";
+
+    out << "  \"stats_ms\": {";
+    auto stats = collect_stats(samples);
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const auto& [name, s] = stats[i];
+        out << (i ? ",\n    " : "\n    ") << '"' << name << "\": ";
+        if (s.count == 0) {
+            out << "null";
+            continue;
+        }
+        out << "{\"min\": " << s.min << ", \"mean\": " << s.mean << ", \"p50\": " << s.p50
+            << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << "}";
+    }
+    out << "\n  },\n";
+
+    out << "  \"counters_mean\": {";
+    auto counterNames = collect_names(samples, &FrameSample::counters);
+    for (size_t i = 0; i < counterNames.size(); ++i) {
+        uint64_t value, sum = 0, count = 0;
+        for (const auto& sample : samples) {
+            if (find_value(sample.counters, counterNames[i], value)) {
+                sum += value;
+                count++;
+            }
+        }
+        out << (i ? ",\n    " : "\n    ") << '"' << counterNames[i] << "\": " << (count ? sum / count : 0);
+    }
+    out << "\n  },\n";
+
+    out << "  \"frames_ms\": [";
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const auto& sample = samples[i];
+        out << (i ? ",\n    " : "\n    ") << "{\"frame\": " << sample.frameMs;
+        for (size_t stage = 0; stage < (size_t) FrameStage::Count; ++stage) {
+            out << ", \"" << frame_stage_name((FrameStage) stage) << "\": " << sample.stageMs[stage];
+        }
+        for (const auto& [name, ms] : sample.events) {
+            out << ", \"" << name << "\": " << ms;
+        }
+        out << ", \"gpu\": ";
+        if (sample.gpuMs >= 0.0) out << sample.gpuMs; else out << "null";
+        for (const auto& [name, ms] : sample.gpuScopes) {
+            out << ", \"gpu:" << name << "\": " << ms;
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+    out.precision(precision);
+}
+
+void Benchmark::write_csv(std::ostream& out) const {
+    std::streamsize precision = out.precision();
+    out << std::setprecision(6);
+    out << "frame,frame_ms";
+    for (size_t stage = 0; stage < (size_t) FrameStage::Count; ++stage) {
+        out << "," << frame_stage_name((FrameStage) stage) << "_ms";
+    }
+    auto eventNames = collect_names(samples, &FrameSample::events);
+    for (const auto& name : eventNames) out << "," << name << "_ms";
+    out << ",gpu_ms";
+    auto scopeNames = collect_names(samples, &FrameSample::gpuScopes);
+    for (const auto& name : scopeNames) out << ",gpu:" << name << "_ms";
+    auto counterNames = collect_names(samples, &FrameSample::counters);
+    for (const auto& name : counterNames) out << "," << name;
+    out << "\n";
+
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const auto& sample = samples[i];
+        out << i << "," << sample.frameMs;
+        for (double ms : sample.stageMs) out << "," << ms;
+        for (const auto& name : eventNames) {
+            double ms;
+            out << ",";
+            if (find_value(sample.events, name, ms)) out << ms;
+        }
+        out << ",";
+        if (sample.gpuMs >= 0.0) out << sample.gpuMs;
+        for (const auto& name : scopeNames) {
+            double ms;
+            out << ",";
+            if (find_value(sample.gpuScopes, name, ms)) out << ms;
+        }
+        for (const auto& name : counterNames) {
+            uint64_t value;
+            out << ",";
+            if (find_value(sample.counters, name, value)) out << value;
+        }
+        out << "\n";
+    }
+    out.precision(precision);
+}
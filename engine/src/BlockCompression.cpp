@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "../headers/BlockCompression.h"
+
+struct Block {
+    // 16 texels in row order, RGBA
+    uint8_t texels[16][4];
+};
+
+static Block fetch_block(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY) {
+    Block block;
+    for (uint32_t y = 0; y < 4; ++y) {
+        for (uint32_t x = 0; x < 4; ++x) {
+            uint32_t srcX = std::min(blockX * 4 + x, width - 1);
+            uint32_t srcY = std::min(blockY * 4 + y, height - 1);
+            memcpy(block.texels[y * 4 + x], rgba + (size_t(srcY) * width + srcX) * 4, 4);
+        }
+    }
+    return block;
+}
+
+template<typename Encoder>
+static std::vector<uint8_t> encode_blocks(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockBytes, Encoder encoder) {
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    std::vector<uint8_t> output(size_t(blocksX) * blocksY * blockBytes);
+    for (uint32_t y = 0; y < blocksY; ++y) {
+        for (uint32_t x = 0; x < blocksX; ++x) {
+            encoder(fetch_block(rgba, width, height, x, y), output.data() + (size_t(y) * blocksX + x) * blockBytes);
+        }
+    }
+    return output;
+}
+
+// endpoints at the extremes of the block's principal axis over the first `channels` channels
+static void principal_endpoints(const Block& block, uint32_t channels, float low[4], float high[4]) {
+    float mean[4] = {};
+    for (const auto& texel : block.texels) {
+        for (uint32_t c = 0; c < channels; ++c) mean[c] += texel[c] / 16.0f;
+    }
+
+    float covariance[4][4] = {};
+    for (const auto& texel : block.texels) {
+        for (uint32_t i = 0; i < channels; ++i) {
+            for (uint32_t j = 0; j < channels; ++j) {
+                covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+            }
+        }
+    }
+
+    // a few power iterations are plenty for 16 points
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (uint32_t iteration = 0; iteration < 8; ++iteration) {
+        float next[4] = {};
+        for (uint32_t i = 0; i < channels; ++i) {
+            for (uint32_t j = 0; j < channels; ++j) next[i] += covariance[i][j] * axis[j];
+        }
+        float length = 0.0f;
+        for (uint32_t c = 0; c < channels; ++c) length += next[c] * next[c];
+        if (length < 1e-12f) break;
+        length = std::sqrt(length);
+        for (uint32_t c = 0; c < channels; ++c) axis[c] = next[c] / length;
+    }
+
+    float minProjection = std::numeric_limits<float>::max();
+    float maxProjection = std::numeric_limits<float>::lowest();
+    for (const auto& texel : block.texels) {
+        float projection = 0.0f;
+        for (uint32_t c = 0; c < channels; ++c) projection += (texel[c] - mean[c]) * axis[c];
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+    for (uint32_t c = 0; c < channels; ++c) {
+        low[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+        high[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+    }
+}
+
+static uint32_t squared_error(const uint8_t* a, const int32_t* b, uint32_t channels) {
+    uint32_t error = 0;
+    for (uint32_t c = 0; c < channels; ++c) {
+        int32_t d = int32_t(a[c]) - b[c];
+        error += d * d;
+    }
+    return error;
+}
+
+// BC1
+
+static uint16_t pack_565(const float color[3]) {
+    uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+    uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+    uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(uint16_t packed, int32_t color[3]) {
+    int32_t r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+static void encode_bc1_block(const Block& block, uint8_t* output) {
+    float low[4], high[4];
+    principal_endpoints(block, 3, low, high);
+    uint16_t color0 = pack_565(high);
+    uint16_t color1 = pack_565(low);
+
+    // four color mode needs color0 > color1
+    if (color0 < color1) std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        int32_t palette[4][3];
+        unpack_565(color0, palette[0]);
+        unpack_565(color1, palette[1]);
+        for (uint32_t c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (uint32_t i = 0; i < 16; ++i) {
+            uint32_t best = 0, bestError = std::numeric_limits<uint32_t>::max();
+            for (uint32_t p = 0; p < 4; ++p) {
+                uint32_t error = squared_error(block.texels[i], palette[p], 3);
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= best << (2 * i);
+        }
+    }
+
+    memcpy(output, &color0, 2);
+    memcpy(output + 2, &color1, 2);
+    memcpy(output + 4, &indices, 4);
+}
+
+std::vector<uint8_t> encode_bc1(const uint8_t* rgba, uint32_t width, uint32_t height) {
+    return encode_blocks(rgba, width, height, 8, encode_bc1_block);
+}
+
+// BC7 mode 6
+
+const int32_t BC7_WEIGHTS_4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+class BitWriter {
+    uint8_t* output;
+    uint32_t position = 0;
+
+public:
+    explicit BitWriter(uint8_t* output) : output(output) { memset(output, 0, 16); }
+
+    void write(uint32_t value, uint32_t bits) {
+        for (uint32_t i = 0; i < bits; ++i, ++position) {
+            output[position / 8] |= ((value >> i) & 1) << (position % 8);
+        }
+    }
+};
+
+// best 7 bit value + shared p-bit for one RGBA endpoint
+static void quantize_bc7_endpoint(const float color[4], uint8_t quantized[4], uint32_t& pBit) {
+    uint32_t bestError = std::numeric_limits<uint32_t>::max();
+    for (uint32_t p = 0; p < 2; ++p) {
+        uint8_t candidate[4];
+        uint32_t error = 0;
+        for (uint32_t c = 0; c < 4; ++c) {
+            int32_t value = std::clamp(static_cast<int32_t>(std::lround((color[c] - p) / 2.0f)), 0, 127);
+            candidate[c] = static_cast<uint8_t>(value);
+            int32_t d = ((value << 1) | p) - static_cast<int32_t>(std::lround(color[c]));
+            error += d * d;
+        }
+        if (error < bestError) {
+            bestError = error;
+            pBit = p;
+            memcpy(quantized, candidate, 4);
+        }
+    }
+}
+
+static void encode_bc7_block(const Block& block, uint8_t* output) {
+    float low[4], high[4];
+    principal_endpoints(block, 4, low, high);
+
+    uint8_t endpoints[2][4];
+    uint32_t pBits[2];
+    quantize_bc7_endpoint(low, endpoints[0], pBits[0]);
+    quantize_bc7_endpoint(high, endpoints[1], pBits[1]);
+
+    int32_t palette[16][4];
+    for (uint32_t i = 0; i < 16; ++i) {
+        for (uint32_t c = 0; c < 4; ++c) {
+            int32_t e0 = (endpoints[0][c] << 1) | pBits[0];
+            int32_t e1 = (endpoints[1][c] << 1) | pBits[1];
+            palette[i][c] = ((64 - BC7_WEIGHTS_4[i]) * e0 + BC7_WEIGHTS_4[i] * e1 + 32) >> 6;
+        }
+    }
+
+    uint32_t indices[16];
+    for (uint32_t i = 0; i < 16; ++i) {
+        uint32_t bestError = std::numeric_limits<uint32_t>::max();
+        for (uint32_t p = 0; p < 16; ++p) {
+            uint32_t error = squared_error(block.texels[i], palette[p], 4);
+            if (error < bestError) {
+                bestError = error;
+                indices[i] = p;
+            }
+        }
+    }
+
+    // the anchor index is stored with its top bit implied zero
+    if (indices[0] >= 8) {
+        std::swap(endpoints[0], endpoints[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (auto& index : indices) index = 15 - index;
+    }
+
+    BitWriter writer(output);
+    writer.write(1 << 6, 7);
+    for (uint32_t c = 0; c < 4; ++c) {
+        writer.write(endpoints[0][c], 7);
+        writer.write(endpoints[1][c], 7);
+    }
+    writer.write(pBits[0], 1);
+    writer.write(pBits[1], 1);
+    writer.write(indices[0], 3);
+    for (uint32_t i = 1; i < 16; ++i) writer.write(indices[i], 4);
+}
+
+std::vector<uint8_t> encode_bc7(const uint8_t* rgba, uint32_t width, uint32_t height) {
+    return encode_blocks(rgba, width, height, 16, encode_bc7_block);
+}
+
+// ETC2 RGB (ETC1 subset)
+
+const int32_t ETC_MODIFIERS[8][4] = {
+        {2, 8, -2, -8}, {5, 17, -5, -17}, {9, 29, -9, -29}, {13, 42, -13, -42},
+        {18, 60, -18, -60}, {24, 80, -24, -80}, {33, 106, -33, -106}, {47, 183, -47, -183}
+};
+
+struct EtcSubblock {
+    uint32_t table = 0;
+    // per texel of the block, only the subblock's texels are meaningful
+    uint32_t selectors[16] = {};
+    uint32_t error = 0;
+};
+
+static bool in_subblock(uint32_t texel, bool flip, uint32_t subblock) {
+    uint32_t x = texel % 4, y = texel / 4;
+    return (flip ? y / 2 : x / 2) == subblock;
+}
+
+static EtcSubblock fit_subblock(const Block& block, bool flip, uint32_t subblock, const int32_t base[3]) {
+    EtcSubblock best;
+    best.error = std::numeric_limits<uint32_t>::max();
+    for (uint32_t table = 0; table < 8; ++table) {
+        EtcSubblock candidate;
+        candidate.table = table;
+        for (uint32_t i = 0; i < 16; ++i) {
+            if (!in_subblock(i, flip, subblock)) continue;
+            uint32_t bestError = std::numeric_limits<uint32_t>::max();
+            for (uint32_t s = 0; s < 4; ++s) {
+                int32_t color[3];
+                for (uint32_t c = 0; c < 3; ++c) color[c] = std::clamp(base[c] + ETC_MODIFIERS[table][s], 0, 255);
+                uint32_t error = squared_error(block.texels[i], color, 3);
+                if (error < bestError) {
+                    bestError = error;
+                    candidate.selectors[i] = s;
+                }
+            }
+            candidate.error += bestError;
+        }
+        if (candidate.error < best.error) best = candidate;
+    }
+    return best;
+}
+
+static void subblock_average(const Block& block, bool flip, uint32_t subblock, float average[3]) {
+    average[0] = average[1] = average[2] = 0.0f;
+    for (uint32_t i = 0; i < 16; ++i) {
+        if (!in_subblock(i, flip, subblock)) continue;
+        for (uint32_t c = 0; c < 3; ++c) average[c] += block.texels[i][c] / 8.0f;
+    }
+}
+
+static void encode_etc2_block(const Block& block, uint8_t* output) {
+    uint64_t bestBits = 0;
+    uint32_t bestError = std::numeric_limits<uint32_t>::max();
+
+    for (uint32_t flip = 0; flip < 2; ++flip) {
+        float averages[2][3];
+        subblock_average(block, flip, 0, averages[0]);
+        subblock_average(block, flip, 1, averages[1]);
+
+        for (uint32_t differential = 0; differential < 2; ++differential) {
+            int32_t quantized[2][3];
+            int32_t bases[2][3];
+            bool valid = true;
+            for (uint32_t c = 0; c < 3; ++c) {
+                if (differential) {
+                    quantized[0][c] = std::clamp(static_cast<int32_t>(std::lround(averages[0][c] * 31.0f / 255.0f)), 0, 31);
+                    int32_t second = std::clamp(static_cast<int32_t>(std::lround(averages[1][c] * 31.0f / 255.0f)), 0, 31);
+                    // the delta is a 3 bit signed value, blocks whose colors are too far apart use individual mode
+                    quantized[1][c] = second - quantized[0][c];
+                    if (quantized[1][c] < -4 || quantized[1][c] > 3) valid = false;
+                    int32_t values[2] = {quantized[0][c], second};
+                    for (uint32_t s = 0; s < 2; ++s) bases[s][c] = (values[s] << 3) | (values[s] >> 2);
+                } else {
+                    for (uint32_t s = 0; s < 2; ++s) {
+                        quantized[s][c] = std::clamp(static_cast<int32_t>(std::lround(averages[s][c] * 15.0f / 255.0f)), 0, 15);
+                        bases[s][c] = quantized[s][c] * 17;
+                    }
+                }
+            }
+            if (!valid) continue;
+
+            EtcSubblock subblocks[2] = {
+                    fit_subblock(block, flip, 0, bases[0]),
+                    fit_subblock(block, flip, 1, bases[1])
+            };
+            uint32_t error = subblocks[0].error + subblocks[1].error;
+            if (error >= bestError) continue;
+            bestError = error;
+
+            uint64_t bits = 0;
+            for (uint32_t c = 0; c < 3; ++c) {
+                uint64_t byte = differential
+                        ? (uint64_t(quantized[0][c]) << 3) | (uint64_t(quantized[1][c]) & 7)
+                        : (uint64_t(quantized[0][c]) << 4) | uint64_t(quantized[1][c]);
+                bits |= byte << (56 - 8 * c);
+            }
+            bits |= uint64_t((subblocks[0].table << 5) | (subblocks[1].table << 2) | (differential << 1) | flip) << 32;
+
+            // selector bits are stored column major, MSBs in the upper half
+            for (uint32_t i = 0; i < 16; ++i) {
+                uint32_t x = i % 4, y = i / 4;
+                uint32_t subblock = in_subblock(i, flip, 0) ? 0 : 1;
+                uint32_t code = subblocks[subblock].selectors[i];
+                uint32_t bit = x * 4 + y;
+                bits |= uint64_t(code >> 1) << (16 + bit);
+                bits |= uint64_t(code & 1) << bit;
+            }
+            bestBits = bits;
+        }
+    }
+
+    for (uint32_t i = 0; i < 8; ++i) {
+        output[i] = static_cast<uint8_t>(bestBits >> (56 - 8 * i));
+    }
+}
+
+std::vector<uint8_t> encode_etc2_rgb(const uint8_t* rgba, uint32_t width, uint32_t height) {
+    return encode_blocks(rgba, width, height, 8, encode_etc2_block);
+}
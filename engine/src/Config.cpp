@@ -0,0 +1,223 @@
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "../headers/Config.h"
+#include "../headers/VertexLayout.h"
+
+static uint32_t parse_uint(const std::string& flag, int& i, int argc, char** argv) {
+    if (i + 1 >= argc) {
+        throw std::invalid_argument(flag + " expects a value");
+    }
+    try {
+        return static_cast<uint32_t>(std::stoul(argv[++i]));
+    } catch (const std::exception&) {
+        throw std::invalid_argument(flag + " expects an unsigned integer, got '" + argv[i] + "'");
+    }
+}
+
+static double parse_double(const std::string& flag, int& i, int argc, char** argv) {
+    if (i + 1 >= argc) {
+        throw std::invalid_argument(flag + " expects a value");
+    }
+    try {
+        return std::stod(argv[++i]);
+    } catch (const std::exception&) {
+        throw std::invalid_argument(flag + " expects a number, got '" + argv[i] + "'");
+    }
+}
+
+static std::string parse_string(const std::string& flag, int& i, int argc, char** argv) {
+    if (i + 1 >= argc) {
+        throw std::invalid_argument(flag + " expects a value");
+    }
+    return argv[++i];
+}
+
+AppConfig parse_args(int argc, char** argv) {
+    AppConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "--frames-in-flight") {
+            config.framesInFlight = parse_uint(arg, i, argc, argv);
+            if (config.framesInFlight < MIN_FRAME_IN_FLIGHT || config.framesInFlight > MAX_FRAME_IN_FLIGHT) {
+                throw std::invalid_argument("--frames-in-flight must be between "
+                                            + std::to_string(MIN_FRAME_IN_FLIGHT) + " and "
+                                            + std::to_string(MAX_FRAME_IN_FLIGHT));
+            }
+        } else if (arg == "--pipeline-cache") {
+            config.pipelineCachePath = parse_string(arg, i, argc, argv);
+        } else if (arg == "--no-pipeline-cache") {
+            config.pipelineCachePath.clear();
+        } else if (arg == "--headless") {
+            config.headless = true;
+        } else if (arg == "--width") {
+            config.width = parse_uint(arg, i, argc, argv);
+        } else if (arg == "--height") {
+            config.height = parse_uint(arg, i, argc, argv);
+        } else if (arg == "--frames") {
+            config.frameLimit = parse_uint(arg, i, argc, argv);
+        } else if (arg == "--duration") {
+            config.durationSeconds = parse_double(arg, i, argc, argv);
+            if (config.durationSeconds < 0.0) {
+                throw std::invalid_argument("--duration must not be negative");
+            }
+        } else if (arg == "--no-validation") {
+            config.validation = false;
+        } else if (arg == "--output") {
+            config.outputPath = parse_string(arg, i, argc, argv);
+        } else if (arg == "--present-mode") {
+            std::string mode = parse_string(arg, i, argc, argv);
+            if (mode == "auto") config.presentMode = PresentMode::Auto;
+            else if (mode == "fifo") config.presentMode = PresentMode::Fifo;
+            else if (mode == "fifo-relaxed") config.presentMode = PresentMode::FifoRelaxed;
+            else if (mode == "mailbox") config.presentMode = PresentMode::Mailbox;
+            else if (mode == "immediate") config.presentMode = PresentMode::Immediate;
+            else throw std::invalid_argument("--present-mode must be auto, fifo, fifo-relaxed, mailbox or immediate");
+        } else if (arg == "--target-fps") {
+            config.targetFps = parse_double(arg, i, argc, argv);
+            if (config.targetFps < 0.0) {
+                throw std::invalid_argument("--target-fps must not be negative");
+            }
+        } else if (arg == "--max-queued-frames") {
+            config.maxQueuedFrames = parse_uint(arg, i, argc, argv);
+            if (config.maxQueuedFrames > MAX_QUEUED_FRAMES) {
+                throw std::invalid_argument("--max-queued-frames must be at most " + std::to_string(MAX_QUEUED_FRAMES));
+            }
+        } else if (arg == "--no-timeline") {
+            config.timelineSemaphores = false;
+        } else if (arg == "--instances") {
+            config.instanceCount = parse_uint(arg, i, argc, argv);
+            if (config.instanceCount < 1 || config.instanceCount > MAX_INSTANCES) {
+                throw std::invalid_argument("--instances must be between 1 and " + std::to_string(MAX_INSTANCES));
+            }
+        } else if (arg == "--draw-batch") {
+            config.drawBatchSize = parse_uint(arg, i, argc, argv);
+        } else if (arg == "--transforms") {
+            std::string path = parse_string(arg, i, argc, argv);
+            if (path == "instanced") config.transformPath = TransformPath::Instanced;
+            else if (path == "push") config.transformPath = TransformPath::Push;
+            else if (path == "uniform") config.transformPath = TransformPath::Uniform;
+            else throw std::invalid_argument("--transforms must be instanced, push or uniform");
+        } else if (arg == "--render-path") {
+            std::string path = parse_string(arg, i, argc, argv);
+            if (path == "renderpass") config.renderPath = RenderPath::RenderPass;
+            else if (path == "dynamic") config.renderPath = RenderPath::Dynamic;
+            else throw std::invalid_argument("--render-path must be renderpass or dynamic");
+        } else if (arg == "--gpu-culling") {
+            config.gpuCulling = true;
+        } else if (arg == "--record-threads") {
+            config.recordThreads = parse_uint(arg, i, argc, argv);
+            if (config.recordThreads > MAX_RECORD_THREADS) {
+                throw std::invalid_argument("--record-threads must be at most " + std::to_string(MAX_RECORD_THREADS));
+            }
+        } else if (arg == "--transform-threads") {
+            config.transformThreads = parse_uint(arg, i, argc, argv);
+            if (config.transformThreads > MAX_TRANSFORM_THREADS) {
+                throw std::invalid_argument("--transform-threads must be at most " + std::to_string(MAX_TRANSFORM_THREADS));
+            }
+        } else if (arg == "--mesh") {
+            config.meshPath = parse_string(arg, i, argc, argv);
+        } else if (arg == "--no-mesh-optimize") {
+            config.optimizeMesh = false;
+        } else if (arg == "--vertex-layout") {
+            config.vertexLayout = parse_string(arg, i, argc, argv);
+            parse_vertex_layout(config.vertexLayout);
+        } else if (arg == "--assets") {
+            config.assetArchivePath = parse_string(arg, i, argc, argv);
+        } else if (arg == "--texture") {
+            config.texturePath = parse_string(arg, i, argc, argv);
+        } else if (arg == "--cpu-mipmaps") {
+            config.cpuMipmaps = true;
+        } else if (arg == "--decode-threads") {
+            config.decodeThreads = parse_uint(arg, i, argc, argv);
+            if (config.decodeThreads > MAX_DECODE_THREADS) {
+                throw std::invalid_argument("--decode-threads must be at most " + std::to_string(MAX_DECODE_THREADS));
+            }
+        } else if (arg == "--sync-textures") {
+            config.syncTextures = true;
+        } else if (arg == "--materials") {
+            config.materialCount = parse_uint(arg, i, argc, argv);
+            if (config.materialCount < 1 || config.materialCount > MAX_MATERIALS) {
+                throw std::invalid_argument("--materials must be between 1 and " + std::to_string(MAX_MATERIALS));
+            }
+        } else if (arg == "--no-bindless") {
+            config.bindless = false;
+        } else if (arg == "--benchmark") {
+            config.benchmarkFrames = parse_uint(arg, i, argc, argv);
+            if (config.benchmarkFrames == 0) {
+                throw std::invalid_argument("--benchmark needs at least one measured frame");
+            }
+        } else if (arg == "--warmup") {
+            config.warmupFrames = parse_uint(arg, i, argc, argv);
+        } else if (arg == "--report") {
+            config.reportPath = parse_string(arg, i, argc, argv);
+        } else if (arg == "--gpu-profile") {
+            config.gpuProfile = true;
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            std::exit(EXIT_SUCCESS);
+        } else {
+            throw std::invalid_argument("unknown argument '" + arg + "' (see --help)");
+        }
+    }
+
+    if (config.width == 0 || config.height == 0) {
+        throw std::invalid_argument("--width and --height must be greater than 0");
+    }
+    if (config.headless && config.frameLimit == 0 && config.durationSeconds == 0.0 && config.benchmarkFrames == 0) {
+        throw std::invalid_argument("--headless needs --frames, --duration or --benchmark");
+    }
+    if (!config.reportPath.empty() && config.benchmarkFrames == 0) {
+        throw std::invalid_argument("--report needs --benchmark");
+    }
+    if (config.gpuCulling && config.transformPath != TransformPath::Instanced) {
+        throw std::invalid_argument("--gpu-culling needs --transforms instanced");
+    }
+    if (!config.outputPath.empty() && !config.headless) {
+        throw std::invalid_argument("--output is only supported with --headless");
+    }
+
+    return config;
+}
+
+void print_usage(const char* program) {
+    std::cout << "usage: " << program << " [options]\n"
+              << "\t--frames-in-flight <1-4>\tframes the CPU may record ahead of the GPU (default 2)\n"
+              << "\t--pipeline-cache <path>\tpipeline cache file (default pipeline_cache.bin)\n"
+              << "\t--no-pipeline-cache\tdo not load or save the pipeline cache\n"
+              << "\t--headless\t\trender offscreen without a window or swapchain\n"
+              << "\t--width <px>, --height <px>\tinitial window / offscreen size (default 800x600)\n"
+              << "\t--frames <n>\t\tstop after n frames\n"
+              << "\t--duration <seconds>\tstop after the given time\n"
+              << "\t--no-validation\t\tdo not enable VK_LAYER_KHRONOS_validation\n"
+              << "\t--output <file.ppm>\theadless only, write the last frame to a PPM image\n"
+              << "\t--present-mode <mode>\tauto, fifo, fifo-relaxed, mailbox or immediate (default auto: mailbox, else fifo)\n"
+              << "\t--target-fps <hz>\tcap the frame rate, 0 is uncapped (default 0)\n"
+              << "\t--max-queued-frames <n>\tframes presented but not yet shown before the next one starts, 0 leaves it to --frames-in-flight (default 0)\n"
+              << "\t--no-timeline\t\tsynchronize with a fence per submission instead of a timeline semaphore\n"
+              << "\t--instances <n>\t\tnumber of rotating objects in the scene (default 1)\n"
+              << "\t--draw-batch <n>\tinstances per draw call, 0 draws all instances at once (default 0)\n"
+              << "\t--transforms <path>\tinstanced (instance buffer), push (push constants) or uniform (dynamic UBO offsets) (default instanced)\n"
+              << "\t--render-path <path>\trenderpass (VkRenderPass + framebuffers) or dynamic (vkCmdBeginRendering) (default renderpass)\n"
+              << "\t--gpu-culling\t\tfrustum cull instances in a compute pass and draw them indirectly\n"
+              << "\t--record-threads <n>\trecord secondary command buffers on n threads, 0 records inline (default 0)\n"
+              << "\t--transform-threads <n>\tupdate the object transforms on n threads, 0 uses the main thread (default 0)\n"
+              << "\t--mesh <path>\t\t.obj, .gltf or .glb model drawn by every instance (default built-in quads)\n"
+              << "\t--no-mesh-optimize\tkeep the imported triangle and vertex order\n"
+              << "\t--vertex-layout <spec>\tfloat, compact or attribute=encoding pairs, e.g. position=half (default compact)\n"
+              << "\t--assets <file.mpak>\tload shaders and the texture from a memory mapped asset archive\n"
+              << "\t--texture <path>\t\tJPEG/PNG or cooked .mtex texture (default ../textures/mango.jpg)\n"
+              << "\t--cpu-mipmaps\t\tbuild texture mip chains on the CPU instead of with GPU blits\n"
+              << "\t--decode-threads <n>\ttexture decoding threads, 0 uses all but one hardware thread (default 0)\n"
+              << "\t--sync-textures\t\twait for every texture at startup instead of showing a placeholder\n"
+              << "\t--materials <n>\t\tnumber of tinted materials the objects cycle through (default 1)\n"
+              << "\t--no-bindless\t\tbind the texture per frame slot instead of indexing a descriptor array\n"
+              << "\t--benchmark <frames>\tmeasure this many frames, then print frame time statistics and exit\n"
+              << "\t--warmup <frames>\tframes run before measuring starts (default 60)\n"
+              << "\t--report <file>\t\twrite the benchmark as .json (summary + samples) or .csv (one row per frame)\n"
+              << "\t--gpu-profile\t\tprint GPU time per render scope and pipeline statistics on exit\n";
+}
@@ -0,0 +1,96 @@
+#include "../headers/DeletionQueue.h"
+
+void DeletionQueue::init(VkDevice vkDevice, MemoryAllocator& memoryAllocator, GpuTimeline& gpuTimeline) {
+    device = vkDevice;
+    allocator = &memoryAllocator;
+    timeline = &gpuTimeline;
+}
+
+void DeletionQueue::destroy() {
+    for (auto& retired : pending) {
+        destroy_retired(retired);
+    }
+    pending.clear();
+}
+
+DeletionQueue::Retired& DeletionQueue::current() {
+    uint64_t value = timeline->last_submitted();
+    if (pending.empty() || pending.back().value != value) {
+        pending.emplace_back();
+        pending.back().value = value;
+    }
+    pendingObjects++;
+    return pending.back();
+}
+
+void DeletionQueue::retire_framebuffer(VkFramebuffer framebuffer) {
+    if (framebuffer == VK_NULL_HANDLE) return;
+    current().framebuffers.push_back(framebuffer);
+}
+
+void DeletionQueue::retire_image_view(VkImageView imageView) {
+    if (imageView == VK_NULL_HANDLE) return;
+    current().imageViews.push_back(imageView);
+}
+
+void DeletionQueue::retire_image(VkImage image, Allocation allocation) {
+    if (image == VK_NULL_HANDLE) return;
+    current().images.emplace_back(image, allocation);
+}
+
+void DeletionQueue::retire_buffer(VkBuffer buffer, Allocation allocation) {
+    if (buffer == VK_NULL_HANDLE) return;
+    current().buffers.emplace_back(buffer, allocation);
+}
+
+void DeletionQueue::retire_allocation(Allocation allocation) {
+    if (allocation.memory == VK_NULL_HANDLE) return;
+    current().allocations.push_back(allocation);
+}
+
+void DeletionQueue::retire_swapchain(VkSwapchainKHR swapchain) {
+    if (swapchain == VK_NULL_HANDLE) return;
+    current().swapchains.push_back(swapchain);
+}
+
+void DeletionQueue::destroy_retired(Retired& retired) {
+    // users before what they use: framebuffers, views, then images, memory and swapchains
+    for (auto framebuffer : retired.framebuffers) {
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+    for (auto imageView : retired.imageViews) {
+        vkDestroyImageView(device, imageView, nullptr);
+    }
+    for (auto& [image, allocation] : retired.images) {
+        vkDestroyImage(device, image, nullptr);
+        allocator->free(allocation);
+    }
+    for (auto& [buffer, allocation] : retired.buffers) {
+        vkDestroyBuffer(device, buffer, nullptr);
+        allocator->free(allocation);
+    }
+    for (auto& allocation : retired.allocations) {
+        allocator->free(allocation);
+    }
+    for (auto swapchain : retired.swapchains) {
+        vkDestroySwapchainKHR(device, swapchain, nullptr);
+    }
+
+    uint64_t count = retired.framebuffers.size() + retired.imageViews.size() + retired.images.size()
+                     + retired.buffers.size() + retired.allocations.size() + retired.swapchains.size();
+    pendingObjects -= count;
+    destroyedObjects += count;
+}
+
+uint64_t DeletionQueue::collect() {
+    if (pending.empty()) return 0;
+
+    // values only grow along the queue, one poll covers all of them
+    uint64_t destroyedBefore = destroyedObjects;
+    uint64_t completed = timeline->completed();
+    while (!pending.empty() && pending.front().value <= completed) {
+        destroy_retired(pending.front());
+        pending.pop_front();
+    }
+    return destroyedObjects - destroyedBefore;
+}
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <thread>
+
+#include "../headers/FramePacer.h"
+
+// bounds of the adaptive spin margin
+const double MIN_SPIN_MARGIN_MS = 0.2;
+const double MAX_SPIN_MARGIN_MS = 4.0;
+
+static double clock_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+FramePacer::FramePacer(double targetFps) : periodMs(targetFps > 0.0 ? 1000.0 / targetFps : 0.0) {
+}
+
+double FramePacer::wait() {
+    if (!limits_rate()) return 0.0;
+
+    double startMs = clock_ms();
+    if (nextDeadlineMs < 0.0) {
+        nextDeadlineMs = startMs + periodMs;
+        return 0.0;
+    }
+
+    double sleepUntilMs = nextDeadlineMs - spinMarginMs;
+    if (sleepUntilMs > startMs) {
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(sleepUntilMs - startMs));
+        // oversleep pushes the margin up quickly, punctual wakeups let it shrink slowly
+        double lateMs = clock_ms() - sleepUntilMs;
+        double wantedMs = std::clamp(lateMs * 1.5, MIN_SPIN_MARGIN_MS, MAX_SPIN_MARGIN_MS);
+        spinMarginMs = wantedMs > spinMarginMs ? wantedMs : spinMarginMs * 0.95 + wantedMs * 0.05;
+    }
+    double nowMs = clock_ms();
+    while (nowMs < nextDeadlineMs) {
+        std::this_thread::yield();
+        nowMs = clock_ms();
+    }
+
+    nextDeadlineMs = nowMs - nextDeadlineMs > periodMs ? nowMs + periodMs : nextDeadlineMs + periodMs;
+    return nowMs - startMs;
+}
+
+void FramePacer::frame_done(double nowMs) {
+    if (lastFrameMs >= 0.0) {
+        double interval = nowMs - lastFrameMs;
+        count++;
+        double delta = interval - mean;
+        mean += delta / count;
+        m2 += delta * (interval - mean);
+        minMs = count == 1 ? interval : std::min(minMs, interval);
+        maxMs = count == 1 ? interval : std::max(maxMs, interval);
+        if (limits_rate() && interval > 1.5 * periodMs) missed++;
+    }
+    lastFrameMs = nowMs;
+}
+
+FramePacingStats FramePacer::stats() const {
+    FramePacingStats stats;
+    stats.count = count;
+    stats.meanMs = mean;
+    stats.varianceMs2 = count > 1 ? m2 / (count - 1) : 0.0;
+    stats.stddevMs = std::sqrt(stats.varianceMs2);
+    stats.minMs = minMs;
+    stats.maxMs = maxMs;
+    stats.missed = missed;
+    return stats;
+}
+
+void FramePacer::print_summary(std::ostream& out) const {
+    FramePacingStats s = stats();
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << "frame pacing: " << s.count << " intervals, ";
+    if (limits_rate()) out << "target " << periodMs << " ms, ";
+    out << "mean " << s.meanMs << " ms, stddev " << s.stddevMs << " ms (variance " << s.varianceMs2
+        << " ms^2), min " << s.minMs << " ms, max " << s.maxMs << " ms";
+    if (limits_rate()) out << ", " << s.missed << " missed";
+    out << "\n";
+    out.flags(flags);
+    out.precision(precision);
+}
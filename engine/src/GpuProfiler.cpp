@@ -0,0 +1,230 @@
+#include <iomanip>
+#include <stdexcept>
+
+#include "../headers/GpuProfiler.h"
+
+const VkQueryPipelineStatisticFlags PIPELINE_STATISTICS =
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT
+        | VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT
+        | VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+        | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT
+        | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT
+        | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+const uint32_t PIPELINE_STATISTICS_COUNT = 6;
+
+void GpuProfiler::init(VkPhysicalDevice physicalDevice, VkDevice vkDevice, uint32_t queueFamily,
+                       uint32_t slotCount, uint32_t maxScopes, bool enableStatistics) {
+    device = vkDevice;
+
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    // timestampComputeAndGraphics == VK_FALSE only means some families lack timestamps,
+    // the family we record on decides
+    uint32_t validBits = queueFamilies[queueFamily].timestampValidBits;
+    timestamps = validBits > 0;
+    statistics = enableStatistics;
+    if (!timestamps && !statistics) return;
+
+    timestampPeriod = properties.limits.timestampPeriod;
+    timestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+    maxQueries = maxScopes * 2;
+
+    slots.resize(slotCount);
+    for (auto& slot : slots) {
+        VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+        queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+
+        if (timestamps) {
+            queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            queryPoolCreateInfo.queryCount = maxQueries;
+            if (vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &slot.timestampPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create timestamp query pool");
+            }
+        }
+
+        if (statistics) {
+            queryPoolCreateInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            queryPoolCreateInfo.queryCount = 1;
+            queryPoolCreateInfo.pipelineStatistics = PIPELINE_STATISTICS;
+            if (vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &slot.statisticsPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create pipeline statistics query pool");
+            }
+        }
+    }
+}
+
+VkQueryPipelineStatisticFlags GpuProfiler::statistics_flags() const {
+    return statistics ? PIPELINE_STATISTICS : 0;
+}
+
+void GpuProfiler::destroy() {
+    for (auto& slot : slots) {
+        if (slot.timestampPool != VK_NULL_HANDLE) vkDestroyQueryPool(device, slot.timestampPool, nullptr);
+        if (slot.statisticsPool != VK_NULL_HANDLE) vkDestroyQueryPool(device, slot.statisticsPool, nullptr);
+    }
+    slots.clear();
+}
+
+void GpuProfiler::begin_frame(VkCommandBuffer commandBuffer, uint32_t slotIndex, int64_t tag) {
+    if (slots.empty()) return;
+
+    Slot& slot = slots[slotIndex];
+    slot.scopes.clear();
+    slot.queryCount = 0;
+    slot.statisticsWritten = false;
+    slot.pending = true;
+    slot.tag = tag;
+    recording = &slot;
+    scopeStack.clear();
+
+    if (timestamps) vkCmdResetQueryPool(commandBuffer, slot.timestampPool, 0, maxQueries);
+    if (statistics) vkCmdResetQueryPool(commandBuffer, slot.statisticsPool, 0, 1);
+}
+
+void GpuProfiler::end_frame(VkCommandBuffer commandBuffer) {
+    while (!scopeStack.empty()) {
+        end_scope(commandBuffer);
+    }
+    recording = nullptr;
+}
+
+void GpuProfiler::begin_scope(VkCommandBuffer commandBuffer, const char* name) {
+    if (!timestamps || recording == nullptr) return;
+    // out of queries: the scope is silently dropped, its children still nest correctly
+    if (recording->queryCount + 2 > maxQueries) {
+        scopeStack.push_back(UINT32_MAX);
+        return;
+    }
+
+    Scope scope = {name, (uint32_t) scopeStack.size(), recording->queryCount, recording->queryCount + 1};
+    recording->queryCount += 2;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, recording->timestampPool, scope.beginQuery);
+
+    scopeStack.push_back(recording->scopes.size());
+    recording->scopes.push_back(scope);
+}
+
+void GpuProfiler::end_scope(VkCommandBuffer commandBuffer) {
+    if (!timestamps || recording == nullptr || scopeStack.empty()) return;
+
+    uint32_t index = scopeStack.back();
+    scopeStack.pop_back();
+    if (index == UINT32_MAX) return;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, recording->timestampPool,
+                        recording->scopes[index].endQuery);
+}
+
+void GpuProfiler::begin_statistics(VkCommandBuffer commandBuffer) {
+    if (!statistics || recording == nullptr || recording->statisticsWritten) return;
+    vkCmdBeginQuery(commandBuffer, recording->statisticsPool, 0, 0);
+}
+
+void GpuProfiler::end_statistics(VkCommandBuffer commandBuffer) {
+    if (!statistics || recording == nullptr || recording->statisticsWritten) return;
+    vkCmdEndQuery(commandBuffer, recording->statisticsPool, 0);
+    recording->statisticsWritten = true;
+}
+
+bool GpuProfiler::collect(uint32_t slotIndex) {
+    if (slots.empty()) return false;
+
+    Slot& slot = slots[slotIndex];
+    if (!slot.pending) return false;
+
+    std::vector<uint64_t> timestampData(slot.queryCount);
+    if (slot.queryCount > 0) {
+        VkResult result = vkGetQueryPoolResults(device, slot.timestampPool, 0, slot.queryCount,
+                                                timestampData.size() * sizeof(uint64_t), timestampData.data(),
+                                                sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        // not there yet, try again next time the slot comes around
+        if (result == VK_NOT_READY) return false;
+        if (result != VK_SUCCESS) {
+            slot.pending = false;
+            return false;
+        }
+    }
+
+    GpuPipelineStatistics pipelineStatistics;
+    if (slot.statisticsWritten) {
+        uint64_t statisticsData[PIPELINE_STATISTICS_COUNT];
+        VkResult result = vkGetQueryPoolResults(device, slot.statisticsPool, 0, 1,
+                                                sizeof(statisticsData), statisticsData,
+                                                sizeof(statisticsData), VK_QUERY_RESULT_64_BIT);
+        if (result == VK_NOT_READY) return false;
+        if (result == VK_SUCCESS) {
+            // results are written in bit order of the requested statistics
+            pipelineStatistics.valid = true;
+            pipelineStatistics.inputAssemblyVertices = statisticsData[0];
+            pipelineStatistics.inputAssemblyPrimitives = statisticsData[1];
+            pipelineStatistics.vertexShaderInvocations = statisticsData[2];
+            pipelineStatistics.clippingInvocations = statisticsData[3];
+            pipelineStatistics.clippingPrimitives = statisticsData[4];
+            pipelineStatistics.fragmentShaderInvocations = statisticsData[5];
+        }
+    }
+
+    slot.pending = false;
+    lastResults.clear();
+    for (const auto& scope : slot.scopes) {
+        uint64_t ticks = (timestampData[scope.endQuery] - timestampData[scope.beginQuery]) & timestampMask;
+        double ms = ticks * timestampPeriod / 1e6;
+        lastResults.push_back({scope.name, scope.depth, ms});
+        accumulate(scope.name, ms);
+    }
+    lastStatistics = pipelineStatistics;
+    lastTag = slot.tag;
+    return true;
+}
+
+void GpuProfiler::add_sample(const std::string& name, double ms) {
+    accumulate(name, ms);
+}
+
+void GpuProfiler::accumulate(const std::string& name, double ms) {
+    Totals& scopeTotals = totals[name];
+    scopeTotals.count++;
+    scopeTotals.sum += ms;
+    if (ms > scopeTotals.max) scopeTotals.max = ms;
+}
+
+double GpuProfiler::last_scope_ms(const std::string& name) const {
+    for (const auto& result : lastResults) {
+        if (result.name == name) return result.ms;
+    }
+    return -1.0;
+}
+
+void GpuProfiler::print_summary(std::ostream& out) const {
+    if (!timestamps) {
+        out << "gpu profiler: timestamps not supported on this queue\n";
+        return;
+    }
+
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << "gpu scopes (ms):\n" << std::fixed << std::setprecision(3);
+    for (const auto& [name, scopeTotals] : totals) {
+        out << "\t" << std::left << std::setw(16) << name << std::right
+            << " mean " << std::setw(9) << scopeTotals.sum / scopeTotals.count
+            << " max " << std::setw(9) << scopeTotals.max
+            << " (" << scopeTotals.count << " samples)\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+
+    if (lastStatistics.valid) {
+        out << "pipeline statistics (last frame): "
+            << lastStatistics.inputAssemblyVertices << " vertices, "
+            << lastStatistics.inputAssemblyPrimitives << " primitives, "
+            << lastStatistics.vertexShaderInvocations << " vs invocations, "
+            << lastStatistics.clippingPrimitives << " clipped primitives out, "
+            << lastStatistics.fragmentShaderInvocations << " fs invocations\n";
+    }
+}
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "../headers/GpuTimeline.h"
+
+void GpuTimeline::init(VkDevice vkDevice, bool timelineSemaphores) {
+    device = vkDevice;
+    if (!timelineSemaphores) return;
+
+    VkSemaphoreTypeCreateInfo typeCreateInfo = {};
+    typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeCreateInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    createInfo.pNext = &typeCreateInfo;
+    if (vkCreateSemaphore(device, &createInfo, nullptr, &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timeline semaphore");
+    }
+}
+
+void GpuTimeline::destroy() {
+    if (semaphore != VK_NULL_HANDLE) {
+        vkDestroySemaphore(device, semaphore, nullptr);
+        semaphore = VK_NULL_HANDLE;
+    }
+    for (auto& [value, fence] : pendingFences) {
+        vkDestroyFence(device, fence, nullptr);
+    }
+    pendingFences.clear();
+    for (auto fence : freeFences) {
+        vkDestroyFence(device, fence, nullptr);
+    }
+    freeFences.clear();
+}
+
+VkFence GpuTimeline::acquire_fence() {
+    if (!freeFences.empty()) {
+        VkFence fence = freeFences.back();
+        freeFences.pop_back();
+        return fence;
+    }
+
+    VkFenceCreateInfo fenceCreateInfo = {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    if (vkCreateFence(device, &fenceCreateInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timeline fence");
+    }
+    return fence;
+}
+
+void GpuTimeline::retire_fence() {
+    auto [value, fence] = pendingFences.front();
+    pendingFences.pop_front();
+    vkResetFences(device, 1, &fence);
+    freeFences.push_back(fence);
+    completedValue = value;
+}
+
+uint64_t GpuTimeline::submit(VkQueue queue, const VkSubmitInfo& submitInfo) {
+    uint64_t value = lastSubmitted + 1;
+
+    if (semaphore == VK_NULL_HANDLE) {
+        VkFence fence = acquire_fence();
+        if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+            freeFences.push_back(fence);
+            throw std::runtime_error("failed to submit to the queue");
+        }
+        pendingFences.emplace_back(value, fence);
+        lastSubmitted = value;
+        return value;
+    }
+
+    // the timeline goes last, binary semaphores ignore their values
+    std::vector<VkSemaphore> signalSemaphores(submitInfo.pSignalSemaphores,
+                                              submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+    signalSemaphores.push_back(semaphore);
+    std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+    signalValues.back() = value;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.pNext = submitInfo.pNext;
+    timelineInfo.signalSemaphoreValueCount = signalValues.size();
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+    VkSubmitInfo timelineSubmit = submitInfo;
+    timelineSubmit.pNext = &timelineInfo;
+    timelineSubmit.signalSemaphoreCount = signalSemaphores.size();
+    timelineSubmit.pSignalSemaphores = signalSemaphores.data();
+    if (vkQueueSubmit(queue, 1, &timelineSubmit, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit to the queue");
+    }
+    lastSubmitted = value;
+    return value;
+}
+
+uint64_t GpuTimeline::completed() {
+    if (semaphore != VK_NULL_HANDLE) {
+        uint64_t value = 0;
+        if (vkGetSemaphoreCounterValue(device, semaphore, &value) == VK_SUCCESS) {
+            completedValue = std::max(completedValue, value);
+        }
+    } else {
+        while (!pendingFences.empty() && vkGetFenceStatus(device, pendingFences.front().second) == VK_SUCCESS) {
+            retire_fence();
+        }
+    }
+    return completedValue;
+}
+
+void GpuTimeline::wait(uint64_t value) {
+    if (value <= completedValue) return;
+    if (value > lastSubmitted) {
+        throw std::runtime_error("waiting for a timeline value that was never submitted");
+    }
+
+    if (semaphore != VK_NULL_HANDLE) {
+        VkSemaphoreWaitInfo waitInfo = {};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &semaphore;
+        waitInfo.pValues = &value;
+        if (vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+            throw std::runtime_error("failed to wait for the timeline semaphore");
+        }
+        completedValue = value;
+        return;
+    }
+
+    while (completedValue < value) {
+        if (vkWaitForFences(device, 1, &pendingFences.front().second, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+            throw std::runtime_error("failed to wait for a timeline fence");
+        }
+        retire_fence();
+    }
+}
@@ -0,0 +1,87 @@
+#include "../headers/JobSystem.h"
+
+JobSystem::JobSystem(uint32_t workerCount) {
+    for (uint32_t i = 1; i < workerCount; ++i) {
+        threads.emplace_back(&JobSystem::worker_main, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void JobSystem::run_jobs(const Job* batch, uint32_t count, uint32_t workerIndex) {
+    uint32_t index;
+    while ((index = nextJob.fetch_add(1)) < count) {
+        try {
+            (*batch)(index, workerIndex);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) error = std::current_exception();
+        }
+        if (doneJobs.fetch_add(1) + 1 == count) {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.notify_all();
+        }
+    }
+}
+
+void JobSystem::worker_main(uint32_t workerIndex) {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        const Job* batch;
+        uint32_t count;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+            batch = job;
+            count = jobCount;
+            activeWorkers++;
+        }
+        run_jobs(batch, count, workerIndex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeWorkers--;
+        }
+        finished.notify_all();
+    }
+}
+
+void JobSystem::run(uint32_t count, const Job& batch) {
+    if (count == 0) return;
+    if (threads.empty()) {
+        for (uint32_t i = 0; i < count; ++i) batch(i, 0);
+        return;
+    }
+
+    {
+        // a worker that woke up late for the previous batch may still hold its counters
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return activeWorkers == 0; });
+        job = &batch;
+        jobCount = count;
+        nextJob = 0;
+        doneJobs = 0;
+        generation++;
+    }
+    wake.notify_all();
+
+    run_jobs(&batch, count, 0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return doneJobs.load() == count; });
+    if (error) {
+        std::exception_ptr thrown = error;
+        error = nullptr;
+        std::rethrow_exception(thrown);
+    }
+}
@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+#include "../headers/MemoryAllocator.h"
+
+static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// resourceA ends at endA, resourceB starts at startB (endA <= startB)
+static bool on_same_page(VkDeviceSize endA, VkDeviceSize startB, VkDeviceSize pageSize) {
+    VkDeviceSize pageA = (endA - 1) & ~(pageSize - 1);
+    VkDeviceSize pageB = startB & ~(pageSize - 1);
+    return pageA == pageB;
+}
+
+double MemoryTypeStats::fragmentation() const {
+    VkDeviceSize freeBytes = reservedBytes - usedBytes;
+    if (freeBytes == 0) return 0.0;
+    return 1.0 - (double) largestFreeRange / (double) freeBytes;
+}
+
+void MemoryAllocator::init(VkPhysicalDevice vkPhysicalDevice, VkDevice vkDevice) {
+    physicalDevice = vkPhysicalDevice;
+    device = vkDevice;
+
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    bufferImageGranularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+    maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+}
+
+void MemoryAllocator::destroy() {
+    for (auto& block : blocks) {
+        if (block->mapped) vkUnmapMemory(device, block->memory);
+        vkFreeMemory(device, block->memory, nullptr);
+    }
+    blocks.clear();
+    deviceAllocationCount = 0;
+}
+
+uint32_t MemoryAllocator::find_memory_type(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if (typeFilter & (1 << i)
+           && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to create suitable memory type");
+}
+
+VkDeviceSize MemoryAllocator::preferred_block_size(uint32_t memoryType) const {
+    const VkDeviceSize largeHeapBlockSize = 256ull * 1024 * 1024;
+    const VkDeviceSize smallHeapLimit = 1024ull * 1024 * 1024;
+
+    VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    return heapSize <= smallHeapLimit ? heapSize / 8 : largeHeapBlockSize;
+}
+
+MemoryBlock* MemoryAllocator::create_block(uint32_t memoryType, VkDeviceSize size) {
+    if (maxAllocationCount != 0 && deviceAllocationCount >= maxAllocationCount) {
+        throw std::runtime_error("maxMemoryAllocationCount reached");
+    }
+
+    VkMemoryAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize = size;
+    allocateInfo.memoryTypeIndex = memoryType;
+
+    auto block = std::make_unique<MemoryBlock>();
+    if (vkAllocateMemory(device, &allocateInfo, nullptr, &block->memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate device memory block!");
+    }
+    deviceAllocationCount++;
+
+    block->size = size;
+    block->memoryType = memoryType;
+    block->suballocations.push_back({0, size, true, ResourceKind::Linear});
+
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS) {
+            throw std::runtime_error("failed to map device memory block!");
+        }
+    }
+
+    blocks.push_back(std::move(block));
+    return blocks.back().get();
+}
+
+void MemoryAllocator::destroy_block(MemoryBlock* block) {
+    auto it = std::find_if(blocks.begin(), blocks.end(),
+                           [block](const std::unique_ptr<MemoryBlock>& b) { return b.get() == block; });
+    if (it == blocks.end()) return;
+
+    if (block->mapped) vkUnmapMemory(device, block->memory);
+    vkFreeMemory(device, block->memory, nullptr);
+    deviceAllocationCount--;
+    blocks.erase(it);
+}
+
+bool MemoryAllocator::allocate_from_block(MemoryBlock* block, const VkMemoryRequirements& requirements,
+                                          ResourceKind kind, Allocation& allocation) {
+    auto best = block->suballocations.end();
+    VkDeviceSize bestStart = 0;
+
+    for (auto it = block->suballocations.begin(); it != block->suballocations.end(); ++it) {
+        if (!it->free || it->size < requirements.size) continue;
+        if (best != block->suballocations.end() && it->size >= best->size) continue;
+
+        VkDeviceSize start = align_up(it->offset, requirements.alignment);
+
+        if (it != block->suballocations.begin()) {
+            auto prev = std::prev(it);
+            if (!prev->free && prev->kind != kind && on_same_page(prev->offset + prev->size, start, bufferImageGranularity)) {
+                start = align_up(start, bufferImageGranularity);
+            }
+        }
+
+        VkDeviceSize end = start + requirements.size;
+        if (end > it->offset + it->size) continue;
+
+        auto next = std::next(it);
+        if (next != block->suballocations.end() && !next->free && next->kind != kind
+            && on_same_page(end, next->offset, bufferImageGranularity)) {
+            continue;
+        }
+
+        best = it;
+        bestStart = start;
+    }
+
+    if (best == block->suballocations.end()) return false;
+
+    VkDeviceSize rangeEnd = best->offset + best->size;
+    VkDeviceSize end = bestStart + requirements.size;
+
+    // alignment padding in front stays a free range of its own
+    if (bestStart > best->offset) {
+        block->suballocations.insert(best, {best->offset, bestStart - best->offset, true, ResourceKind::Linear});
+    }
+    if (end < rangeEnd) {
+        block->suballocations.insert(std::next(best), {end, rangeEnd - end, true, ResourceKind::Linear});
+    }
+    best->offset = bestStart;
+    best->size = requirements.size;
+    best->free = false;
+    best->kind = kind;
+
+    block->allocationCount++;
+    block->usedBytes += requirements.size;
+
+    allocation.memory = block->memory;
+    allocation.offset = bestStart;
+    allocation.size = requirements.size;
+    allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + bestStart : nullptr;
+    allocation.memoryType = block->memoryType;
+    allocation.block = block;
+    return true;
+}
+
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+                                     ResourceKind kind) {
+    Allocation allocation;
+    uint32_t memoryType = find_memory_type(requirements.memoryTypeBits, properties);
+
+    for (auto& block : blocks) {
+        if (block->dedicated || block->memoryType != memoryType) continue;
+        if (allocate_from_block(block.get(), requirements, kind, allocation)) {
+            return allocation;
+        }
+    }
+
+    VkDeviceSize blockSize = preferred_block_size(memoryType);
+    MemoryBlock* block;
+    if (requirements.size > blockSize / 2) {
+        // large resources get their own allocation instead of wasting most of a shared block
+        block = create_block(memoryType, requirements.size);
+        block->dedicated = true;
+    } else {
+        block = create_block(memoryType, blockSize);
+    }
+
+    if (!allocate_from_block(block, requirements, kind, allocation)) {
+        throw std::runtime_error("failed to sub-allocate device memory");
+    }
+    return allocation;
+}
+
+void MemoryAllocator::free(Allocation& allocation) {
+    MemoryBlock* block = allocation.block;
+    if (block == nullptr) {
+        allocation = {};
+        return;
+    }
+
+    auto it = std::find_if(block->suballocations.begin(), block->suballocations.end(),
+                           [&allocation](const Suballocation& s) { return !s.free && s.offset == allocation.offset; });
+    if (it == block->suballocations.end()) {
+        throw std::runtime_error("freeing an allocation that does not belong to its block");
+    }
+
+    it->free = true;
+    it->kind = ResourceKind::Linear;
+    block->allocationCount--;
+    block->usedBytes -= it->size;
+
+    if (it != block->suballocations.begin() && std::prev(it)->free) {
+        auto prev = std::prev(it);
+        prev->size += it->size;
+        block->suballocations.erase(it);
+        it = prev;
+    }
+    auto next = std::next(it);
+    if (next != block->suballocations.end() && next->free) {
+        it->size += next->size;
+        block->suballocations.erase(next);
+    }
+
+    allocation = {};
+
+    if (block->allocationCount == 0) {
+        // keep one empty block per memory type around so alternating alloc/free does not hit the driver
+        bool otherEmptyBlock = std::any_of(blocks.begin(), blocks.end(), [block](const std::unique_ptr<MemoryBlock>& b) {
+            return b.get() != block && !b->dedicated
+                   && b->memoryType == block->memoryType && b->allocationCount == 0;
+        });
+        if (block->dedicated || otherEmptyBlock) {
+            destroy_block(block);
+        }
+    }
+}
+
+AllocatorStats MemoryAllocator::get_stats() const {
+    AllocatorStats stats;
+    stats.memoryTypes.resize(memoryProperties.memoryTypeCount);
+    stats.deviceAllocationCount = deviceAllocationCount;
+    stats.maxDeviceAllocationCount = maxAllocationCount;
+
+    for (auto& block : blocks) {
+        MemoryTypeStats& typeStats = stats.memoryTypes[block->memoryType];
+        typeStats.blockCount++;
+        typeStats.allocationCount += block->allocationCount;
+        typeStats.reservedBytes += block->size;
+        typeStats.usedBytes += block->usedBytes;
+
+        for (auto& suballocation : block->suballocations) {
+            if (!suballocation.free) continue;
+            typeStats.freeRangeCount++;
+            typeStats.largestFreeRange = std::max(typeStats.largestFreeRange, suballocation.size);
+        }
+    }
+
+    return stats;
+}
+
+void MemoryAllocator::print_stats(std::ostream& out) const {
+    AllocatorStats stats = get_stats();
+    const double mib = 1024.0 * 1024.0;
+    // out is usually std::cout, leave its formatting as it was
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out << "Device Memory: " << stats.deviceAllocationCount << " / " << stats.maxDeviceAllocationCount
+        << " vkAllocateMemory allocations\n";
+    for (size_t i = 0; i < stats.memoryTypes.size(); ++i) {
+        const MemoryTypeStats& typeStats = stats.memoryTypes[i];
+        if (typeStats.blockCount == 0) continue;
+
+        out << "\ttype " << i << " (flags " << memoryProperties.memoryTypes[i].propertyFlags << "): "
+            << typeStats.blockCount << " blocks, "
+            << typeStats.allocationCount << " allocations, "
+            << std::fixed << std::setprecision(2)
+            << typeStats.usedBytes / mib << " / " << typeStats.reservedBytes / mib << " MiB used, "
+            << typeStats.freeRangeCount << " free ranges, "
+            << "fragmentation " << typeStats.fragmentation() * 100.0 << "%\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
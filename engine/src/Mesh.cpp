@@ -0,0 +1,947 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "../headers/Mesh.h"
+
+// both formats are Y-up, the engine's world is Z-up
+static glm::vec3 to_z_up(float x, float y, float z) {
+    return {x, -z, y};
+}
+
+static std::string extension_of(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || path.find_first_of("/\\", dot) != std::string::npos) return "";
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+static std::vector<uint8_t> read_whole_file(const std::string& path) {
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open " + path);
+    }
+    std::vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+    return data;
+}
+
+// OBJ
+
+// "v", "v/t", "v//n" or "v/t/n", 1-based or negative (relative to the end)
+static bool parse_obj_corner(const char*& cursor, size_t positionCount, size_t texCoordCount, size_t normalCount,
+                             int64_t& position, int64_t& texCoord, int64_t& normal) {
+    char* end;
+    long value = std::strtol(cursor, &end, 10);
+    if (end == cursor) return false;
+    position = value < 0 ? static_cast<int64_t>(positionCount) + value : value - 1;
+    texCoord = -1;
+    normal = -1;
+    cursor = end;
+    if (*cursor == '/') {
+        cursor++;
+        if (*cursor != '/') {
+            value = std::strtol(cursor, &end, 10);
+            if (end != cursor) {
+                texCoord = value < 0 ? static_cast<int64_t>(texCoordCount) + value : value - 1;
+                cursor = end;
+            }
+        }
+        if (*cursor == '/') {
+            cursor++;
+            value = std::strtol(cursor, &end, 10);
+            if (end != cursor) {
+                normal = value < 0 ? static_cast<int64_t>(normalCount) + value : value - 1;
+                cursor = end;
+            }
+        }
+    }
+    return true;
+}
+
+Mesh parse_obj(const char* text, size_t size, const std::string& name) {
+    // strtof needs terminated lines, the source may be a view into a mapped archive
+    std::string source(text, size);
+    std::replace(source.begin(), source.end(), '\n', '\0');
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> colors;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> normals;
+    Mesh mesh;
+    std::vector<uint32_t> face;
+
+    size_t lineNumber = 0;
+    size_t lineStart = 0;
+    while (lineStart < source.size()) {
+        size_t lineEnd = source.find('\0', lineStart);
+        if (lineEnd == std::string::npos) lineEnd = source.size();
+        const char* cursor = source.c_str() + lineStart;
+        lineStart = lineEnd + 1;
+        lineNumber++;
+
+        while (*cursor == ' ' || *cursor == '\t') cursor++;
+        char* end;
+        if (cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t')) {
+            float values[6] = {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+            cursor += 2;
+            int count = 0;
+            for (; count < 6; ++count) {
+                values[count] = std::strtof(cursor, &end);
+                if (end == cursor) break;
+                cursor = end;
+            }
+            if (count < 3) {
+                throw std::runtime_error(name + ":" + std::to_string(lineNumber) + ": vertex needs three coordinates");
+            }
+            // "v x y z r g b" is the common vertex color extension
+            positions.push_back(to_z_up(values[0], values[1], values[2]));
+            colors.push_back(count == 6 ? glm::vec3(values[3], values[4], values[5]) : glm::vec3(1.0f));
+        } else if (cursor[0] == 'v' && cursor[1] == 'n') {
+            cursor += 2;
+            float n[3];
+            for (float& value : n) {
+                value = std::strtof(cursor, &end);
+                cursor = end;
+            }
+            normals.push_back(to_z_up(n[0], n[1], n[2]));
+        } else if (cursor[0] == 'v' && cursor[1] == 't') {
+            cursor += 2;
+            float u = std::strtof(cursor, &end);
+            cursor = end;
+            float v = std::strtof(cursor, &end);
+            // OBJ puts the origin at the bottom left, Vulkan samples from the top left
+            texCoords.emplace_back(u, 1.0f - v);
+        } else if (cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t')) {
+            cursor += 2;
+            face.clear();
+            while (true) {
+                while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r') cursor++;
+                int64_t position, texCoord, normal;
+                if (!parse_obj_corner(cursor, positions.size(), texCoords.size(), normals.size(),
+                                      position, texCoord, normal)) break;
+                if (position < 0 || position >= static_cast<int64_t>(positions.size())
+                    || texCoord >= static_cast<int64_t>(texCoords.size())
+                    || normal >= static_cast<int64_t>(normals.size())) {
+                    throw std::runtime_error(name + ":" + std::to_string(lineNumber) + ": face index out of range");
+                }
+                Vertex vertex = {};
+                vertex.pos = positions[position];
+                vertex.color = colors[position];
+                vertex.texCoord = texCoord < 0 ? glm::vec2(0.0f) : texCoords[texCoord];
+                vertex.normal = normal < 0 ? glm::vec3(0.0f) : normals[normal];
+                face.push_back(static_cast<uint32_t>(mesh.vertices.size()));
+                mesh.vertices.push_back(vertex);
+            }
+            // polygons are triangulated as fans
+            for (size_t i = 2; i < face.size(); ++i) {
+                mesh.indices.insert(mesh.indices.end(), {face[0], face[i - 1], face[i]});
+            }
+        }
+    }
+
+    if (mesh.indices.empty()) {
+        throw std::runtime_error(name + " has no faces");
+    }
+    return mesh;
+}
+
+// glTF
+
+namespace {
+
+// just enough JSON for glTF: numbers are doubles, objects keep their keys in order
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    const JsonValue* find(const char* key) const {
+        for (const auto& member : object) {
+            if (member.first == key) return &member.second;
+        }
+        return nullptr;
+    }
+    double number_or(const char* key, double fallback) const {
+        const JsonValue* value = find(key);
+        return value != nullptr && value->type == Type::Number ? value->number : fallback;
+    }
+    size_t size() const { return array.size(); }
+    const JsonValue& operator[](size_t i) const { return array[i]; }
+};
+
+class JsonParser {
+    const char* cursor;
+    const char* end;
+    const std::string& name;
+
+    [[noreturn]] void fail(const char* what) const {
+        throw std::runtime_error(name + ": invalid JSON, " + what);
+    }
+    void skip_whitespace() {
+        while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) cursor++;
+    }
+    bool consume(char c) {
+        skip_whitespace();
+        if (cursor < end && *cursor == c) {
+            cursor++;
+            return true;
+        }
+        return false;
+    }
+    void expect(char c) {
+        if (!consume(c)) fail("unexpected character");
+    }
+
+    std::string parse_string() {
+        expect('"');
+        std::string result;
+        while (cursor < end && *cursor != '"') {
+            char c = *cursor++;
+            if (c != '\\') {
+                result += c;
+                continue;
+            }
+            if (cursor >= end) fail("unterminated escape");
+            c = *cursor++;
+            switch (c) {
+                case 'b': result += '\b'; break;
+                case 'f': result += '\f'; break;
+                case 'n': result += '\n'; break;
+                case 'r': result += '\r'; break;
+                case 't': result += '\t'; break;
+                case 'u': {
+                    if (end - cursor < 4) fail("short unicode escape");
+                    uint32_t code = std::stoul(std::string(cursor, 4), nullptr, 16);
+                    cursor += 4;
+                    // uris and names only, surrogate pairs are not combined
+                    if (code < 0x80) {
+                        result += static_cast<char>(code);
+                    } else if (code < 0x800) {
+                        result += static_cast<char>(0xc0 | (code >> 6));
+                        result += static_cast<char>(0x80 | (code & 0x3f));
+                    } else {
+                        result += static_cast<char>(0xe0 | (code >> 12));
+                        result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                        result += static_cast<char>(0x80 | (code & 0x3f));
+                    }
+                    break;
+                }
+                default: result += c; break;
+            }
+        }
+        if (cursor >= end) fail("unterminated string");
+        cursor++;
+        return result;
+    }
+
+public:
+    JsonParser(const char* data, size_t size, const std::string& name) : cursor(data), end(data + size), name(name) {}
+
+    JsonValue parse_value() {
+        skip_whitespace();
+        if (cursor >= end) fail("unexpected end");
+
+        JsonValue value;
+        if (*cursor == '{') {
+            cursor++;
+            value.type = JsonValue::Type::Object;
+            if (consume('}')) return value;
+            do {
+                skip_whitespace();
+                std::string key = parse_string();
+                expect(':');
+                value.object.emplace_back(std::move(key), parse_value());
+            } while (consume(','));
+            expect('}');
+        } else if (*cursor == '[') {
+            cursor++;
+            value.type = JsonValue::Type::Array;
+            if (consume(']')) return value;
+            do {
+                value.array.push_back(parse_value());
+            } while (consume(','));
+            expect(']');
+        } else if (*cursor == '"') {
+            value.type = JsonValue::Type::String;
+            value.string = parse_string();
+        } else if (end - cursor >= 4 && std::strncmp(cursor, "true", 4) == 0) {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+            cursor += 4;
+        } else if (end - cursor >= 5 && std::strncmp(cursor, "false", 5) == 0) {
+            value.type = JsonValue::Type::Bool;
+            cursor += 5;
+        } else if (end - cursor >= 4 && std::strncmp(cursor, "null", 4) == 0) {
+            cursor += 4;
+        } else {
+            // strtod could read past the end of an unterminated buffer
+            const char* start = cursor;
+            while (cursor < end && std::strchr("+-0123456789.eE", *cursor) != nullptr) cursor++;
+            if (cursor == start) fail("unexpected character");
+            value.type = JsonValue::Type::Number;
+            value.number = std::strtod(std::string(start, cursor).c_str(), nullptr);
+        }
+        return value;
+    }
+
+    JsonValue parse_document() {
+        JsonValue root = parse_value();
+        skip_whitespace();
+        if (cursor != end) fail("trailing characters");
+        return root;
+    }
+};
+
+std::vector<uint8_t> decode_base64(const std::string& text, size_t start) {
+    std::vector<uint8_t> result;
+    result.reserve((text.size() - start) * 3 / 4);
+    uint32_t accumulator = 0;
+    int bits = 0;
+    for (size_t i = start; i < text.size(); ++i) {
+        char c = text[i];
+        int value;
+        if (c >= 'A' && c <= 'Z') value = c - 'A';
+        else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') value = c - '0' + 52;
+        else if (c == '+') value = 62;
+        else if (c == '/') value = 63;
+        else break;
+        accumulator = (accumulator << 6) | value;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            result.push_back(static_cast<uint8_t>(accumulator >> bits));
+        }
+    }
+    return result;
+}
+
+const uint32_t GLB_MAGIC = 0x46546c67;      // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4e4f534a; // "JSON"
+const uint32_t GLB_CHUNK_BIN = 0x004e4942;  // "BIN\0"
+
+const uint32_t GLTF_BYTE = 5120;
+const uint32_t GLTF_UNSIGNED_BYTE = 5121;
+const uint32_t GLTF_SHORT = 5122;
+const uint32_t GLTF_UNSIGNED_SHORT = 5123;
+const uint32_t GLTF_UNSIGNED_INT = 5125;
+const uint32_t GLTF_FLOAT = 5126;
+const uint32_t GLTF_TRIANGLES = 4;
+
+class GltfReader {
+    const std::string& name;
+    JsonValue root;
+    std::vector<std::vector<uint8_t>> buffers;
+
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error(name + ": " + what);
+    }
+
+    const JsonValue& element(const char* array, double index) const {
+        const JsonValue* values = root.find(array);
+        if (values == nullptr || index < 0 || index >= values->size()) {
+            fail(std::string("missing ") + array + " " + std::to_string(static_cast<int64_t>(index)));
+        }
+        return (*values)[static_cast<size_t>(index)];
+    }
+
+    static uint32_t component_size(uint32_t componentType) {
+        switch (componentType) {
+            case GLTF_BYTE: case GLTF_UNSIGNED_BYTE: return 1;
+            case GLTF_SHORT: case GLTF_UNSIGNED_SHORT: return 2;
+            case GLTF_UNSIGNED_INT: case GLTF_FLOAT: return 4;
+            default: return 0;
+        }
+    }
+
+    static uint32_t component_count(const std::string& type) {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        if (type == "MAT4") return 16;
+        return 0;
+    }
+
+    static double read_component(const uint8_t* data, uint32_t componentType, bool normalized) {
+        switch (componentType) {
+            case GLTF_BYTE: {
+                int8_t v; std::memcpy(&v, data, 1);
+                return normalized ? std::max(v / 127.0, -1.0) : v;
+            }
+            case GLTF_UNSIGNED_BYTE:
+                return normalized ? data[0] / 255.0 : data[0];
+            case GLTF_SHORT: {
+                int16_t v; std::memcpy(&v, data, 2);
+                return normalized ? std::max(v / 32767.0, -1.0) : v;
+            }
+            case GLTF_UNSIGNED_SHORT: {
+                uint16_t v; std::memcpy(&v, data, 2);
+                return normalized ? v / 65535.0 : v;
+            }
+            case GLTF_UNSIGNED_INT: {
+                uint32_t v; std::memcpy(&v, data, 4);
+                return v;
+            }
+            default: {
+                float v; std::memcpy(&v, data, 4);
+                return v;
+            }
+        }
+    }
+
+public:
+    GltfReader(const uint8_t* data, size_t size, const std::string& name, const MeshResourceLoader& loadResource)
+            : name(name) {
+        const char* json = reinterpret_cast<const char*>(data);
+        size_t jsonSize = size;
+        std::vector<uint8_t> binaryChunk;
+        bool hasBinaryChunk = false;
+
+        uint32_t magic = 0;
+        if (size >= 4) std::memcpy(&magic, data, 4);
+        if (magic == GLB_MAGIC) {
+            // 12 byte header, then chunks of {length, type, data}, JSON first
+            uint32_t header[3];
+            if (size < sizeof(header)) fail("truncated GLB header");
+            std::memcpy(header, data, sizeof(header));
+            if (header[1] != 2) fail("unsupported GLB version " + std::to_string(header[1]));
+            size_t offset = sizeof(header);
+            json = nullptr;
+            while (offset + 8 <= std::min<size_t>(size, header[2])) {
+                uint32_t chunk[2];
+                std::memcpy(chunk, data + offset, sizeof(chunk));
+                offset += sizeof(chunk);
+                if (offset + chunk[0] > size) fail("truncated GLB chunk");
+                if (chunk[1] == GLB_CHUNK_JSON && json == nullptr) {
+                    json = reinterpret_cast<const char*>(data + offset);
+                    jsonSize = chunk[0];
+                } else if (chunk[1] == GLB_CHUNK_BIN && !hasBinaryChunk) {
+                    binaryChunk.assign(data + offset, data + offset + chunk[0]);
+                    hasBinaryChunk = true;
+                }
+                offset += (chunk[0] + 3) & ~3u;
+            }
+            if (json == nullptr) fail("GLB without JSON chunk");
+        }
+
+        root = JsonParser(json, jsonSize, name).parse_document();
+        if (root.type != JsonValue::Type::Object) fail("root is not an object");
+
+        const JsonValue* bufferList = root.find("buffers");
+        for (size_t i = 0; bufferList != nullptr && i < bufferList->size(); ++i) {
+            const JsonValue* uri = (*bufferList)[i].find("uri");
+            if (uri == nullptr) {
+                // the GLB binary chunk
+                if (!hasBinaryChunk) fail("buffer " + std::to_string(i) + " has no uri");
+                buffers.push_back(binaryChunk);
+            } else if (uri->string.compare(0, 5, "data:") == 0) {
+                size_t comma = uri->string.find(";base64,");
+                if (comma == std::string::npos) fail("only base64 data uris are supported");
+                buffers.push_back(decode_base64(uri->string, comma + 8));
+            } else {
+                buffers.push_back(loadResource(uri->string));
+            }
+            if (buffers.back().size() < (*bufferList)[i].number_or("byteLength", 0.0)) {
+                fail("buffer " + std::to_string(i) + " is shorter than its byteLength");
+            }
+        }
+    }
+
+    // every element of the accessor with its components converted to double
+    std::vector<double> read_accessor(double index, uint32_t& components) const {
+        const JsonValue& accessor = element("accessors", index);
+        if (accessor.find("sparse") != nullptr) fail("sparse accessors are not supported");
+
+        uint32_t componentType = static_cast<uint32_t>(accessor.number_or("componentType", 0.0));
+        const JsonValue* type = accessor.find("type");
+        components = type != nullptr ? component_count(type->string) : 0;
+        uint32_t componentSize = component_size(componentType);
+        if (components == 0 || componentSize == 0) fail("unsupported accessor type");
+        const JsonValue* normalizedValue = accessor.find("normalized");
+        bool normalized = normalizedValue != nullptr && normalizedValue->boolean;
+
+        size_t count = static_cast<size_t>(accessor.number_or("count", 0.0));
+        std::vector<double> values(count * components, 0.0);
+        const JsonValue* bufferViewIndex = accessor.find("bufferView");
+        if (bufferViewIndex == nullptr) return values;
+
+        const JsonValue& bufferView = element("bufferViews", bufferViewIndex->number);
+        size_t bufferIndex = static_cast<size_t>(bufferView.number_or("buffer", 0.0));
+        if (bufferIndex >= buffers.size()) fail("buffer view points at a missing buffer");
+        const std::vector<uint8_t>& buffer = buffers[bufferIndex];
+
+        size_t elementSize = size_t(componentSize) * components;
+        size_t stride = static_cast<size_t>(bufferView.number_or("byteStride", 0.0));
+        if (stride == 0) stride = elementSize;
+        size_t offset = static_cast<size_t>(bufferView.number_or("byteOffset", 0.0) + accessor.number_or("byteOffset", 0.0));
+        size_t viewEnd = static_cast<size_t>(bufferView.number_or("byteOffset", 0.0) + bufferView.number_or("byteLength", 0.0));
+        if (count > 0 && (offset + (count - 1) * stride + elementSize > viewEnd || viewEnd > buffer.size())) {
+            fail("accessor runs past its buffer view");
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            const uint8_t* source = buffer.data() + offset + i * stride;
+            for (uint32_t c = 0; c < components; ++c) {
+                values[i * components + c] = read_component(source + c * componentSize, componentType, normalized);
+            }
+        }
+        return values;
+    }
+
+    void append_primitive(const JsonValue& primitive, const glm::mat4& transform, Mesh& mesh) const {
+        if (primitive.number_or("mode", GLTF_TRIANGLES) != GLTF_TRIANGLES) {
+            fail("only triangle list primitives are supported");
+        }
+        const JsonValue* attributes = primitive.find("attributes");
+        const JsonValue* position = attributes != nullptr ? attributes->find("POSITION") : nullptr;
+        if (position == nullptr) fail("primitive without POSITION");
+
+        uint32_t positionComponents;
+        std::vector<double> positions = read_accessor(position->number, positionComponents);
+        if (positionComponents != 3) fail("POSITION must be VEC3");
+        size_t vertexCount = positions.size() / 3;
+
+        uint32_t texCoordComponents = 0;
+        std::vector<double> texCoords;
+        if (const JsonValue* texCoord = attributes->find("TEXCOORD_0")) {
+            texCoords = read_accessor(texCoord->number, texCoordComponents);
+            if (texCoordComponents != 2 || texCoords.size() / 2 != vertexCount) fail("invalid TEXCOORD_0");
+        }
+        uint32_t normalComponents = 0;
+        std::vector<double> normals;
+        if (const JsonValue* normal = attributes->find("NORMAL")) {
+            normals = read_accessor(normal->number, normalComponents);
+            if (normalComponents != 3 || normals.size() / 3 != vertexCount) fail("invalid NORMAL");
+        }
+        // normals go through the inverse transpose, only its upper 3x3 matters
+        glm::mat4 normalTransform = glm::transpose(glm::inverse(transform));
+        uint32_t colorComponents = 0;
+        std::vector<double> colors;
+        if (const JsonValue* color = attributes->find("COLOR_0")) {
+            colors = read_accessor(color->number, colorComponents);
+            if (colorComponents < 3 || colors.size() / colorComponents != vertexCount) fail("invalid COLOR_0");
+        }
+
+        uint32_t baseVertex = static_cast<uint32_t>(mesh.vertices.size());
+        for (size_t i = 0; i < vertexCount; ++i) {
+            glm::vec4 p = transform * glm::vec4(static_cast<float>(positions[i * 3]),
+                                                static_cast<float>(positions[i * 3 + 1]),
+                                                static_cast<float>(positions[i * 3 + 2]), 1.0f);
+            Vertex vertex = {};
+            vertex.pos = to_z_up(p.x, p.y, p.z);
+            vertex.color = colors.empty() ? glm::vec3(1.0f)
+                    : glm::vec3(static_cast<float>(colors[i * colorComponents]),
+                                static_cast<float>(colors[i * colorComponents + 1]),
+                                static_cast<float>(colors[i * colorComponents + 2]));
+            vertex.texCoord = texCoords.empty() ? glm::vec2(0.0f)
+                    : glm::vec2(static_cast<float>(texCoords[i * 2]), static_cast<float>(texCoords[i * 2 + 1]));
+            if (!normals.empty()) {
+                glm::vec4 n = normalTransform * glm::vec4(static_cast<float>(normals[i * 3]),
+                                                          static_cast<float>(normals[i * 3 + 1]),
+                                                          static_cast<float>(normals[i * 3 + 2]), 0.0f);
+                vertex.normal = glm::normalize(to_z_up(n.x, n.y, n.z));
+            }
+            mesh.vertices.push_back(vertex);
+        }
+
+        if (const JsonValue* indexAccessor = primitive.find("indices")) {
+            uint32_t indexComponents;
+            std::vector<double> indices = read_accessor(indexAccessor->number, indexComponents);
+            if (indexComponents != 1 || indices.size() % 3 != 0) fail("invalid indices");
+            for (double index : indices) {
+                if (index >= vertexCount) fail("index out of range");
+                mesh.indices.push_back(baseVertex + static_cast<uint32_t>(index));
+            }
+        } else {
+            for (uint32_t i = 0; i + 2 < vertexCount; i += 3) {
+                mesh.indices.insert(mesh.indices.end(), {baseVertex + i, baseVertex + i + 1, baseVertex + i + 2});
+            }
+        }
+    }
+
+    static glm::mat4 node_transform(const JsonValue& node) {
+        if (const JsonValue* matrix = node.find("matrix")) {
+            glm::mat4 result(1.0f);
+            for (size_t i = 0; i < 16 && i < matrix->size(); ++i) {
+                result[i / 4][i % 4] = static_cast<float>((*matrix)[i].number);
+            }
+            return result;
+        }
+        glm::mat4 result(1.0f);
+        if (const JsonValue* t = node.find("translation")) {
+            if (t->size() == 3) {
+                result = glm::translate(result, glm::vec3((*t)[0].number, (*t)[1].number, (*t)[2].number));
+            }
+        }
+        if (const JsonValue* r = node.find("rotation")) {
+            if (r->size() == 4) {
+                // glTF stores x, y, z, w
+                glm::quat rotation(static_cast<float>((*r)[3].number), static_cast<float>((*r)[0].number),
+                                   static_cast<float>((*r)[1].number), static_cast<float>((*r)[2].number));
+                result = result * glm::mat4_cast(rotation);
+            }
+        }
+        if (const JsonValue* s = node.find("scale")) {
+            if (s->size() == 3) {
+                result = glm::scale(result, glm::vec3((*s)[0].number, (*s)[1].number, (*s)[2].number));
+            }
+        }
+        return result;
+    }
+
+    void append_node(double index, const glm::mat4& parent, Mesh& mesh, uint32_t depth) const {
+        if (depth > 64) fail("node hierarchy too deep or cyclic");
+        const JsonValue& node = element("nodes", index);
+        glm::mat4 transform = parent * node_transform(node);
+        if (const JsonValue* meshIndex = node.find("mesh")) {
+            append_mesh(meshIndex->number, transform, mesh);
+        }
+        if (const JsonValue* children = node.find("children")) {
+            for (const auto& child : children->array) {
+                append_node(child.number, transform, mesh, depth + 1);
+            }
+        }
+    }
+
+    void append_mesh(double index, const glm::mat4& transform, Mesh& mesh) const {
+        const JsonValue* primitives = element("meshes", index).find("primitives");
+        for (size_t i = 0; primitives != nullptr && i < primitives->size(); ++i) {
+            append_primitive((*primitives)[i], transform, mesh);
+        }
+    }
+
+    Mesh read() const {
+        Mesh mesh;
+        const JsonValue* scenes = root.find("scenes");
+        if (scenes != nullptr && scenes->size() > 0) {
+            const JsonValue& scene = element("scenes", root.number_or("scene", 0.0));
+            if (const JsonValue* nodes = scene.find("nodes")) {
+                for (const auto& node : nodes->array) {
+                    append_node(node.number, glm::mat4(1.0f), mesh, 0);
+                }
+            }
+        } else if (const JsonValue* meshes = root.find("meshes")) {
+            // no scene, every mesh untransformed
+            for (size_t i = 0; i < meshes->size(); ++i) {
+                append_mesh(static_cast<double>(i), glm::mat4(1.0f), mesh);
+            }
+        }
+        if (mesh.indices.empty()) fail("no triangles");
+        return mesh;
+    }
+};
+
+}
+
+Mesh parse_gltf(const uint8_t* data, size_t size, const std::string& name, const MeshResourceLoader& loadResource) {
+    return GltfReader(data, size, name, loadResource).read();
+}
+
+bool is_mesh_file(const std::string& path) {
+    std::string extension = extension_of(path);
+    return extension == "obj" || extension == "gltf" || extension == "glb";
+}
+
+Mesh load_mesh(const std::string& path) {
+    std::string extension = extension_of(path);
+    if (!is_mesh_file(path)) {
+        throw std::runtime_error("unsupported mesh format: " + path);
+    }
+
+    std::vector<uint8_t> data = read_whole_file(path);
+    if (extension == "obj") {
+        return parse_obj(reinterpret_cast<const char*>(data.data()), data.size(), path);
+    }
+    std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+    return parse_gltf(data.data(), data.size(), path, [&](const std::string& uri) {
+        return read_whole_file(directory + uri);
+    });
+}
+
+// processing
+
+namespace {
+
+struct VertexHash {
+    size_t operator()(const Vertex& v) const {
+        const float values[] = {v.pos.x, v.pos.y, v.pos.z, v.color.x, v.color.y, v.color.z, v.texCoord.x, v.texCoord.y,
+                                v.normal.x, v.normal.y, v.normal.z};
+        // FNV-1a over the attribute values, the struct itself may contain padding
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (float value : values) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            hash = (hash ^ bits) * 0x100000001b3ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+struct VertexEqual {
+    bool operator()(const Vertex& a, const Vertex& b) const {
+        return a.pos.x == b.pos.x && a.pos.y == b.pos.y && a.pos.z == b.pos.z
+               && a.color.x == b.color.x && a.color.y == b.color.y && a.color.z == b.color.z
+               && a.texCoord.x == b.texCoord.x && a.texCoord.y == b.texCoord.y
+               && a.normal.x == b.normal.x && a.normal.y == b.normal.y && a.normal.z == b.normal.z;
+    }
+};
+
+}
+
+void generate_normals(Mesh& mesh) {
+    std::vector<glm::vec3> normals(mesh.vertices.size(), glm::vec3(0.0f));
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        const glm::vec3& a = mesh.vertices[mesh.indices[i]].pos;
+        const glm::vec3& b = mesh.vertices[mesh.indices[i + 1]].pos;
+        const glm::vec3& c = mesh.vertices[mesh.indices[i + 2]].pos;
+        // the cross product's length is twice the area, which is the weight
+        glm::vec3 faceNormal = glm::cross(b - a, c - a);
+        for (int corner = 0; corner < 3; ++corner) {
+            glm::vec3& n = normals[mesh.indices[i + corner]];
+            n = n + faceNormal;
+        }
+    }
+    for (size_t v = 0; v < mesh.vertices.size(); ++v) {
+        float length = glm::length(normals[v]);
+        mesh.vertices[v].normal = length > 0.0f ? normals[v] / length : glm::vec3(0.0f, 0.0f, 1.0f);
+    }
+}
+
+void deduplicate_vertices(Mesh& mesh) {
+    std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> unique;
+    unique.reserve(mesh.vertices.size());
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> remap(mesh.vertices.size());
+
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+        auto inserted = unique.emplace(mesh.vertices[i], static_cast<uint32_t>(vertices.size()));
+        if (inserted.second) {
+            vertices.push_back(mesh.vertices[i]);
+        }
+        remap[i] = inserted.first->second;
+    }
+    for (auto& index : mesh.indices) {
+        index = remap[index];
+    }
+    mesh.vertices = std::move(vertices);
+}
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation": greedily emits the triangle with the
+// highest score, a vertex scores high while it sits in a simulated LRU cache and while few of
+// its triangles remain (so isolated triangles get finished instead of left behind).
+const uint32_t FORSYTH_CACHE_SIZE = 32;
+const float FORSYTH_CACHE_DECAY = 1.5f;
+const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+const float FORSYTH_VALENCE_SCALE = 2.0f;
+const float FORSYTH_VALENCE_POWER = 0.5f;
+
+static float forsyth_score(int32_t cachePosition, uint32_t remainingTriangles) {
+    if (remainingTriangles == 0) return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // the last triangle's vertices, using them again barely changes the cache
+            score = FORSYTH_LAST_TRIANGLE_SCORE;
+        } else {
+            float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY);
+        }
+    }
+    return score + FORSYTH_VALENCE_SCALE * std::pow(static_cast<float>(remainingTriangles), -FORSYTH_VALENCE_POWER);
+}
+
+void optimize_vertex_cache(Mesh& mesh) {
+    size_t triangleCount = mesh.indices.size() / 3;
+    size_t vertexCount = mesh.vertices.size();
+    if (triangleCount == 0) return;
+
+    // triangles of every vertex, compacted into one array
+    std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+    for (uint32_t index : mesh.indices) triangleOffsets[index + 1]++;
+    for (size_t v = 0; v < vertexCount; ++v) triangleOffsets[v + 1] += triangleOffsets[v];
+    std::vector<uint32_t> remaining(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) remaining[v] = triangleOffsets[v + 1] - triangleOffsets[v];
+    std::vector<uint32_t> vertexTriangles(mesh.indices.size());
+    {
+        std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+        for (size_t i = 0; i < mesh.indices.size(); ++i) {
+            vertexTriangles[fill[mesh.indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vertexScore[v] = forsyth_score(-1, remaining[v]);
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = vertexScore[mesh.indices[t * 3]] + vertexScore[mesh.indices[t * 3 + 1]]
+                           + vertexScore[mesh.indices[t * 3 + 2]];
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(mesh.indices.size());
+    // cache plus room for the three vertices pushed in front of it
+    std::vector<uint32_t> cache, nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    size_t scanPosition = 0;
+    int64_t best = 0;
+    float bestScore = triangleScore[0];
+    for (size_t t = 1; t < triangleCount; ++t) {
+        if (triangleScore[t] > bestScore) {
+            bestScore = triangleScore[t];
+            best = static_cast<int64_t>(t);
+        }
+    }
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+        if (best < 0) {
+            // nothing in the cache touches a pending triangle, continue with the next one in order
+            while (emitted[scanPosition]) scanPosition++;
+            best = static_cast<int64_t>(scanPosition);
+        }
+
+        const uint32_t* triangle = &mesh.indices[best * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+        emitted[best] = true;
+
+        // the triangle's vertices move to the front of the LRU cache
+        nextCache.assign(triangle, triangle + 3);
+        for (uint32_t v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) nextCache.push_back(v);
+        }
+        for (int c = 0; c < 3; ++c) {
+            uint32_t v = triangle[c];
+            uint32_t* begin = &vertexTriangles[triangleOffsets[v]];
+            uint32_t* end = begin + remaining[v];
+            std::swap(*std::find(begin, end, static_cast<uint32_t>(best)), *(end - 1));
+            remaining[v]--;
+        }
+
+        // rescore everything whose cache position changed, vertices pushed out drop to uncached
+        for (size_t c = 0; c < nextCache.size(); ++c) {
+            uint32_t v = nextCache[c];
+            cachePosition[v] = c < FORSYTH_CACHE_SIZE ? static_cast<int32_t>(c) : -1;
+            float score = forsyth_score(cachePosition[v], remaining[v]);
+            float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+            for (uint32_t i = 0; i < remaining[v]; ++i) {
+                triangleScore[vertexTriangles[triangleOffsets[v] + i]] += delta;
+            }
+        }
+        if (nextCache.size() > FORSYTH_CACHE_SIZE) nextCache.resize(FORSYTH_CACHE_SIZE);
+        std::swap(cache, nextCache);
+
+        // only triangles of cached vertices can have become the best one
+        best = -1;
+        bestScore = -1.0f;
+        for (uint32_t v : cache) {
+            for (uint32_t i = 0; i < remaining[v]; ++i) {
+                uint32_t t = vertexTriangles[triangleOffsets[v] + i];
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+    }
+
+    mesh.indices = std::move(result);
+}
+
+void optimize_vertex_fetch(Mesh& mesh) {
+    const uint32_t unassigned = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(mesh.vertices.size(), unassigned);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for (auto& index : mesh.indices) {
+        if (remap[index] == unassigned) {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices = std::move(vertices);
+}
+
+void fit_unit_cube(Mesh& mesh) {
+    if (mesh.vertices.empty()) return;
+
+    glm::vec3 lower = mesh.vertices[0].pos, upper = mesh.vertices[0].pos;
+    for (const auto& vertex : mesh.vertices) {
+        for (int c = 0; c < 3; ++c) {
+            lower[c] = std::min(lower[c], vertex.pos[c]);
+            upper[c] = std::max(upper[c], vertex.pos[c]);
+        }
+    }
+    float extent = std::max(upper.x - lower.x, std::max(upper.y - lower.y, upper.z - lower.z));
+    float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+    for (auto& vertex : mesh.vertices) {
+        for (int c = 0; c < 3; ++c) {
+            vertex.pos[c] = (vertex.pos[c] - (lower[c] + upper[c]) * 0.5f) * scale;
+        }
+    }
+}
+
+VertexCacheStats analyze_vertex_cache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize) {
+    VertexCacheStats stats;
+    if (indices.empty() || vertexCount == 0) return stats;
+
+    // FIFO like the post-transform caches of most hardware, a hit does not refresh the entry
+    std::vector<uint32_t> fifo(cacheSize, std::numeric_limits<uint32_t>::max());
+    size_t head = 0;
+    uint64_t transformed = 0;
+    for (uint32_t index : indices) {
+        if (std::find(fifo.begin(), fifo.end(), index) != fifo.end()) continue;
+        fifo[head] = index;
+        head = (head + 1) % cacheSize;
+        transformed++;
+    }
+
+    stats.acmr = static_cast<float>(transformed) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(transformed) / static_cast<float>(vertexCount);
+    return stats;
+}
+
+VkIndexType choose_index_type(uint32_t vertexCount) {
+    return vertexCount <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+uint32_t index_type_size(VkIndexType indexType) {
+    return indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+}
+
+std::vector<uint8_t> pack_indices(const std::vector<uint32_t>& indices, VkIndexType indexType) {
+    std::vector<uint8_t> packed(indices.size() * index_type_size(indexType));
+    if (indexType == VK_INDEX_TYPE_UINT32) {
+        std::memcpy(packed.data(), indices.data(), packed.size());
+        return packed;
+    }
+    for (size_t i = 0; i < indices.size(); ++i) {
+        auto index = static_cast<uint16_t>(indices[i]);
+        std::memcpy(packed.data() + i * 2, &index, 2);
+    }
+    return packed;
+}
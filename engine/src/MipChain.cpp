@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIP_CHAIN_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MIP_CHAIN_NEON
+#endif
+
+#include "../headers/MipChain.h"
+
+// linear values are quantized to 12 bits on the way back to sRGB
+const uint32_t LINEAR_TO_SRGB_STEPS = 4096;
+
+static float srgb_to_linear(float value) {
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linear_to_srgb(float value) {
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static const std::array<float, 256>& srgb_decode_table() {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> values = {};
+        for (uint32_t i = 0; i < values.size(); ++i) values[i] = srgb_to_linear(i / 255.0f);
+        return values;
+    }();
+    return table;
+}
+
+static const std::vector<uint8_t>& srgb_encode_table() {
+    static const std::vector<uint8_t> table = [] {
+        std::vector<uint8_t> values(LINEAR_TO_SRGB_STEPS);
+        for (uint32_t i = 0; i < values.size(); ++i) {
+            values[i] = static_cast<uint8_t>(linear_to_srgb(i / float(LINEAR_TO_SRGB_STEPS - 1)) * 255.0f + 0.5f);
+        }
+        return values;
+    }();
+    return table;
+}
+
+// averages the 2x2 block of RGBA float pixels at (2x, 2y), edges of odd sized levels are clamped
+static void downsample_row(const float* src, uint32_t srcWidth, uint32_t srcHeight, float* dst, uint32_t dstWidth, uint32_t y) {
+    const float* row0 = src + size_t(std::min(2 * y, srcHeight - 1)) * srcWidth * 4;
+    const float* row1 = src + size_t(std::min(2 * y + 1, srcHeight - 1)) * srcWidth * 4;
+
+    for (uint32_t x = 0; x < dstWidth; ++x) {
+        uint32_t x0 = std::min(2 * x, srcWidth - 1) * 4;
+        uint32_t x1 = std::min(2 * x + 1, srcWidth - 1) * 4;
+#if defined(MIP_CHAIN_SSE2)
+        __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)),
+                                _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+        _mm_storeu_ps(dst + x * 4, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#elif defined(MIP_CHAIN_NEON)
+        float32x4_t sum = vaddq_f32(vaddq_f32(vld1q_f32(row0 + x0), vld1q_f32(row0 + x1)),
+                                    vaddq_f32(vld1q_f32(row1 + x0), vld1q_f32(row1 + x1)));
+        vst1q_f32(dst + x * 4, vmulq_n_f32(sum, 0.25f));
+#else
+        for (uint32_t c = 0; c < 4; ++c) {
+            dst[x * 4 + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+        }
+#endif
+    }
+}
+
+static void encode_level(const float* src, size_t pixelCount, bool srgb, uint8_t* dst) {
+    const std::vector<uint8_t>& encode = srgb_encode_table();
+    for (size_t i = 0; i < pixelCount * 4; ++i) {
+        float value = std::clamp(src[i], 0.0f, 1.0f);
+        // alpha is always linear
+        if (srgb && (i & 3) != 3) {
+            dst[i] = encode[static_cast<uint32_t>(value * (LINEAR_TO_SRGB_STEPS - 1) + 0.5f)];
+        } else {
+            dst[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+        }
+    }
+}
+
+uint32_t mip_level_count(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    while (levels < 32 && (std::max(width, height) >> levels) > 0) levels++;
+    return levels;
+}
+
+std::vector<uint8_t> build_mip_chain_rgba8(const uint8_t* pixels, uint32_t width, uint32_t height, bool srgb,
+                                           std::vector<ImageLevel>& levels) {
+    uint32_t levelCount = mip_level_count(width, height);
+    levels.resize(levelCount);
+
+    VkDeviceSize totalSize = 0;
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        levels[level].offset = totalSize;
+        levels[level].width = std::max(width >> level, 1u);
+        levels[level].height = std::max(height >> level, 1u);
+        totalSize += VkDeviceSize(levels[level].width) * levels[level].height * 4;
+    }
+
+    std::vector<uint8_t> chain(totalSize);
+    std::copy(pixels, pixels + size_t(width) * height * 4, chain.begin());
+
+    // filtering happens on linear floats, every level is encoded from the float level above it
+    const std::array<float, 256>& decode = srgb_decode_table();
+    std::vector<float> current(size_t(width) * height * 4);
+    for (size_t i = 0; i < current.size(); ++i) {
+        current[i] = (srgb && (i & 3) != 3) ? decode[pixels[i]] : pixels[i] / 255.0f;
+    }
+
+    std::vector<float> next;
+    for (uint32_t level = 1; level < levelCount; ++level) {
+        const ImageLevel& src = levels[level - 1];
+        const ImageLevel& dst = levels[level];
+        next.resize(size_t(dst.width) * dst.height * 4);
+        for (uint32_t y = 0; y < dst.height; ++y) {
+            downsample_row(current.data(), src.width, src.height, next.data() + size_t(y) * dst.width * 4, dst.width, y);
+        }
+        encode_level(next.data(), size_t(dst.width) * dst.height, srgb, chain.data() + dst.offset);
+        current.swap(next);
+    }
+
+    return chain;
+}
@@ -0,0 +1,110 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "../headers/PipelineCache.h"
+
+void PipelineCache::init(VkDevice vkDevice, const VkPhysicalDeviceProperties& properties, const std::string& cachePath) {
+    device = vkDevice;
+    path = cachePath;
+
+    std::vector<char> data;
+    if (!path.empty()) {
+        std::ifstream file(path, std::ios::ate | std::ios::binary);
+        if (file.is_open()) {
+            std::streamoff size = file.tellg();
+            if (size > 0) {
+                data.resize(size);
+                file.seekg(0);
+                file.read(data.data(), data.size());
+            }
+            // a partial cache is no better than none, start empty
+            if (size < 0 || !file) {
+                std::cout << "pipeline cache " << path << " discarded: read failed\n";
+                data.clear();
+            }
+        }
+    }
+
+    std::string reason;
+    if (!data.empty() && !validate_header(data, properties, reason)) {
+        std::cout << "pipeline cache " << path << " discarded: " << reason << "\n";
+        data.clear();
+    }
+    warm = !data.empty();
+
+    VkPipelineCacheCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(device, &createInfo, nullptr, &cache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache");
+    }
+}
+
+bool PipelineCache::validate_header(const std::vector<char>& data, const VkPhysicalDeviceProperties& properties, std::string& reason) const {
+    VkPipelineCacheHeaderVersionOne header;
+    if (data.size() < sizeof(header)) {
+        reason = "file too small";
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+
+    if (header.headerSize < sizeof(header) || header.headerSize > data.size()) {
+        reason = "bad header size";
+        return false;
+    }
+    if (header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+        reason = "unknown header version";
+        return false;
+    }
+    if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID) {
+        reason = "written for an other device";
+        return false;
+    }
+    if (memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        reason = "written by an other driver version";
+        return false;
+    }
+    return true;
+}
+
+void PipelineCache::save() const {
+    if (path.empty() || cache == VK_NULL_HANDLE) return;
+
+    size_t size = 0;
+    vkGetPipelineCacheData(device, cache, &size, nullptr);
+    if (size == 0) return;
+
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS) {
+        std::cerr << "failed to read pipeline cache data\n";
+        return;
+    }
+
+    // write next to the target and rename over it, rename is atomic on the same filesystem
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), size);
+        if (!file.good()) {
+            std::cerr << "failed to write pipeline cache " << tmpPath << "\n";
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmpPath, path, error);
+    if (error) {
+        std::cerr << "failed to replace pipeline cache " << path << ": " << error.message() << "\n";
+        std::filesystem::remove(tmpPath, error);
+    }
+}
+
+void PipelineCache::destroy() {
+    vkDestroyPipelineCache(device, cache, nullptr);
+    cache = VK_NULL_HANDLE;
+}
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "../headers/TextureFile.h"
+#include "../headers/MipChain.h"
+
+// on disk, all fields little endian:
+//   header, variantCount * VariantHeader, variant data (each variant 16 byte aligned)
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipLevels;
+    uint32_t variantCount;
+};
+
+struct VariantHeader {
+    uint32_t format;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+
+const uint64_t VARIANT_ALIGNMENT = 16;
+
+bool is_block_compressed(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+uint32_t format_block_bytes(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+            return 8;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return 16;
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            return 4;
+        default:
+            throw std::runtime_error("unsupported texture format " + std::to_string(format));
+    }
+}
+
+VkDeviceSize texture_level_size(VkFormat format, uint32_t width, uint32_t height) {
+    if (is_block_compressed(format)) {
+        return VkDeviceSize((width + 3) / 4) * ((height + 3) / 4) * format_block_bytes(format);
+    }
+    return VkDeviceSize(width) * height * format_block_bytes(format);
+}
+
+VkDeviceSize texture_level_layout(VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels,
+                                  std::vector<ImageLevel>& levels) {
+    levels.resize(mipLevels);
+    VkDeviceSize offset = 0;
+    for (uint32_t level = 0; level < mipLevels; ++level) {
+        levels[level].offset = offset;
+        levels[level].width = std::max(width >> level, 1u);
+        levels[level].height = std::max(height >> level, 1u);
+        offset += texture_level_size(format, levels[level].width, levels[level].height);
+    }
+    return offset;
+}
+
+const char* texture_format_name(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            return "BC1";
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return "BC7";
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+            return "ETC2";
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            return "RGBA8";
+        default:
+            return "unknown";
+    }
+}
+
+TextureCompression texture_compression(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return TextureCompression::BC;
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+            return TextureCompression::ETC2;
+        default:
+            return TextureCompression::None;
+    }
+}
+
+void write_texture_file(const std::string& path, const TextureFile& texture) {
+    FileHeader header = {};
+    memcpy(header.magic, TEXTURE_FILE_MAGIC, sizeof(header.magic));
+    header.version = TEXTURE_FILE_VERSION;
+    header.width = texture.width;
+    header.height = texture.height;
+    header.mipLevels = texture.mipLevels;
+    header.variantCount = texture.variants.size();
+
+    std::vector<VariantHeader> variantHeaders(texture.variants.size());
+    uint64_t offset = sizeof(FileHeader) + sizeof(VariantHeader) * variantHeaders.size();
+    for (size_t i = 0; i < texture.variants.size(); ++i) {
+        offset = (offset + VARIANT_ALIGNMENT - 1) / VARIANT_ALIGNMENT * VARIANT_ALIGNMENT;
+        variantHeaders[i].format = texture.variants[i].format;
+        variantHeaders[i].offset = offset;
+        variantHeaders[i].size = texture.variants[i].size;
+        offset += variantHeaders[i].size;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open " + path + " for writing");
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(variantHeaders.data()), sizeof(VariantHeader) * variantHeaders.size());
+    for (size_t i = 0; i < texture.variants.size(); ++i) {
+        static const char padding[VARIANT_ALIGNMENT] = {};
+        file.write(padding, variantHeaders[i].offset - file.tellp());
+        file.write(reinterpret_cast<const char*>(texture.variants[i].payload), texture.variants[i].size);
+    }
+    if (!file) {
+        throw std::runtime_error("failed to write " + path);
+    }
+}
+
+TextureFile parse_texture_file(const uint8_t* data, size_t size, const std::string& name) {
+    FileHeader header;
+    if (size < sizeof(header)) {
+        throw std::runtime_error(name + ": not a cooked texture");
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, TEXTURE_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error(name + ": not a cooked texture");
+    }
+    if (header.version != TEXTURE_FILE_VERSION) {
+        throw std::runtime_error(name + ": unsupported texture file version " + std::to_string(header.version));
+    }
+    if (size < sizeof(header) + sizeof(VariantHeader) * uint64_t(header.variantCount)) {
+        throw std::runtime_error(name + ": truncated variant table");
+    }
+    if (header.width == 0 || header.height == 0 || header.mipLevels == 0
+        || header.mipLevels > mip_level_count(header.width, header.height)) {
+        throw std::runtime_error(name + ": invalid texture size " + std::to_string(header.width) + "x"
+                                 + std::to_string(header.height) + " with " + std::to_string(header.mipLevels)
+                                 + " mip levels");
+    }
+
+    TextureFile texture;
+    texture.width = header.width;
+    texture.height = header.height;
+    texture.mipLevels = header.mipLevels;
+    texture.variants.resize(header.variantCount);
+
+    for (uint32_t i = 0; i < header.variantCount; ++i) {
+        VariantHeader variantHeader;
+        memcpy(&variantHeader, data + sizeof(header) + i * sizeof(VariantHeader), sizeof(variantHeader));
+
+        TextureVariant& variant = texture.variants[i];
+        variant.format = static_cast<VkFormat>(variantHeader.format);
+        VkDeviceSize expected = texture_level_layout(variant.format, texture.width, texture.height,
+                                                     texture.mipLevels, variant.levels);
+        if (variantHeader.size != expected || variantHeader.offset > size || size - variantHeader.offset < variantHeader.size) {
+            throw std::runtime_error(name + ": variant " + texture_format_name(variant.format) + " is truncated");
+        }
+        variant.payload = data + variantHeader.offset;
+        variant.size = variantHeader.size;
+    }
+    return texture;
+}
+
+TextureFile read_texture_file(const std::string& path) {
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open " + path);
+    }
+    std::vector<uint8_t> data(file.tellg());
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+
+    // moving the vector keeps its buffer, the variants stay valid
+    TextureFile texture = parse_texture_file(data.data(), data.size(), path);
+    texture.storage = std::move(data);
+    return texture;
+}
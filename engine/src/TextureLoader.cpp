@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include <stb_image.h>
+
+#include "../headers/MipChain.h"
+#include "../headers/TextureLoader.h"
+
+TextureLoader::~TextureLoader() {
+    stop();
+}
+
+void TextureLoader::start(uint32_t threadCount) {
+    stopping = false;
+    for (uint32_t i = 0; i < std::max(threadCount, 1u); ++i) {
+        threads.emplace_back(&TextureLoader::worker_main, this);
+    }
+}
+
+void TextureLoader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        // dropped requests never finish, wait_finished must not wait for them
+        inFlight -= queue.size();
+        queue.clear();
+    }
+    wake.notify_all();
+    done.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+}
+
+void TextureLoader::request(TextureRequest textureRequest) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(textureRequest));
+        inFlight++;
+    }
+    wake.notify_one();
+}
+
+std::vector<DecodedTexture> TextureLoader::take_finished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<DecodedTexture> result;
+    result.swap(finished);
+    return result;
+}
+
+std::vector<DecodedTexture> TextureLoader::wait_finished() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return !finished.empty() || inFlight == 0; });
+    std::vector<DecodedTexture> result;
+    result.swap(finished);
+    return result;
+}
+
+uint32_t TextureLoader::pending() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return inFlight;
+}
+
+void TextureLoader::worker_main() {
+    while (true) {
+        TextureRequest textureRequest;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (stopping) return;
+            textureRequest = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        DecodedTexture texture = decode(textureRequest);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(std::move(texture));
+            inFlight--;
+        }
+        done.notify_all();
+    }
+}
+
+DecodedTexture TextureLoader::decode(const TextureRequest& textureRequest) {
+    auto startTime = std::chrono::steady_clock::now();
+
+    DecodedTexture texture;
+    texture.id = textureRequest.id;
+    texture.path = textureRequest.path;
+    texture.cooked = textureRequest.cooked;
+
+    try {
+        if (textureRequest.cooked) {
+            texture.file = textureRequest.asset.data != nullptr
+                    ? parse_texture_file(textureRequest.asset.data, textureRequest.asset.size, textureRequest.path)
+                    : read_texture_file(textureRequest.path);
+        } else {
+            int width, height, channels;
+            stbi_uc* pixels = textureRequest.asset.data != nullptr
+                    ? stbi_load_from_memory(textureRequest.asset.data, textureRequest.asset.size,
+                                            &width, &height, &channels, STBI_rgb_alpha)
+                    : stbi_load(textureRequest.path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+            if (!pixels) {
+                throw std::runtime_error("failed to load texture " + textureRequest.path);
+            }
+            texture.width = width;
+            texture.height = height;
+            if (textureRequest.buildMipChain) {
+                auto chain = std::make_shared<std::vector<uint8_t>>(
+                        build_mip_chain_rgba8(pixels, width, height, true, texture.levels));
+                stbi_image_free(pixels);
+                texture.pixels = std::shared_ptr<const uint8_t>(chain, chain->data());
+                texture.size = chain->size();
+            } else {
+                texture.pixels = std::shared_ptr<const uint8_t>(pixels, stbi_image_free);
+                texture.size = size_t(width) * height * 4;
+            }
+        }
+    } catch (const std::exception& e) {
+        texture.error = e.what();
+    }
+
+    texture.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    return texture;
+}
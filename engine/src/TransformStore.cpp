@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TRANSFORM_STORE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TRANSFORM_STORE_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TRANSFORM_STORE_NEON
+#endif
+
+#include "../headers/TransformStore.h"
+
+// widest vector any path uses, component arrays are aligned and padded to it
+const size_t MAX_SIMD_WIDTH = 8;
+
+// One lane type per instruction set with the handful of operations the kernel needs.
+// store_matrices transposes the sixteen element-major registers into width column major
+// matrices and writes the first lanes of them, stride bytes apart.
+struct ScalarLanes {
+    using Float = float;
+    static constexpr size_t width = 1;
+
+    static Float load(const float* p) { return *p; }
+    static void store(float* p, Float v) { *p = v; }
+    static Float set1(float v) { return v; }
+    static Float add(Float a, Float b) { return a + b; }
+    static Float sub(Float a, Float b) { return a - b; }
+    static Float mul(Float a, Float b) { return a * b; }
+    static Float madd(Float a, Float b, Float c) { return a * b + c; }
+    static Float inverse_length(Float squared) { return 1.0f / std::sqrt(squared); }
+
+    static void store_matrices(const Float m[16], size_t, uint8_t* out, size_t) {
+        std::memcpy(out, m, 16 * sizeof(float));
+    }
+};
+
+#if defined(TRANSFORM_STORE_AVX2) || defined(TRANSFORM_STORE_SSE2)
+struct SseLanes {
+    using Float = __m128;
+    static constexpr size_t width = 4;
+
+    static Float load(const float* p) { return _mm_load_ps(p); }
+    static void store(float* p, Float v) { _mm_store_ps(p, v); }
+    static Float set1(float v) { return _mm_set1_ps(v); }
+    static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    static Float madd(Float a, Float b, Float c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static Float inverse_length(Float squared) { return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(squared)); }
+
+    static void store_matrices(const Float m[16], size_t lanes, uint8_t* out, size_t stride) {
+        // columns[column * 4 + lane], so every matrix goes out as 64 contiguous bytes
+        Float columns[16];
+        for (size_t column = 0; column < 4; ++column) {
+            Float* rows = columns + column * 4;
+            rows[0] = m[column * 4];
+            rows[1] = m[column * 4 + 1];
+            rows[2] = m[column * 4 + 2];
+            rows[3] = m[column * 4 + 3];
+            _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+        }
+        // strides are not necessarily multiples of 16, and streaming stores lose on the partial lines
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            float* matrix = reinterpret_cast<float*>(out + lane * stride);
+            for (size_t column = 0; column < 4; ++column) _mm_storeu_ps(matrix + column * 4, columns[column * 4 + lane]);
+        }
+    }
+};
+#endif
+
+#if defined(TRANSFORM_STORE_AVX2)
+struct Avx2Lanes {
+    using Float = __m256;
+    static constexpr size_t width = 8;
+
+    static Float load(const float* p) { return _mm256_load_ps(p); }
+    static void store(float* p, Float v) { _mm256_store_ps(p, v); }
+    static Float set1(float v) { return _mm256_set1_ps(v); }
+    static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+#if defined(__FMA__)
+    static Float madd(Float a, Float b, Float c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+    static Float madd(Float a, Float b, Float c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+    static Float inverse_length(Float squared) {
+        return _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(squared));
+    }
+
+    // two 4x4 transposes per column, one for each 128 bit half
+    static void store_matrices(const Float m[16], size_t lanes, uint8_t* out, size_t stride) {
+        __m128 low[16];
+        __m128 high[16];
+        for (size_t i = 0; i < 16; ++i) {
+            low[i] = _mm256_castps256_ps128(m[i]);
+            high[i] = _mm256_extractf128_ps(m[i], 1);
+        }
+        SseLanes::store_matrices(low, std::min<size_t>(lanes, 4), out, stride);
+        if (lanes > 4) SseLanes::store_matrices(high, lanes - 4, out + 4 * stride, stride);
+    }
+};
+#endif
+
+#if defined(TRANSFORM_STORE_NEON)
+struct NeonLanes {
+    using Float = float32x4_t;
+    static constexpr size_t width = 4;
+
+    static Float load(const float* p) { return vld1q_f32(p); }
+    static void store(float* p, Float v) { vst1q_f32(p, v); }
+    static Float set1(float v) { return vdupq_n_f32(v); }
+    static Float add(Float a, Float b) { return vaddq_f32(a, b); }
+    static Float sub(Float a, Float b) { return vsubq_f32(a, b); }
+    static Float mul(Float a, Float b) { return vmulq_f32(a, b); }
+    static Float madd(Float a, Float b, Float c) { return vmlaq_f32(c, a, b); }
+    // reciprocal square root estimate refined with two Newton-Raphson steps
+    static Float inverse_length(Float squared) {
+        Float estimate = vrsqrteq_f32(squared);
+        estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(squared, estimate), estimate));
+        return vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(squared, estimate), estimate));
+    }
+
+    static void store_matrices(const Float m[16], size_t lanes, uint8_t* out, size_t stride) {
+        Float columns[16];
+        for (size_t column = 0; column < 4; ++column) {
+            float32x4x2_t xy = vtrnq_f32(m[column * 4], m[column * 4 + 1]);
+            float32x4x2_t zw = vtrnq_f32(m[column * 4 + 2], m[column * 4 + 3]);
+            columns[column * 4] = vcombine_f32(vget_low_f32(xy.val[0]), vget_low_f32(zw.val[0]));
+            columns[column * 4 + 1] = vcombine_f32(vget_low_f32(xy.val[1]), vget_low_f32(zw.val[1]));
+            columns[column * 4 + 2] = vcombine_f32(vget_high_f32(xy.val[0]), vget_high_f32(zw.val[0]));
+            columns[column * 4 + 3] = vcombine_f32(vget_high_f32(xy.val[1]), vget_high_f32(zw.val[1]));
+        }
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            float* matrix = reinterpret_cast<float*>(out + lane * stride);
+            for (size_t column = 0; column < 4; ++column) vst1q_f32(matrix + column * 4, columns[column * 4 + lane]);
+        }
+    }
+};
+#endif
+
+#if defined(TRANSFORM_STORE_AVX2)
+using SimdLanes = Avx2Lanes;
+#elif defined(TRANSFORM_STORE_SSE2)
+using SimdLanes = SseLanes;
+#elif defined(TRANSFORM_STORE_NEON)
+using SimdLanes = NeonLanes;
+#else
+using SimdLanes = ScalarLanes;
+#endif
+
+// integrate-and-compose over [first, last), first a multiple of L::width. A partial last vector
+// also integrates the lanes past last, callers only allow that for the padding after the last object
+template <class L>
+static void integrate_and_compose(float* const* c, size_t first, size_t last, float dt, const TransformOutput& output) {
+    using Float = typename L::Float;
+    const Float halfDt = L::set1(0.5f * dt);
+    const Float one = L::set1(1.0f);
+    const Float two = L::set1(2.0f);
+    const Float zero = L::set1(0.0f);
+
+    Float viewProj[16];
+    if (output.mvps != nullptr) {
+        for (int column = 0; column < 4; ++column) {
+            for (int row = 0; row < 4; ++row) viewProj[column * 4 + row] = L::set1(output.viewProj[column][row]);
+        }
+    }
+
+    for (size_t i = first; i < last; i += L::width) {
+        Float qx = L::load(c[TransformStore::QX] + i);
+        Float qy = L::load(c[TransformStore::QY] + i);
+        Float qz = L::load(c[TransformStore::QZ] + i);
+        Float qw = L::load(c[TransformStore::QW] + i);
+        const Float wx = L::load(c[TransformStore::WX] + i);
+        const Float wy = L::load(c[TransformStore::WY] + i);
+        const Float wz = L::load(c[TransformStore::WZ] + i);
+
+        // q += dt / 2 * (w, 0) * q
+        const Float dx = L::sub(L::madd(qw, wx, L::mul(wy, qz)), L::mul(wz, qy));
+        const Float dy = L::sub(L::madd(qw, wy, L::mul(wz, qx)), L::mul(wx, qz));
+        const Float dz = L::sub(L::madd(qw, wz, L::mul(wx, qy)), L::mul(wy, qx));
+        const Float dw = L::madd(wx, qx, L::madd(wy, qy, L::mul(wz, qz)));
+        qx = L::madd(halfDt, dx, qx);
+        qy = L::madd(halfDt, dy, qy);
+        qz = L::madd(halfDt, dz, qz);
+        qw = L::sub(qw, L::mul(halfDt, dw));
+
+        const Float scale = L::inverse_length(L::madd(qx, qx, L::madd(qy, qy, L::madd(qz, qz, L::mul(qw, qw)))));
+        qx = L::mul(qx, scale);
+        qy = L::mul(qy, scale);
+        qz = L::mul(qz, scale);
+        qw = L::mul(qw, scale);
+        L::store(c[TransformStore::QX] + i, qx);
+        L::store(c[TransformStore::QY] + i, qy);
+        L::store(c[TransformStore::QZ] + i, qz);
+        L::store(c[TransformStore::QW] + i, qw);
+
+        // translate * mat4_cast(q) * scale, element [column * 4 + row]
+        const Float xx = L::mul(qx, qx), yy = L::mul(qy, qy), zz = L::mul(qz, qz);
+        const Float xy = L::mul(qx, qy), xz = L::mul(qx, qz), yz = L::mul(qy, qz);
+        const Float wxq = L::mul(qw, qx), wyq = L::mul(qw, qy), wzq = L::mul(qw, qz);
+        const Float sx = L::load(c[TransformStore::SX] + i);
+        const Float sy = L::load(c[TransformStore::SY] + i);
+        const Float sz = L::load(c[TransformStore::SZ] + i);
+        const Float twoSx = L::mul(two, sx);
+        const Float twoSy = L::mul(two, sy);
+        const Float twoSz = L::mul(two, sz);
+
+        Float m[16];
+        m[0] = L::sub(sx, L::mul(twoSx, L::add(yy, zz)));
+        m[1] = L::mul(twoSx, L::add(xy, wzq));
+        m[2] = L::mul(twoSx, L::sub(xz, wyq));
+        m[3] = zero;
+        m[4] = L::mul(twoSy, L::sub(xy, wzq));
+        m[5] = L::sub(sy, L::mul(twoSy, L::add(xx, zz)));
+        m[6] = L::mul(twoSy, L::add(yz, wxq));
+        m[7] = zero;
+        m[8] = L::mul(twoSz, L::add(xz, wyq));
+        m[9] = L::mul(twoSz, L::sub(yz, wxq));
+        m[10] = L::sub(sz, L::mul(twoSz, L::add(xx, yy)));
+        m[11] = zero;
+        m[12] = L::load(c[TransformStore::PX] + i);
+        m[13] = L::load(c[TransformStore::PY] + i);
+        m[14] = L::load(c[TransformStore::PZ] + i);
+        m[15] = one;
+
+        const size_t lanes = std::min(L::width, last - i);
+        if (output.models != nullptr) {
+            L::store_matrices(m, lanes, output.models + i * output.modelStride, output.modelStride);
+        }
+        if (output.mvps != nullptr) {
+            // the bottom row of the model matrix is (0, 0, 0, 1)
+            Float mvp[16];
+            for (int column = 0; column < 4; ++column) {
+                for (int row = 0; row < 4; ++row) {
+                    Float value = column == 3 ? viewProj[12 + row] : zero;
+                    value = L::madd(viewProj[row], m[column * 4], value);
+                    value = L::madd(viewProj[4 + row], m[column * 4 + 1], value);
+                    mvp[column * 4 + row] = L::madd(viewProj[8 + row], m[column * 4 + 2], value);
+                }
+            }
+            L::store_matrices(mvp, lanes, output.mvps + i * output.mvpStride, output.mvpStride);
+        }
+    }
+}
+
+size_t TransformStore::simd_width() {
+    return SimdLanes::width;
+}
+
+const char* TransformStore::simd_name() {
+#if defined(TRANSFORM_STORE_AVX2)
+    return "avx2";
+#elif defined(TRANSFORM_STORE_SSE2)
+    return "sse2";
+#elif defined(TRANSFORM_STORE_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+void TransformStore::resize(size_t newCount) {
+    const size_t oldCount = count;
+    const size_t capacity = (newCount + MAX_SIMD_WIDTH - 1) / MAX_SIMD_WIDTH * MAX_SIMD_WIDTH;
+    std::vector<float> newStorage(COMPONENT_COUNT * capacity + MAX_SIMD_WIDTH, 0.0f);
+
+    auto address = reinterpret_cast<uintptr_t>(newStorage.data());
+    const uintptr_t alignment = MAX_SIMD_WIDTH * sizeof(float);
+    float* base = newStorage.data() + ((alignment - address % alignment) % alignment) / sizeof(float);
+
+    float* newComponents[COMPONENT_COUNT];
+    for (int component = 0; component < COMPONENT_COUNT; ++component) {
+        newComponents[component] = base + component * capacity;
+        if (components[component] != nullptr) {
+            std::copy(components[component], components[component] + std::min(oldCount, newCount),
+                      newComponents[component]);
+        }
+    }
+    // padding lanes included, so they stay finite through the normalization
+    for (size_t i = std::min(oldCount, newCount); i < capacity; ++i) {
+        newComponents[QW][i] = 1.0f;
+        newComponents[SX][i] = 1.0f;
+        newComponents[SY][i] = 1.0f;
+        newComponents[SZ][i] = 1.0f;
+    }
+
+    storage = std::move(newStorage);
+    std::copy(newComponents, newComponents + COMPONENT_COUNT, components);
+    count = newCount;
+}
+
+void TransformStore::set(size_t index, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale,
+                         const glm::vec3& angularVelocity) {
+    components[PX][index] = position.x;
+    components[PY][index] = position.y;
+    components[PZ][index] = position.z;
+    components[QX][index] = rotation.x;
+    components[QY][index] = rotation.y;
+    components[QZ][index] = rotation.z;
+    components[QW][index] = rotation.w;
+    components[SX][index] = scale.x;
+    components[SY][index] = scale.y;
+    components[SZ][index] = scale.z;
+    components[WX][index] = angularVelocity.x;
+    components[WY][index] = angularVelocity.y;
+    components[WZ][index] = angularVelocity.z;
+}
+
+glm::quat TransformStore::rotation(size_t index) const {
+    return glm::quat(components[QW][index], components[QX][index], components[QY][index], components[QZ][index]);
+}
+
+void TransformStore::update(size_t first, size_t last, float dt, const TransformOutput& output) {
+    last = std::min(last, count);
+    if (first >= last) return;
+
+    // whole vectors only, unless the partial one ends in padding, so neighbouring ranges never overlap
+    const size_t width = SimdLanes::width;
+    size_t begin = std::min((first + width - 1) / width * width, last);
+    size_t end = last == count ? last : std::max(begin, last / width * width);
+    integrate_and_compose<ScalarLanes>(components, first, begin, dt, output);
+    integrate_and_compose<SimdLanes>(components, begin, end, dt, output);
+    integrate_and_compose<ScalarLanes>(components, end, last, dt, output);
+}
+
+void TransformStore::update_scalar(size_t first, size_t last, float dt, const TransformOutput& output) {
+    last = std::min(last, count);
+    if (first >= last) return;
+    integrate_and_compose<ScalarLanes>(components, first, last, dt, output);
+}
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "../headers/UniformRing.h"
+
+static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void UniformRing::init(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator,
+                       VkDeviceSize regionSize, uint32_t regionCount) {
+    this->device = device;
+    this->allocator = &allocator;
+
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    alignment = std::max(properties.limits.minUniformBufferOffsetAlignment,
+                         properties.limits.minStorageBufferOffsetAlignment);
+    atomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+    // regions start on flushable boundaries, so flushing one never touches the next
+    this->regionSize = align_up(regionSize, std::max(alignment, atomSize));
+    this->regionCount = regionCount;
+
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = this->regionSize * regionCount;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create uniform ring buffer");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+    // flushes are rounded to whole atoms, those must not reach outside of the allocation
+    memoryRequirements.alignment = std::max(memoryRequirements.alignment, atomSize);
+    memoryRequirements.size = align_up(memoryRequirements.size, atomSize);
+    // whatever host visible type comes first, coherent or not
+    allocation = allocator.allocate(memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, ResourceKind::Linear);
+    vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+
+    mapped = static_cast<uint8_t*>(allocation.mapped);
+    coherent = (allocator.memory_properties().memoryTypes[allocation.memoryType].propertyFlags
+                & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+}
+
+void UniformRing::destroy() {
+    if (buffer == VK_NULL_HANDLE) return;
+    vkDestroyBuffer(device, buffer, nullptr);
+    allocator->free(allocation);
+    buffer = VK_NULL_HANDLE;
+    mapped = nullptr;
+}
+
+VkDeviceSize UniformRing::aligned_size(VkDeviceSize size) const {
+    return align_up(size, alignment);
+}
+
+void UniformRing::begin_frame(uint32_t slot) {
+    region = slot % regionCount;
+    head = 0;
+    flushedHead = 0;
+}
+
+VkDeviceSize UniformRing::allocate(VkDeviceSize size, void** data) {
+    VkDeviceSize alignedSize = aligned_size(size);
+    if (head + alignedSize > regionSize) {
+        throw std::runtime_error("uniform ring region of " + std::to_string(regionSize) + " bytes exhausted");
+    }
+    VkDeviceSize offset = region * regionSize + head;
+    head += alignedSize;
+    *data = mapped + offset;
+    return offset;
+}
+
+void UniformRing::flush() {
+    if (coherent || head == flushedHead) return;
+
+    VkDeviceSize regionStart = region * regionSize;
+    VkMappedMemoryRange range = {};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = allocation.offset + regionStart + flushedHead / atomSize * atomSize;
+    range.size = std::min(align_up(head, atomSize), regionSize) - flushedHead / atomSize * atomSize;
+    if (vkFlushMappedMemoryRanges(device, 1, &range) != VK_SUCCESS) {
+        throw std::runtime_error("failed to flush uniform ring");
+    }
+    flushedHead = head;
+}
@@ -0,0 +1,528 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "../headers/UploadQueue.h"
+
+static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void UploadQueue::init(VkDevice vkDevice, MemoryAllocator& memoryAllocator, GpuTimeline& gpuTimeline,
+                       uint32_t graphicsQueueFamily, VkQueue vkGraphicsQueue,
+                       uint32_t transferQueueFamily, VkQueue vkTransferQueue,
+                       VkDeviceSize stagingSize, VkDeviceSize optimalCopyOffsetAlignment) {
+    device = vkDevice;
+    allocator = &memoryAllocator;
+    timeline = &gpuTimeline;
+    graphicsFamily = graphicsQueueFamily;
+    graphicsQueue = vkGraphicsQueue;
+    transferFamily = transferQueueFamily;
+    transferQueue = vkTransferQueue;
+    stagingAlignment = std::max<VkDeviceSize>(16, optimalCopyOffsetAlignment);
+
+    VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = graphicsFamily;
+    if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &graphicsCommandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload command pool");
+    }
+    if (dedicated_transfer()) {
+        commandPoolCreateInfo.queueFamilyIndex = transferFamily;
+        if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &transferCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create transfer command pool");
+        }
+    }
+
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = stagingSize;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(device, &bufferCreateInfo, nullptr, &stagingBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create staging ring buffer!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, stagingBuffer, &memoryRequirements);
+    stagingAllocation = allocator->allocate(memoryRequirements,
+                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                            ResourceKind::Linear);
+    vkBindBufferMemory(device, stagingBuffer, stagingAllocation.memory, stagingAllocation.offset);
+    stagingCapacity = stagingSize;
+}
+
+void UploadQueue::destroy() {
+    submit();
+    while (!inFlight.empty()) {
+        retire_oldest(true);
+    }
+
+    for (auto& batch : freeBatches) {
+        destroy_batch(batch);
+    }
+    freeBatches.clear();
+
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    allocator->free(stagingAllocation);
+
+    vkDestroyCommandPool(device, graphicsCommandPool, nullptr);
+    if (transferCommandPool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(device, transferCommandPool, nullptr);
+    }
+}
+
+UploadQueue::Batch UploadQueue::create_batch() {
+    Batch batch;
+
+    VkCommandBufferAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = 1;
+    allocateInfo.commandPool = graphicsCommandPool;
+    if (vkAllocateCommandBuffers(device, &allocateInfo, &batch.graphicsCommandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer");
+    }
+
+    if (dedicated_transfer()) {
+        allocateInfo.commandPool = transferCommandPool;
+        if (vkAllocateCommandBuffers(device, &allocateInfo, &batch.transferCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate transfer command buffer");
+        }
+
+        VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        if (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &batch.transferDone) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create transfer semaphore");
+        }
+    }
+
+    if (gpuTiming) {
+        VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+        queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolCreateInfo.queryCount = 2;
+        if (vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &batch.timestampPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload query pool");
+        }
+    }
+
+    return batch;
+}
+
+void UploadQueue::destroy_batch(Batch& batch) {
+    if (batch.timestampPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(device, batch.timestampPool, nullptr);
+    }
+    if (batch.transferDone != VK_NULL_HANDLE) {
+        vkDestroySemaphore(device, batch.transferDone, nullptr);
+    }
+}
+
+void UploadQueue::begin_batch() {
+    if (current.recording) return;
+
+    Batch resources;
+    if (freeBatches.empty()) {
+        resources = create_batch();
+    } else {
+        resources = freeBatches.back();
+        freeBatches.pop_back();
+    }
+    current.graphicsCommandBuffer = resources.graphicsCommandBuffer;
+    current.transferCommandBuffer = resources.transferCommandBuffer;
+    current.transferDone = resources.transferDone;
+    current.timestampPool = resources.timestampPool;
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(current.graphicsCommandBuffer, &beginInfo);
+    if (dedicated_transfer()) {
+        vkBeginCommandBuffer(current.transferCommandBuffer, &beginInfo);
+    }
+    if (current.timestampPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(current.graphicsCommandBuffer, current.timestampPool, 0, 2);
+        vkCmdWriteTimestamp(current.graphicsCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, current.timestampPool, 0);
+    }
+    current.recording = true;
+}
+
+bool UploadQueue::retire_oldest(bool wait) {
+    if (inFlight.empty()) return false;
+    Batch& batch = inFlight.front();
+
+    if (wait) {
+        timeline->wait(batch.ticket);
+    } else if (!timeline->is_complete(batch.ticket)) {
+        return false;
+    }
+
+    if (batch.timestampPool != VK_NULL_HANDLE) {
+        uint64_t timestamps[2];
+        if (vkGetQueryPoolResults(device, batch.timestampPool, 0, 2, sizeof(timestamps), timestamps,
+                                  sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            gpuTimes.push_back(((timestamps[1] - timestamps[0]) & timestampMask) * timestampPeriod / 1e6);
+        }
+    }
+
+    stagingUsed -= batch.stagingBytes;
+    for (auto& [buffer, allocation] : batch.dedicatedStaging) {
+        vkDestroyBuffer(device, buffer, nullptr);
+        allocator->free(allocation);
+    }
+
+    vkResetCommandBuffer(batch.graphicsCommandBuffer, 0);
+    if (batch.transferCommandBuffer != VK_NULL_HANDLE) {
+        vkResetCommandBuffer(batch.transferCommandBuffer, 0);
+    }
+
+    completedTicket = batch.ticket;
+
+    Batch resources;
+    resources.graphicsCommandBuffer = batch.graphicsCommandBuffer;
+    resources.transferCommandBuffer = batch.transferCommandBuffer;
+    resources.transferDone = batch.transferDone;
+    resources.timestampPool = batch.timestampPool;
+    freeBatches.push_back(resources);
+
+    inFlight.pop_front();
+    return true;
+}
+
+VkDeviceSize UploadQueue::reserve_staging(VkDeviceSize size, VkBuffer& buffer) {
+    if (size > stagingCapacity) {
+        VkBufferCreateInfo bufferCreateInfo = {};
+        bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferCreateInfo.size = size;
+        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create staging buffer!");
+        }
+
+        VkMemoryRequirements memoryRequirements;
+        vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+        Allocation allocation = allocator->allocate(memoryRequirements,
+                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                    ResourceKind::Linear);
+        vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+        current.dedicatedStaging.emplace_back(buffer, allocation);
+        return 0;
+    }
+
+    VkDeviceSize offset, needed;
+    for (;;) {
+        if (stagingUsed == 0) stagingHead = 0;
+
+        VkDeviceSize alignedHead = align_up(stagingHead, stagingAlignment);
+        if (alignedHead + size <= stagingCapacity) {
+            offset = alignedHead;
+            needed = alignedHead - stagingHead + size;
+        } else {
+            // the tail end of the ring is too short, skip it and start over at 0
+            offset = 0;
+            needed = stagingCapacity - stagingHead + size;
+        }
+
+        if (stagingCapacity - stagingUsed >= needed) break;
+
+        if (!inFlight.empty()) {
+            retire_oldest(true);
+        } else if (current.recording) {
+            submit();
+        } else {
+            throw std::runtime_error("staging ring exhausted");
+        }
+    }
+
+    stagingUsed += needed;
+    current.stagingBytes += needed;
+    stagingHead = offset + size;
+
+    buffer = stagingBuffer;
+    return offset;
+}
+
+void UploadQueue::copy_to_staging(const void* data, VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset) {
+    offset = reserve_staging(size, buffer);
+
+    void* mapped;
+    if (buffer == stagingBuffer) {
+        mapped = static_cast<char*>(stagingAllocation.mapped) + offset;
+    } else {
+        mapped = current.dedicatedStaging.back().second.mapped;
+    }
+    memcpy(mapped, data, (size_t) size);
+}
+
+void UploadQueue::upload_buffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size,
+                                VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask) {
+    VkBuffer srcBuffer;
+    VkDeviceSize srcOffset;
+    copy_to_staging(data, size, srcBuffer, srcOffset);
+    begin_batch();
+
+    VkCommandBuffer copyCommandBuffer = dedicated_transfer() ? current.transferCommandBuffer : current.graphicsCommandBuffer;
+
+    VkBufferCopy bufferCopy = {};
+    bufferCopy.srcOffset = srcOffset;
+    bufferCopy.dstOffset = dstOffset;
+    bufferCopy.size = size;
+    vkCmdCopyBuffer(copyCommandBuffer, srcBuffer, dstBuffer, 1, &bufferCopy);
+
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.buffer = dstBuffer;
+    barrier.offset = dstOffset;
+    barrier.size = size;
+
+    if (dedicated_transfer()) {
+        barrier.srcQueueFamilyIndex = transferFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+
+        // release on the transfer queue ...
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(current.transferCommandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+        // ... and acquire on the graphics queue
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = dstAccessMask;
+        vkCmdPipelineBarrier(current.graphicsCommandBuffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStageMask,
+                             0, 0, nullptr, 1, &barrier, 0, nullptr);
+    } else {
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = dstAccessMask;
+        vkCmdPipelineBarrier(current.graphicsCommandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask,
+                             0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+}
+
+void UploadQueue::upload_image(const ImageUpload& upload) {
+    VkBuffer srcBuffer;
+    VkDeviceSize srcOffset;
+    copy_to_staging(upload.data, upload.size, srcBuffer, srcOffset);
+    begin_batch();
+
+    VkCommandBuffer copyCommandBuffer = dedicated_transfer() ? current.transferCommandBuffer : current.graphicsCommandBuffer;
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.image = upload.image;
+    barrier.subresourceRange = {
+            upload.aspectFlags,
+            0, upload.mipLevels, 0, 1
+    };
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(copyCommandBuffer,
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    std::vector<ImageLevel> levels = upload.levels;
+    if (levels.empty()) {
+        levels.push_back({0, upload.width, upload.height});
+    }
+    std::vector<VkBufferImageCopy> copies(levels.size());
+    for (uint32_t level = 0; level < levels.size(); ++level) {
+        copies[level].bufferOffset = srcOffset + levels[level].offset;
+        copies[level].imageSubresource = {
+                upload.aspectFlags,
+                level, 0, 1
+        };
+        copies[level].imageOffset = {0, 0, 0};
+        copies[level].imageExtent = {
+                levels[level].width, levels[level].height, 1
+        };
+    }
+    vkCmdCopyBufferToImage(copyCommandBuffer, srcBuffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           copies.size(), copies.data());
+
+    // blits only run on the graphics queue, the generated levels leave the image in finalLayout
+    bool generate = upload.generateMips && levels.size() < upload.mipLevels;
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = generate ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : upload.finalLayout;
+
+    if (dedicated_transfer()) {
+        barrier.srcQueueFamilyIndex = transferFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(current.transferCommandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = generate ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : upload.dstAccessMask;
+        vkCmdPipelineBarrier(current.graphicsCommandBuffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             generate ? (VkPipelineStageFlags) VK_PIPELINE_STAGE_TRANSFER_BIT : upload.dstStageMask,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    } else if (!generate) {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = upload.dstAccessMask;
+        vkCmdPipelineBarrier(current.graphicsCommandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, upload.dstStageMask,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    if (generate) {
+        generate_mips(upload, levels.size());
+    }
+}
+
+void UploadQueue::generate_mips(const ImageUpload& upload, uint32_t firstLevel) {
+    VkCommandBuffer commandBuffer = current.graphicsCommandBuffer;
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.image = upload.image;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange = {
+            upload.aspectFlags,
+            0, 1, 0, 1
+    };
+
+    int32_t width = std::max(upload.width >> (firstLevel - 1), 1u);
+    int32_t height = std::max(upload.height >> (firstLevel - 1), 1u);
+
+    // every level is blitted from the one above it, which is then done and handed to the shaders
+    for (uint32_t level = firstLevel; level <= upload.mipLevels; ++level) {
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        if (level < upload.mipLevels) {
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            int32_t nextWidth = std::max(width / 2, 1);
+            int32_t nextHeight = std::max(height / 2, 1);
+
+            VkImageBlit blit = {};
+            blit.srcSubresource = {upload.aspectFlags, level - 1, 0, 1};
+            blit.srcOffsets[0] = {0, 0, 0};
+            blit.srcOffsets[1] = {width, height, 1};
+            blit.dstSubresource = {upload.aspectFlags, level, 0, 1};
+            blit.dstOffsets[0] = {0, 0, 0};
+            blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+            vkCmdBlitImage(commandBuffer,
+                           upload.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1, &blit, VK_FILTER_LINEAR);
+
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            width = nextWidth;
+            height = nextHeight;
+        } else {
+            // the last level was only ever written
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        }
+        barrier.newLayout = upload.finalLayout;
+        barrier.dstAccessMask = upload.dstAccessMask;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, upload.dstStageMask,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    // uploaded levels below firstLevel - 1 were never read, they only need their final layout
+    if (firstLevel > 1) {
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = firstLevel - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = upload.finalLayout;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = upload.dstAccessMask;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, upload.dstStageMask,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
+
+uint64_t UploadQueue::submit() {
+    if (!current.recording) return 0;
+
+    if (current.timestampPool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(current.graphicsCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current.timestampPool, 1);
+    }
+    vkEndCommandBuffer(current.graphicsCommandBuffer);
+    if (dedicated_transfer()) {
+        vkEndCommandBuffer(current.transferCommandBuffer);
+
+        VkSubmitInfo transferSubmit = {};
+        transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        transferSubmit.commandBufferCount = 1;
+        transferSubmit.pCommandBuffers = &current.transferCommandBuffer;
+        transferSubmit.signalSemaphoreCount = 1;
+        transferSubmit.pSignalSemaphores = &current.transferDone;
+        if (vkQueueSubmit(transferQueue, 1, &transferSubmit, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit transfer batch");
+        }
+    }
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo graphicsSubmit = {};
+    graphicsSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    graphicsSubmit.commandBufferCount = 1;
+    graphicsSubmit.pCommandBuffers = &current.graphicsCommandBuffer;
+    if (dedicated_transfer()) {
+        graphicsSubmit.waitSemaphoreCount = 1;
+        graphicsSubmit.pWaitSemaphores = &current.transferDone;
+        graphicsSubmit.pWaitDstStageMask = &waitStage;
+    }
+    current.ticket = timeline->submit(graphicsQueue, graphicsSubmit);
+    current.recording = false;
+    uint64_t ticket = current.ticket;
+    inFlight.push_back(std::move(current));
+    current = Batch{};
+
+    return ticket;
+}
+
+bool UploadQueue::is_complete(uint64_t ticket) {
+    collect();
+    return ticket <= completedTicket;
+}
+
+void UploadQueue::wait(uint64_t ticket) {
+    while (completedTicket < ticket && !inFlight.empty()) {
+        retire_oldest(true);
+    }
+}
+
+void UploadQueue::enable_gpu_timing(float period, uint64_t mask) {
+    if (dedicated_transfer()) return;
+    gpuTiming = true;
+    timestampPeriod = period;
+    timestampMask = mask;
+}
+
+std::vector<double> UploadQueue::take_gpu_times() {
+    std::vector<double> times;
+    times.swap(gpuTimes);
+    return times;
+}
+
+void UploadQueue::collect() {
+    while (retire_oldest(false)) {}
+}
@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <glm/gtc/packing.hpp>
+
+#include "../headers/VertexLayout.h"
+
+VertexLayout parse_vertex_layout(const std::string& spec) {
+    VertexLayout layout;
+    if (spec == "compact") return layout;
+    if (spec == "float") {
+        layout.position = PositionEncoding::Float32;
+        layout.normal = NormalEncoding::Float32;
+        layout.color = ColorEncoding::Float32;
+        layout.texCoord = TexCoordEncoding::Float32;
+        return layout;
+    }
+
+    std::stringstream stream(spec);
+    std::string pair;
+    while (std::getline(stream, pair, ',')) {
+        size_t equals = pair.find('=');
+        std::string attribute = pair.substr(0, equals);
+        std::string encoding = equals == std::string::npos ? "" : pair.substr(equals + 1);
+
+        bool valid = true;
+        if (attribute == "position") {
+            if (encoding == "float") layout.position = PositionEncoding::Float32;
+            else if (encoding == "half") layout.position = PositionEncoding::Float16;
+            else if (encoding == "snorm16") layout.position = PositionEncoding::Snorm16;
+            else valid = false;
+        } else if (attribute == "normal") {
+            if (encoding == "float") layout.normal = NormalEncoding::Float32;
+            else if (encoding == "oct16") layout.normal = NormalEncoding::Octahedral16;
+            else valid = false;
+        } else if (attribute == "color") {
+            if (encoding == "float") layout.color = ColorEncoding::Float32;
+            else if (encoding == "unorm8") layout.color = ColorEncoding::Unorm8;
+            else valid = false;
+        } else if (attribute == "texcoord") {
+            if (encoding == "float") layout.texCoord = TexCoordEncoding::Float32;
+            else if (encoding == "half") layout.texCoord = TexCoordEncoding::Float16;
+            else if (encoding == "unorm16") layout.texCoord = TexCoordEncoding::Unorm16;
+            else valid = false;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            throw std::invalid_argument("invalid vertex layout entry '" + pair + "'");
+        }
+    }
+    return layout;
+}
+
+std::string vertex_layout_name(const VertexLayout& layout) {
+    const char* position[] = {"float", "half", "snorm16"};
+    const char* normal[] = {"float", "oct16"};
+    const char* color[] = {"float", "unorm8"};
+    const char* texCoord[] = {"float", "half", "unorm16"};
+    return std::string("position=") + position[static_cast<int>(layout.position)]
+           + ",normal=" + normal[static_cast<int>(layout.normal)]
+           + ",color=" + color[static_cast<int>(layout.color)]
+           + ",texcoord=" + texCoord[static_cast<int>(layout.texCoord)];
+}
+
+// three component 16 bit formats are rarely supported for vertex buffers, the padded four
+// component ones always are
+VkFormat position_format(PositionEncoding encoding) {
+    switch (encoding) {
+        case PositionEncoding::Float16: return VK_FORMAT_R16G16B16A16_SFLOAT;
+        case PositionEncoding::Snorm16: return VK_FORMAT_R16G16B16A16_SNORM;
+        default: return VK_FORMAT_R32G32B32_SFLOAT;
+    }
+}
+
+VkFormat normal_format(NormalEncoding encoding) {
+    return encoding == NormalEncoding::Octahedral16 ? VK_FORMAT_R16G16_SNORM : VK_FORMAT_R32G32B32_SFLOAT;
+}
+
+VkFormat color_format(ColorEncoding encoding) {
+    return encoding == ColorEncoding::Unorm8 ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R32G32B32_SFLOAT;
+}
+
+VkFormat texcoord_format(TexCoordEncoding encoding) {
+    switch (encoding) {
+        case TexCoordEncoding::Float16: return VK_FORMAT_R16G16_SFLOAT;
+        case TexCoordEncoding::Unorm16: return VK_FORMAT_R16G16_UNORM;
+        default: return VK_FORMAT_R32G32_SFLOAT;
+    }
+}
+
+static uint32_t format_size(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R16G16_SNORM:
+        case VK_FORMAT_R16G16_UNORM:
+        case VK_FORMAT_R16G16_SFLOAT:
+            return 4;
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R16G16B16A16_SNORM:
+        case VK_FORMAT_R32G32_SFLOAT:
+            return 8;
+        default:
+            return 12;
+    }
+}
+
+namespace {
+
+// attributes in buffer order, every size is a multiple of 4 so offsets stay aligned
+struct AttributeSlot {
+    uint32_t location;
+    VkFormat format;
+};
+
+std::vector<AttributeSlot> attribute_slots(const VertexLayout& layout) {
+    return {
+            {POSITION_LOCATION, position_format(layout.position)},
+            {NORMAL_LOCATION, normal_format(layout.normal)},
+            {TEXCOORD_LOCATION, texcoord_format(layout.texCoord)},
+            {COLOR_LOCATION, color_format(layout.color)},
+    };
+}
+
+}
+
+uint32_t vertex_stride(const VertexLayout& layout) {
+    uint32_t stride = 0;
+    for (const auto& slot : attribute_slots(layout)) stride += format_size(slot.format);
+    return stride;
+}
+
+VkVertexInputBindingDescription vertex_binding_description(const VertexLayout& layout, uint32_t binding) {
+    VkVertexInputBindingDescription bindingDescription = {};
+    bindingDescription.binding = binding;
+    bindingDescription.stride = vertex_stride(layout);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    return bindingDescription;
+}
+
+std::vector<VkVertexInputAttributeDescription> vertex_attribute_descriptions(const VertexLayout& layout, uint32_t binding) {
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+    uint32_t offset = 0;
+    for (const auto& slot : attribute_slots(layout)) {
+        VkVertexInputAttributeDescription attribute = {};
+        attribute.binding = binding;
+        attribute.location = slot.location;
+        attribute.format = slot.format;
+        attribute.offset = offset;
+        attributeDescriptions.push_back(attribute);
+        offset += format_size(slot.format);
+    }
+    return attributeDescriptions;
+}
+
+VertexLayout fit_vertex_layout(VertexLayout layout, const std::vector<Vertex>& vertices) {
+    if (layout.texCoord == TexCoordEncoding::Unorm16) {
+        for (const auto& vertex : vertices) {
+            if (vertex.texCoord.x < 0.0f || vertex.texCoord.x > 1.0f || vertex.texCoord.y < 0.0f || vertex.texCoord.y > 1.0f) {
+                layout.texCoord = TexCoordEncoding::Float16;
+                break;
+            }
+        }
+    }
+    return layout;
+}
+
+// Cigolle et al., "A Survey of Efficient Representations for Independent Unit Vectors"
+static glm::vec2 octahedral_encode(glm::vec3 n) {
+    float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (length == 0.0f) return glm::vec2(0.0f);
+    glm::vec2 p(n.x / length, n.y / length);
+    if (n.z < 0.0f) {
+        glm::vec2 folded((1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                         (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+        p = folded;
+    }
+    return p;
+}
+
+std::vector<uint8_t> encode_vertices(const std::vector<Vertex>& vertices, const VertexLayout& layout,
+                                     PositionDequantization& dequantization) {
+    dequantization = PositionDequantization();
+    if (layout.position != PositionEncoding::Float32 && !vertices.empty()) {
+        // map the bounding box onto [-1, 1] on every axis, keeps half floats in their precise range too
+        glm::vec3 lower = vertices[0].pos, upper = vertices[0].pos;
+        for (const auto& vertex : vertices) {
+            for (int c = 0; c < 3; ++c) {
+                lower[c] = std::min(lower[c], vertex.pos[c]);
+                upper[c] = std::max(upper[c], vertex.pos[c]);
+            }
+        }
+        for (int c = 0; c < 3; ++c) {
+            dequantization.bias[c] = (lower[c] + upper[c]) * 0.5f;
+            dequantization.scale[c] = std::max((upper[c] - lower[c]) * 0.5f, 1e-20f);
+        }
+        dequantization.bias.w = 0.0f;
+        dequantization.scale.w = 1.0f;
+    }
+
+    uint32_t stride = vertex_stride(layout);
+    std::vector<uint8_t> data(vertices.size() * stride);
+    uint8_t* out = data.data();
+    auto write = [&](const void* value, size_t size) {
+        std::memcpy(out, value, size);
+        out += size;
+    };
+
+    for (const auto& vertex : vertices) {
+        glm::vec3 p;
+        for (int c = 0; c < 3; ++c) {
+            p[c] = (vertex.pos[c] - dequantization.bias[c]) / dequantization.scale[c];
+        }
+        if (layout.position == PositionEncoding::Float32) {
+            write(&p.x, sizeof(float) * 3);
+        } else {
+            uint16_t packed[4];
+            for (int c = 0; c < 3; ++c) {
+                packed[c] = layout.position == PositionEncoding::Float16 ? glm::packHalf1x16(p[c]) : glm::packSnorm1x16(p[c]);
+            }
+            // w is ignored by the shader
+            packed[3] = 0;
+            write(packed, sizeof(packed));
+        }
+
+        if (layout.normal == NormalEncoding::Float32) {
+            write(&vertex.normal.x, sizeof(float) * 3);
+        } else {
+            uint32_t packed = glm::packSnorm2x16(octahedral_encode(vertex.normal));
+            write(&packed, sizeof(packed));
+        }
+
+        if (layout.texCoord == TexCoordEncoding::Float32) {
+            write(&vertex.texCoord.x, sizeof(float) * 2);
+        } else {
+            uint32_t packed = layout.texCoord == TexCoordEncoding::Float16 ? glm::packHalf2x16(vertex.texCoord)
+                                                                           : glm::packUnorm2x16(vertex.texCoord);
+            write(&packed, sizeof(packed));
+        }
+
+        if (layout.color == ColorEncoding::Float32) {
+            write(&vertex.color.x, sizeof(float) * 3);
+        } else {
+            uint32_t packed = glm::packUnorm4x8(glm::vec4(vertex.color, 1.0f));
+            write(&packed, sizeof(packed));
+        }
+    }
+    return data;
+}
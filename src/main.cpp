@@ -1,10 +1,13 @@
 #include <iostream>
 
 #include "../engine/headers/App.h"
+#include "../engine/headers/Config.h"
 
-int main() {
-    App app;
-    try { app.run(); } catch (const std::exception& e){
+int main(int argc, char** argv) {
+    try {
+        App app(parse_args(argc, argv));
+        app.run();
+    } catch (const std::exception& e){
         std::cerr << e.what() << std::endl;
         return EXIT_FAILURE;
     }
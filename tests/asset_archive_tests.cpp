@@ -0,0 +1,172 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../engine/headers/AssetArchive.h"
+
+// Opens archives laid out like asset_packer writes them and checks lookups, hashes and that
+// malformed tables of contents are rejected.
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+struct Asset {
+    std::string name;
+    std::string contents;
+};
+
+static std::vector<uint8_t> build_archive(const std::vector<Asset>& assets) {
+    std::vector<ArchiveEntry> entries(assets.size());
+    std::string nameTable;
+    for (size_t i = 0; i < assets.size(); ++i) {
+        entries[i].nameOffset = nameTable.size();
+        entries[i].nameLength = assets[i].name.size();
+        entries[i].size = assets[i].contents.size();
+        entries[i].hash = asset_hash(reinterpret_cast<const uint8_t*>(assets[i].contents.data()), assets[i].contents.size());
+        nameTable += assets[i].name;
+    }
+
+    ArchiveHeader header = {};
+    memcpy(header.magic, ASSET_ARCHIVE_MAGIC, sizeof(header.magic));
+    header.version = ASSET_ARCHIVE_VERSION;
+    header.entryCount = entries.size();
+    header.nameTableSize = nameTable.size();
+
+    uint64_t offset = sizeof(header) + sizeof(ArchiveEntry) * entries.size() + nameTable.size();
+    for (auto& entry : entries) {
+        offset = (offset + ASSET_ARCHIVE_ALIGNMENT - 1) / ASSET_ARCHIVE_ALIGNMENT * ASSET_ARCHIVE_ALIGNMENT;
+        entry.offset = offset;
+        offset += entry.size;
+    }
+
+    std::vector<uint8_t> bytes(offset);
+    memcpy(bytes.data(), &header, sizeof(header));
+    memcpy(bytes.data() + sizeof(header), entries.data(), sizeof(ArchiveEntry) * entries.size());
+    memcpy(bytes.data() + sizeof(header) + sizeof(ArchiveEntry) * entries.size(), nameTable.data(), nameTable.size());
+    for (size_t i = 0; i < assets.size(); ++i) {
+        memcpy(bytes.data() + entries[i].offset, assets[i].contents.data(), assets[i].contents.size());
+    }
+    return bytes;
+}
+
+static void write_file(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+static bool open_fails(const std::string& path, const std::vector<uint8_t>& bytes) {
+    write_file(path, bytes);
+    AssetArchive archive;
+    try {
+        archive.open(path);
+    } catch (const std::runtime_error&) {
+        return !archive.is_open();
+    }
+    return false;
+}
+
+static void test_hash() {
+    // FNV-1a 64 reference values
+    check(asset_hash(nullptr, 0) == 0xcbf29ce484222325ull, "hash of nothing");
+    check(asset_hash(reinterpret_cast<const uint8_t*>("a"), 1) == 0xaf63dc4c8601ec8cull, "hash of \"a\"");
+    check(asset_hash(reinterpret_cast<const uint8_t*>("foobar"), 6) == 0x85944171f73967e8ull, "hash of \"foobar\"");
+}
+
+static void test_lookup(const std::string& path) {
+    std::vector<Asset> assets = {
+            {"shader.vert.spv", std::string("\x03\x02\x23\x07 vertex words", 17)},
+            {"mango.mtex", std::string(1000, 'm')},
+            {"empty", ""},
+    };
+    write_file(path, build_archive(assets));
+
+    AssetArchive archive;
+    archive.open(path);
+    check(archive.is_open(), "archive opens");
+    check(archive.names().size() == assets.size(), "entry count");
+    for (const auto& asset : assets) {
+        check(archive.contains(asset.name), asset.name + " is listed");
+        if (!archive.contains(asset.name)) continue;
+        AssetView view = archive.view(asset.name, true);
+        check(view.size == asset.contents.size() && memcmp(view.data, asset.contents.data(), view.size) == 0,
+              asset.name + " contents");
+        check(view.size == 0 || reinterpret_cast<uintptr_t>(view.data) % ASSET_ARCHIVE_ALIGNMENT == 0,
+              asset.name + " alignment");
+    }
+    check(!archive.contains("missing"), "unknown names are not listed");
+    try {
+        archive.view("missing");
+        check(false, "view of an unknown name did not throw");
+    } catch (const std::runtime_error&) {
+    }
+
+    archive.close();
+    check(!archive.is_open() && !archive.contains("mango.mtex"), "close forgets the entries");
+}
+
+static void test_corruption(const std::string& path) {
+    std::vector<uint8_t> bytes = build_archive({{"a", "first payload"}, {"b", "second payload"}});
+    ArchiveEntry second;
+    memcpy(&second, bytes.data() + sizeof(ArchiveHeader) + sizeof(ArchiveEntry), sizeof(second));
+
+    std::vector<uint8_t> flipped = bytes;
+    flipped[second.offset] ^= 1;
+    write_file(path, flipped);
+    AssetArchive archive;
+    archive.open(path);
+    check(archive.view("b").size == second.size, "unverified view of a corrupt payload");
+    try {
+        archive.view("b", true);
+        check(false, "verified view of a corrupt payload did not throw");
+    } catch (const std::runtime_error&) {
+    }
+    archive.close();
+
+    check(open_fails(path, std::vector<uint8_t>(bytes.begin(), bytes.begin() + 8)), "short header");
+
+    std::vector<uint8_t> badMagic = bytes;
+    badMagic[0] = 'X';
+    check(open_fails(path, badMagic), "bad magic");
+
+    std::vector<uint8_t> badVersion = bytes;
+    badVersion[4] = ASSET_ARCHIVE_VERSION + 1;
+    check(open_fails(path, badVersion), "unknown version");
+
+    // the entry table claims more entries than the file holds
+    std::vector<uint8_t> manyEntries = bytes;
+    uint32_t entryCount = 1000;
+    memcpy(&manyEntries[offsetof(ArchiveHeader, entryCount)], &entryCount, sizeof(entryCount));
+    check(open_fails(path, manyEntries), "truncated table of contents");
+
+    check(open_fails(path, std::vector<uint8_t>(bytes.begin(), bytes.begin() + second.offset + 1)), "truncated payload");
+
+    std::vector<uint8_t> badName = bytes;
+    uint32_t nameLength = 100;
+    memcpy(&badName[sizeof(ArchiveHeader) + offsetof(ArchiveEntry, nameLength)], &nameLength, sizeof(nameLength));
+    check(open_fails(path, badName), "name out of bounds");
+}
+
+int main() {
+    std::string path = "asset_archive_tests.mpak";
+    test_hash();
+    test_lookup(path);
+    test_corruption(path);
+    std::remove(path.c_str());
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "asset archive tests passed\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../engine/headers/Mesh.h"
+
+// Parses small OBJ and glTF files built in memory and checks the vertex cache and fetch
+// optimizations keep every triangle while reordering them. CPU only, no device needed.
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+static void check_throws(const std::function<void()>& function, const std::string& what) {
+    try {
+        function();
+    } catch (const std::runtime_error&) {
+        return;
+    }
+    check(false, what + " did not throw");
+}
+
+static bool near(const glm::vec3& a, const glm::vec3& b) {
+    return std::fabs(a.x - b.x) < 1e-5f && std::fabs(a.y - b.y) < 1e-5f && std::fabs(a.z - b.z) < 1e-5f;
+}
+
+static bool near(const glm::vec2& a, const glm::vec2& b) {
+    return std::fabs(a.x - b.x) < 1e-5f && std::fabs(a.y - b.y) < 1e-5f;
+}
+
+static Mesh obj(const std::string& text) {
+    return parse_obj(text.data(), text.size(), "test.obj");
+}
+
+// triangles as position triples, sorted, so reorderings of triangles and vertices compare equal
+static std::vector<std::array<float, 9>> triangle_set(const Mesh& mesh) {
+    std::vector<std::array<float, 9>> triangles;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        std::array<float, 9> triangle;
+        for (int corner = 0; corner < 3; ++corner) {
+            const glm::vec3& p = mesh.vertices[mesh.indices[i + corner]].pos;
+            triangle[corner * 3] = p.x;
+            triangle[corner * 3 + 1] = p.y;
+            triangle[corner * 3 + 2] = p.z;
+        }
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+static void test_obj() {
+    Mesh quad = obj("# quad in the Y-up xz plane\n"
+                    "v 0 0 0\nv 1 0 0\nv 1 0 -1\nv 0 0 -1\n"
+                    "vt 0 0\nvt 1 0\nvt 1 1\nvt 0.25 0.75\n"
+                    "vn 0 1 0\n"
+                    "f 1/1/1 2/2/1 3/3/1 4/4/1\n");
+    check(quad.vertices.size() == 4 && quad.indices.size() == 6, "quad is fanned into two triangles");
+    if (quad.indices.size() == 6) {
+        check(quad.indices == std::vector<uint32_t>({0, 1, 2, 0, 2, 3}), "fan order");
+    }
+    if (quad.vertices.size() == 4) {
+        check(near(quad.vertices[2].pos, glm::vec3(1.0f, 1.0f, 0.0f)), "positions are converted to Z-up");
+        check(near(quad.vertices[0].normal, glm::vec3(0.0f, 0.0f, 1.0f)), "normals are converted to Z-up");
+        check(near(quad.vertices[3].texCoord, glm::vec2(0.25f, 0.25f)), "texture coordinates are flipped vertically");
+        check(near(quad.vertices[0].color, glm::vec3(1.0f)), "vertices without color are white");
+    }
+
+    Mesh relative = obj("v 0 0 0 1 0 0\nv 1 0 0\nv 0 1 0\r\nf -3 -2 -1\r\n");
+    check(relative.indices.size() == 3, "negative indices");
+    if (relative.vertices.size() == 3) {
+        check(near(relative.vertices[0].color, glm::vec3(1.0f, 0.0f, 0.0f)), "vertex color extension");
+        check(near(relative.vertices[2].pos, glm::vec3(0.0f, 0.0f, 1.0f)), "negative index resolves from the end");
+        check(near(relative.vertices[0].normal, glm::vec3(0.0f)), "missing normals stay zero");
+    }
+
+    check_throws([] { obj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n"); }, "face index out of range");
+    check_throws([] { obj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1/2 2/2 3/2\n"); }, "texture coordinate out of range");
+    check_throws([] { obj("v 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n"); }, "vertex with two coordinates");
+    check_throws([] { obj("v 0 0 0\nv 1 0 0\nv 0 1 0\n"); }, "file without faces");
+}
+
+// glTF
+
+static std::string base64(const std::vector<uint8_t>& data) {
+    const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string result;
+    for (size_t i = 0; i < data.size(); i += 3) {
+        uint32_t group = data[i] << 16;
+        if (i + 1 < data.size()) group |= data[i + 1] << 8;
+        if (i + 2 < data.size()) group |= data[i + 2];
+        for (size_t c = 0; c < 4; ++c) {
+            result += c <= data.size() - i ? alphabet[(group >> (18 - 6 * c)) & 63] : '=';
+        }
+    }
+    return result;
+}
+
+// one triangle: three float positions followed by three 16 bit indices
+static std::vector<uint8_t> triangle_buffer(uint16_t lastIndex) {
+    const float positions[9] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    const uint16_t indices[3] = {0, 1, lastIndex};
+    std::vector<uint8_t> buffer(sizeof(positions) + sizeof(indices));
+    memcpy(buffer.data(), positions, sizeof(positions));
+    memcpy(buffer.data() + sizeof(positions), indices, sizeof(indices));
+    return buffer;
+}
+
+static std::string gltf_json(const std::string& bufferUri, size_t bufferSize) {
+    std::string uri = bufferUri.empty() ? "" : "\"uri\": \"" + bufferUri + "\", ";
+    return "{\"asset\": {\"version\": \"2.0\"},\n"
+           " \"buffers\": [{" + uri + "\"byteLength\": " + std::to_string(bufferSize) + "}],\n"
+           " \"bufferViews\": [{\"buffer\": 0, \"byteOffset\": 0, \"byteLength\": 36},\n"
+           "                 {\"buffer\": 0, \"byteOffset\": 36, \"byteLength\": 6}],\n"
+           " \"accessors\": [{\"bufferView\": 0, \"componentType\": 5126, \"count\": 3, \"type\": \"VEC3\"},\n"
+           "               {\"bufferView\": 1, \"componentType\": 5123, \"count\": 3, \"type\": \"SCALAR\"}],\n"
+           " \"meshes\": [{\"primitives\": [{\"attributes\": {\"POSITION\": 0}, \"indices\": 1}]}],\n"
+           " \"nodes\": [{\"children\": [1], \"translation\": [0, 0, 5]}, {\"mesh\": 0, \"scale\": [2, 2, 2]}],\n"
+           " \"scenes\": [{\"nodes\": [0]}]}";
+}
+
+static Mesh gltf(const std::string& json, const MeshResourceLoader& loadResource = nullptr) {
+    return parse_gltf(reinterpret_cast<const uint8_t*>(json.data()), json.size(), "test.gltf", loadResource);
+}
+
+static std::vector<uint8_t> glb(std::string json, const std::vector<uint8_t>& binary, uint32_t version = 2) {
+    // chunks are 4 byte aligned, JSON is padded with spaces and binary data with zeros
+    json.resize((json.size() + 3) & ~size_t(3), ' ');
+    std::vector<uint8_t> paddedBinary = binary;
+    paddedBinary.resize((binary.size() + 3) & ~size_t(3), 0);
+
+    const uint32_t header[3] = {0x46546c67, version,
+                                static_cast<uint32_t>(12 + 8 + json.size() + 8 + paddedBinary.size())};
+    const uint32_t jsonChunk[2] = {static_cast<uint32_t>(json.size()), 0x4e4f534a};
+    const uint32_t binaryChunk[2] = {static_cast<uint32_t>(paddedBinary.size()), 0x004e4942};
+
+    std::vector<uint8_t> bytes(header[2]);
+    uint8_t* cursor = bytes.data();
+    memcpy(cursor, header, sizeof(header));
+    cursor += sizeof(header);
+    memcpy(cursor, jsonChunk, sizeof(jsonChunk));
+    cursor += sizeof(jsonChunk);
+    memcpy(cursor, json.data(), json.size());
+    cursor += json.size();
+    memcpy(cursor, binaryChunk, sizeof(binaryChunk));
+    cursor += sizeof(binaryChunk);
+    memcpy(cursor, paddedBinary.data(), paddedBinary.size());
+    return bytes;
+}
+
+// the node hierarchy scales by 2 and then moves 5 along Y-up z, which is -5 along Z-up y
+static void check_transformed_triangle(const Mesh& mesh, const std::string& what) {
+    check(mesh.vertices.size() == 3 && mesh.indices == std::vector<uint32_t>({0, 1, 2}), what + " triangle");
+    if (mesh.vertices.size() != 3) return;
+    check(near(mesh.vertices[0].pos, glm::vec3(0.0f, -5.0f, 0.0f))
+          && near(mesh.vertices[1].pos, glm::vec3(2.0f, -5.0f, 0.0f))
+          && near(mesh.vertices[2].pos, glm::vec3(0.0f, -5.0f, 2.0f)), what + " node transforms");
+}
+
+static void test_gltf() {
+    std::vector<uint8_t> buffer = triangle_buffer(2);
+    check_transformed_triangle(gltf(gltf_json("data:application/octet-stream;base64," + base64(buffer), buffer.size())),
+                               "embedded buffer");
+
+    std::string requested;
+    Mesh external = gltf(gltf_json("triangle.bin", buffer.size()), [&](const std::string& uri) {
+        requested = uri;
+        return buffer;
+    });
+    check(requested == "triangle.bin", "external buffers go through the loader");
+    check_transformed_triangle(external, "external buffer");
+
+    std::vector<uint8_t> binary = glb(gltf_json("", buffer.size()), buffer);
+    check_transformed_triangle(parse_gltf(binary.data(), binary.size(), "test.glb", nullptr), "GLB");
+
+    std::vector<uint8_t> badIndex = triangle_buffer(3);
+    check_throws([&] { gltf(gltf_json("data:application/octet-stream;base64," + base64(badIndex), badIndex.size())); },
+                 "index out of range");
+    check_throws([&] { gltf(gltf_json("data:application/octet-stream;base64," + base64(buffer), buffer.size() + 4)); },
+                 "buffer shorter than its byteLength");
+    check_throws([&] { gltf(gltf_json("", buffer.size())); }, "buffer without uri outside a GLB");
+    check_throws([] { gltf("{\"meshes\": [}"); }, "invalid JSON");
+    check_throws([] { gltf("{\"asset\": {\"version\": \"2.0\"}}"); }, "file without triangles");
+
+    std::vector<uint8_t> oldVersion = glb(gltf_json("", buffer.size()), buffer, 1);
+    check_throws([&] { parse_gltf(oldVersion.data(), oldVersion.size(), "test.glb", nullptr); }, "GLB version 1");
+    std::vector<uint8_t> truncated(binary.begin(), binary.end() - 8);
+    check_throws([&] { parse_gltf(truncated.data(), truncated.size(), "test.glb", nullptr); }, "truncated GLB chunk");
+}
+
+// processing
+
+// quads of a size x size grid, two triangles each, shuffled so the input order has no locality
+static Mesh shuffled_grid(uint32_t size) {
+    Mesh mesh;
+    for (uint32_t y = 0; y <= size; ++y) {
+        for (uint32_t x = 0; x <= size; ++x) {
+            Vertex vertex = {};
+            vertex.pos = glm::vec3(static_cast<float>(x), static_cast<float>(y), 0.0f);
+            mesh.vertices.push_back(vertex);
+        }
+    }
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            uint32_t corner = y * (size + 1) + x;
+            triangles.push_back({corner, corner + 1, corner + size + 2});
+            triangles.push_back({corner, corner + size + 2, corner + size + 1});
+        }
+    }
+    uint32_t state = 12345;
+    for (size_t i = triangles.size() - 1; i > 0; --i) {
+        state = state * 1664525u + 1013904223u;
+        std::swap(triangles[i], triangles[state % (i + 1)]);
+    }
+    for (const auto& triangle : triangles) {
+        mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+    }
+    return mesh;
+}
+
+static void test_vertex_cache() {
+    Mesh mesh = shuffled_grid(32);
+    auto vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    std::vector<std::array<float, 9>> before = triangle_set(mesh);
+    VertexCacheStats shuffled = analyze_vertex_cache(mesh.indices, vertexCount);
+
+    optimize_vertex_cache(mesh);
+    VertexCacheStats optimized = analyze_vertex_cache(mesh.indices, vertexCount);
+    check(triangle_set(mesh) == before, "cache optimization keeps every triangle");
+    check(shuffled.acmr > 2.0f, "shuffled grid has no reuse");
+    // a regular grid approaches 0.5, a row by row walk with a 16 entry FIFO stays near 1
+    check(optimized.acmr < 0.85f, "cache optimization reaches a low ACMR, got " + std::to_string(optimized.acmr));
+    check(optimized.atvr < 1.6f, "cache optimization reaches a low ATVR, got " + std::to_string(optimized.atvr));
+
+    // every triangle is shared by none of the others, order must still be complete
+    Mesh soup = obj("v 0 0 0\nv 1 0 0\nv 0 1 0\nv 5 0 0\nv 6 0 0\nv 5 1 0\nf 1 2 3\nf 4 5 6\n");
+    std::vector<std::array<float, 9>> soupBefore = triangle_set(soup);
+    optimize_vertex_cache(soup);
+    check(triangle_set(soup) == soupBefore, "cache optimization of disconnected triangles");
+
+    std::vector<uint32_t> indices = {0, 1, 2, 2, 1, 3};
+    VertexCacheStats quad = analyze_vertex_cache(indices, 4);
+    check(quad.acmr == 2.0f && quad.atvr == 1.0f, "cache statistics of a quad");
+}
+
+static void test_vertex_processing() {
+    // two separate faces emit six corners of which four are distinct
+    Mesh mesh = obj("v 0 0 0\nv 1 0 0\nv 1 0 -1\nv 0 0 -1\nv 9 9 9\nf 1 2 3\nf 1 3 4\n");
+    std::vector<std::array<float, 9>> before = triangle_set(mesh);
+    deduplicate_vertices(mesh);
+    check(mesh.vertices.size() == 4 && triangle_set(mesh) == before, "deduplication merges shared corners");
+
+    // reversed so fetch optimization has to renumber, vertex 4 is unused
+    Mesh reversed;
+    for (int i = 4; i >= 0; --i) {
+        Vertex vertex = {};
+        vertex.pos = glm::vec3(static_cast<float>(i), static_cast<float>(i * i), 0.0f);
+        reversed.vertices.push_back(vertex);
+    }
+    reversed.indices = {3, 2, 1, 3, 1, 0};
+    before = triangle_set(reversed);
+    optimize_vertex_fetch(reversed);
+    check(reversed.indices == std::vector<uint32_t>({0, 1, 2, 0, 2, 3}), "fetch optimization numbers by first use");
+    check(reversed.vertices.size() == 4 && triangle_set(reversed) == before, "fetch optimization drops unused vertices");
+
+    generate_normals(mesh);
+    bool up = true;
+    for (const auto& vertex : mesh.vertices) up = up && near(vertex.normal, glm::vec3(0.0f, 0.0f, 1.0f));
+    check(up, "generated normals of a counter clockwise quad point up");
+
+    fit_unit_cube(mesh);
+    glm::vec3 lower(1e9f), upper(-1e9f);
+    for (const auto& vertex : mesh.vertices) {
+        for (int c = 0; c < 3; ++c) {
+            lower[c] = std::min(lower[c], vertex.pos[c]);
+            upper[c] = std::max(upper[c], vertex.pos[c]);
+        }
+    }
+    check(near(lower, glm::vec3(-0.5f, -0.5f, 0.0f)) && near(upper, glm::vec3(0.5f, 0.5f, 0.0f)), "fit to unit cube");
+
+    check(choose_index_type(65536) == VK_INDEX_TYPE_UINT16 && choose_index_type(65537) == VK_INDEX_TYPE_UINT32,
+          "index type limit");
+    std::vector<uint8_t> packed = pack_indices({1, 0x1234}, VK_INDEX_TYPE_UINT16);
+    check(packed == std::vector<uint8_t>({1, 0, 0x34, 0x12}), "16 bit index packing");
+    check(pack_indices({1, 0x1234}, VK_INDEX_TYPE_UINT32).size() == 8, "32 bit index packing");
+}
+
+int main() {
+    test_obj();
+    test_gltf();
+    test_vertex_cache();
+    test_vertex_processing();
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "mesh tests passed\n";
+    return EXIT_SUCCESS;
+}
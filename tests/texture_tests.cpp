@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../engine/headers/BlockCompression.h"
+#include "../engine/headers/MipChain.h"
+#include "../engine/headers/TextureFile.h"
+
+// Checks the block encoders against reference decoders written from the format specs, and the
+// .mtex reader against files written by write_texture_file. CPU only, no device needed.
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+static void check_throws(const std::function<void()>& function, const std::string& what) {
+    try {
+        function();
+    } catch (const std::runtime_error&) {
+        return;
+    }
+    check(false, what + " did not throw");
+}
+
+// decoders, one 4x4 block into 16 RGBA texels in row order
+
+static void decode_bc1_block(const uint8_t* block, uint8_t texels[16][4]) {
+    uint16_t color0 = block[0] | (block[1] << 8);
+    uint16_t color1 = block[2] | (block[3] << 8);
+    uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (uint32_t(block[7]) << 24);
+
+    int32_t palette[4][3];
+    for (uint32_t e = 0; e < 2; ++e) {
+        uint16_t packed = e == 0 ? color0 : color1;
+        int32_t r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        palette[e][0] = (r << 3) | (r >> 2);
+        palette[e][1] = (g << 2) | (g >> 4);
+        palette[e][2] = (b << 3) | (b >> 2);
+    }
+    for (uint32_t c = 0; c < 3; ++c) {
+        if (color0 > color1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    for (uint32_t i = 0; i < 16; ++i) {
+        uint32_t index = (indices >> (2 * i)) & 3;
+        for (uint32_t c = 0; c < 3; ++c) texels[i][c] = palette[index][c];
+        texels[i][3] = 255;
+    }
+}
+
+static uint32_t read_bits(const uint8_t* block, uint32_t& position, uint32_t bits) {
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < bits; ++i, ++position) {
+        value |= ((block[position / 8] >> (position % 8)) & 1) << i;
+    }
+    return value;
+}
+
+// mode 6 only, the one the encoder writes
+static bool decode_bc7_block(const uint8_t* block, uint8_t texels[16][4]) {
+    const int32_t weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+    uint32_t position = 0;
+    if (read_bits(block, position, 7) != 1 << 6) return false;
+
+    int32_t endpoints[2][4];
+    for (uint32_t c = 0; c < 4; ++c) {
+        endpoints[0][c] = read_bits(block, position, 7);
+        endpoints[1][c] = read_bits(block, position, 7);
+    }
+    uint32_t pBits[2] = {read_bits(block, position, 1), read_bits(block, position, 1)};
+    for (uint32_t e = 0; e < 2; ++e) {
+        for (uint32_t c = 0; c < 4; ++c) endpoints[e][c] = (endpoints[e][c] << 1) | pBits[e];
+    }
+    for (uint32_t i = 0; i < 16; ++i) {
+        uint32_t index = read_bits(block, position, i == 0 ? 3 : 4);
+        for (uint32_t c = 0; c < 4; ++c) {
+            texels[i][c] = ((64 - weights[index]) * endpoints[0][c] + weights[index] * endpoints[1][c] + 32) >> 6;
+        }
+    }
+    return true;
+}
+
+// individual and differential modes (ETC1), as written by the encoder
+static void decode_etc1_block(const uint8_t* block, uint8_t texels[16][4]) {
+    const int32_t modifiers[8][2] = {{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+    uint64_t bits = 0;
+    for (uint32_t i = 0; i < 8; ++i) bits = (bits << 8) | block[i];
+
+    bool flip = (bits >> 32) & 1;
+    bool differential = (bits >> 33) & 1;
+    uint32_t tables[2] = {uint32_t(bits >> 37) & 7, uint32_t(bits >> 34) & 7};
+
+    int32_t bases[2][3];
+    for (uint32_t c = 0; c < 3; ++c) {
+        uint32_t byte = (bits >> (56 - 8 * c)) & 0xff;
+        if (differential) {
+            int32_t first = byte >> 3;
+            int32_t delta = byte & 7;
+            if (delta >= 4) delta -= 8;
+            int32_t second = first + delta;
+            bases[0][c] = (first << 3) | (first >> 2);
+            bases[1][c] = (second << 3) | (second >> 2);
+        } else {
+            bases[0][c] = (byte >> 4) * 17;
+            bases[1][c] = (byte & 15) * 17;
+        }
+    }
+
+    for (uint32_t i = 0; i < 16; ++i) {
+        uint32_t x = i % 4, y = i / 4;
+        uint32_t subblock = flip ? y / 2 : x / 2;
+        uint32_t bit = x * 4 + y;
+        uint32_t msb = (bits >> (16 + bit)) & 1;
+        uint32_t lsb = (bits >> bit) & 1;
+        int32_t modifier = modifiers[tables[subblock]][lsb];
+        if (msb) modifier = -modifier;
+        for (uint32_t c = 0; c < 3; ++c) texels[i][c] = std::clamp(bases[subblock][c] + modifier, 0, 255);
+        texels[i][3] = 255;
+    }
+}
+
+struct Image {
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> rgba;
+};
+
+static Image solid_image(uint32_t width, uint32_t height, const uint8_t color[4]) {
+    Image image = {width, height, std::vector<uint8_t>(size_t(width) * height * 4)};
+    for (size_t i = 0; i < size_t(width) * height; ++i) memcpy(&image.rgba[i * 4], color, 4);
+    return image;
+}
+
+// smooth gradients, what block compression is meant for
+static Image gradient_image(uint32_t width, uint32_t height) {
+    Image image = {width, height, std::vector<uint8_t>(size_t(width) * height * 4)};
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            uint8_t* texel = &image.rgba[(size_t(y) * width + x) * 4];
+            texel[0] = x * 255 / (width - 1);
+            texel[1] = y * 255 / (height - 1);
+            texel[2] = 255 - (x + y) * 255 / (width + height - 2);
+            texel[3] = 255;
+        }
+    }
+    return image;
+}
+
+// the image grown to whole blocks by repeating the last row and column
+static Image pad_to_blocks(const Image& image) {
+    Image padded = {(image.width + 3) / 4 * 4, (image.height + 3) / 4 * 4, {}};
+    padded.rgba.resize(size_t(padded.width) * padded.height * 4);
+    for (uint32_t y = 0; y < padded.height; ++y) {
+        for (uint32_t x = 0; x < padded.width; ++x) {
+            uint32_t srcX = std::min(x, image.width - 1), srcY = std::min(y, image.height - 1);
+            memcpy(&padded.rgba[(size_t(y) * padded.width + x) * 4], &image.rgba[(size_t(srcY) * image.width + srcX) * 4], 4);
+        }
+    }
+    return padded;
+}
+
+using Encoder = std::vector<uint8_t> (*)(const uint8_t*, uint32_t, uint32_t);
+
+static bool partial_blocks_match(Encoder encoder, uint32_t width, uint32_t height) {
+    Image image = gradient_image(width, height);
+    Image padded = pad_to_blocks(image);
+    return encoder(image.rgba.data(), width, height) == encoder(padded.rgba.data(), padded.width, padded.height);
+}
+
+// decodes every block and returns the largest per channel difference against the image
+template<typename Decoder>
+static int32_t max_error(const Image& image, const std::vector<uint8_t>& encoded, uint32_t blockBytes,
+                         uint32_t channels, Decoder decoder) {
+    uint32_t blocksX = (image.width + 3) / 4;
+    uint32_t blocksY = (image.height + 3) / 4;
+    if (encoded.size() != size_t(blocksX) * blocksY * blockBytes) return 256;
+
+    int32_t error = 0;
+    for (uint32_t blockY = 0; blockY < blocksY; ++blockY) {
+        for (uint32_t blockX = 0; blockX < blocksX; ++blockX) {
+            uint8_t texels[16][4];
+            decoder(&encoded[(size_t(blockY) * blocksX + blockX) * blockBytes], texels);
+            for (uint32_t i = 0; i < 16; ++i) {
+                uint32_t x = blockX * 4 + i % 4, y = blockY * 4 + i / 4;
+                if (x >= image.width || y >= image.height) continue;
+                const uint8_t* texel = &image.rgba[(size_t(y) * image.width + x) * 4];
+                for (uint32_t c = 0; c < channels; ++c) {
+                    error = std::max(error, std::abs(int32_t(texels[i][c]) - int32_t(texel[c])));
+                }
+            }
+        }
+    }
+    return error;
+}
+
+static void test_bc1() {
+    const uint8_t white[4] = {255, 255, 255, 255};
+    std::vector<uint8_t> block = encode_bc1(solid_image(4, 4, white).rgba.data(), 4, 4);
+    const uint8_t expected[8] = {0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0};
+    check(block.size() == 8 && memcmp(block.data(), expected, 8) == 0, "bc1 white block");
+
+    const uint8_t colors[][4] = {{0, 0, 0, 255}, {255, 0, 0, 255}, {40, 120, 200, 255}, {3, 250, 77, 255}};
+    for (const auto& color : colors) {
+        Image image = solid_image(8, 8, color);
+        // one 5:6:5 step
+        check(max_error(image, encode_bc1(image.rgba.data(), 8, 8), 8, 3, decode_bc1_block) <= 4, "bc1 solid color");
+    }
+
+    Image gradient = gradient_image(64, 64);
+    check(max_error(gradient, encode_bc1(gradient.rgba.data(), 64, 64), 8, 3, decode_bc1_block) <= 16, "bc1 gradient");
+    check(partial_blocks_match(encode_bc1, 13, 7), "bc1 partial blocks");
+}
+
+static void test_bc7() {
+    auto decoder = [](const uint8_t* block, uint8_t texels[16][4]) {
+        if (!decode_bc7_block(block, texels)) memset(texels, 0, 16 * 4);
+    };
+
+    const uint8_t colors[][4] = {{0, 0, 0, 0}, {255, 255, 255, 255}, {40, 120, 200, 128}, {3, 250, 77, 255}};
+    for (const auto& color : colors) {
+        Image image = solid_image(8, 8, color);
+        check(max_error(image, encode_bc7(image.rgba.data(), 8, 8), 16, 4, decoder) <= 1, "bc7 solid color");
+    }
+
+    Image gradient = gradient_image(64, 64);
+    check(max_error(gradient, encode_bc7(gradient.rgba.data(), 64, 64), 16, 4, decoder) <= 12, "bc7 gradient");
+    check(partial_blocks_match(encode_bc7, 5, 9), "bc7 partial blocks");
+}
+
+static void test_etc2() {
+    const uint8_t colors[][4] = {{0, 0, 0, 255}, {255, 255, 255, 255}, {40, 120, 200, 255}, {3, 250, 77, 255}};
+    for (const auto& color : colors) {
+        Image image = solid_image(8, 8, color);
+        // 4 or 5 bit base colors, the modifiers close most of the gap
+        check(max_error(image, encode_etc2_rgb(image.rgba.data(), 8, 8), 8, 3, decode_etc1_block) <= 6, "etc2 solid color");
+    }
+
+    // two flat halves far apart only fit the individual mode
+    Image split = solid_image(4, 4, colors[0]);
+    for (uint32_t y = 0; y < 4; ++y) {
+        for (uint32_t x = 2; x < 4; ++x) memcpy(&split.rgba[(y * 4 + x) * 4], colors[1], 4);
+    }
+    std::vector<uint8_t> block = encode_etc2_rgb(split.rgba.data(), 4, 4);
+    check(((block[3] >> 1) & 1) == 0, "etc2 individual mode for distant subblocks");
+    check(max_error(split, block, 8, 3, decode_etc1_block) <= 6, "etc2 split block");
+
+    Image gradient = gradient_image(64, 64);
+    check(max_error(gradient, encode_etc2_rgb(gradient.rgba.data(), 64, 64), 8, 3, decode_etc1_block) <= 16, "etc2 gradient");
+    check(partial_blocks_match(encode_etc2_rgb, 6, 3), "etc2 partial blocks");
+}
+
+static TextureFile cooked_texture(uint32_t width, uint32_t height) {
+    Image image = gradient_image(width, height);
+    TextureFile texture;
+    texture.width = width;
+    texture.height = height;
+    texture.mipLevels = mip_level_count(width, height);
+
+    std::vector<ImageLevel> levels;
+    std::vector<uint8_t> chain = build_mip_chain_rgba8(image.rgba.data(), width, height, true, levels);
+    TextureVariant bc1;
+    bc1.format = VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+    for (const auto& level : levels) {
+        std::vector<uint8_t> encoded = encode_bc1(chain.data() + level.offset, level.width, level.height);
+        bc1.data.insert(bc1.data.end(), encoded.begin(), encoded.end());
+    }
+    TextureVariant rgba8;
+    rgba8.format = VK_FORMAT_R8G8B8A8_SRGB;
+    rgba8.data = chain;
+    for (TextureVariant* variant : {&bc1, &rgba8}) {
+        variant->size = texture_level_layout(variant->format, width, height, texture.mipLevels, variant->levels);
+        variant->payload = variant->data.data();
+        texture.variants.push_back(std::move(*variant));
+    }
+    return texture;
+}
+
+static void test_texture_file() {
+    TextureFile texture = cooked_texture(20, 12);
+    for (const auto& variant : texture.variants) {
+        check(variant.size == variant.data.size(), std::string("level layout of ") + texture_format_name(variant.format));
+    }
+
+    std::string path = "texture_tests.mtex";
+    write_texture_file(path, texture);
+    TextureFile read = read_texture_file(path);
+    std::remove(path.c_str());
+
+    check(read.width == 20 && read.height == 12 && read.mipLevels == 5, "header round trip");
+    check(read.variants.size() == 2, "variant count round trip");
+    for (size_t i = 0; i < std::min(read.variants.size(), texture.variants.size()); ++i) {
+        const TextureVariant& expected = texture.variants[i];
+        const TextureVariant& actual = read.variants[i];
+        std::string name = texture_format_name(expected.format);
+        check(actual.format == expected.format, name + " format round trip");
+        check(actual.size == expected.size && memcmp(actual.payload, expected.payload, expected.size) == 0,
+              name + " payload round trip");
+        check(actual.levels.size() == expected.levels.size(), name + " level count");
+        check((actual.payload - read.storage.data()) % 16 == 0, name + " payload alignment");
+    }
+
+    check(texture_compression(VK_FORMAT_BC7_UNORM_BLOCK) == TextureCompression::BC, "bc7 unorm is BC");
+    check(texture_compression(VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK) == TextureCompression::ETC2, "etc2 unorm is ETC2");
+    check(texture_compression(VK_FORMAT_R8G8B8A8_SRGB) == TextureCompression::None, "rgba8 is uncompressed");
+}
+
+// header fields as write_texture_file lays them out
+const size_t WIDTH_OFFSET = 8;
+const size_t MIP_LEVELS_OFFSET = 16;
+
+static void test_malformed_texture_files() {
+    TextureFile texture = cooked_texture(16, 16);
+    std::string path = "texture_tests_malformed.mtex";
+    write_texture_file(path, texture);
+    TextureFile read = read_texture_file(path);
+    std::remove(path.c_str());
+    std::vector<uint8_t> bytes = read.storage;
+
+    check_throws([&] { parse_texture_file(bytes.data(), 10, "short"); }, "short header");
+    check_throws([&] { parse_texture_file(bytes.data(), 40, "table"); }, "truncated variant table");
+    check_throws([&] { parse_texture_file(bytes.data(), bytes.size() - 1, "payload"); }, "truncated payload");
+
+    std::vector<uint8_t> badMagic = bytes;
+    badMagic[0] = 'X';
+    check_throws([&] { parse_texture_file(badMagic.data(), badMagic.size(), "magic"); }, "bad magic");
+
+    std::vector<uint8_t> zeroWidth = bytes;
+    memset(&zeroWidth[WIDTH_OFFSET], 0, 4);
+    check_throws([&] { parse_texture_file(zeroWidth.data(), zeroWidth.size(), "width"); }, "zero width");
+
+    for (uint32_t mipLevels : {0u, 6u}) {
+        std::vector<uint8_t> badLevels = bytes;
+        memcpy(&badLevels[MIP_LEVELS_OFFSET], &mipLevels, 4);
+        check_throws([&] { parse_texture_file(badLevels.data(), badLevels.size(), "levels"); },
+                     "mip level count " + std::to_string(mipLevels));
+    }
+}
+
+int main() {
+    test_bc1();
+    test_bc7();
+    test_etc2();
+    test_texture_file();
+    test_malformed_texture_files();
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "texture tests passed\n";
+    return EXIT_SUCCESS;
+}
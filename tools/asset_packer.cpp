@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../engine/headers/AssetArchive.h"
+
+// Packs files into a .mpak archive the engine memory maps at startup. Payloads are stored as they
+// are, cook textures with texture_cooker first so the archive holds GPU-ready data.
+
+struct PackInput {
+    std::string name;
+    std::string path;
+};
+
+static std::vector<uint8_t> read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open " + path);
+    }
+    std::streamoff size = file.tellg();
+    if (size < 0) {
+        throw std::runtime_error("failed to read " + path);
+    }
+    std::vector<uint8_t> data(static_cast<size_t>(size));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+    if (!file) {
+        throw std::runtime_error("failed to read " + path);
+    }
+    return data;
+}
+
+static void print_usage(const char* program) {
+    std::cout << "usage: " << program << " <output.mpak> <[name=]file>...\n"
+              << "\tentries are named after the file name unless a name is given\n";
+}
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h") {
+        print_usage(argv[0]);
+        return argc < 3 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    try {
+        std::string outputPath = argv[1];
+        std::vector<PackInput> inputs;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            size_t separator = arg.find('=');
+            if (separator != std::string::npos) {
+                inputs.push_back({arg.substr(0, separator), arg.substr(separator + 1)});
+            } else {
+                size_t slash = arg.find_last_of("/\\");
+                inputs.push_back({slash == std::string::npos ? arg : arg.substr(slash + 1), arg});
+            }
+        }
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            for (size_t j = i + 1; j < inputs.size(); ++j) {
+                if (inputs[i].name == inputs[j].name) {
+                    throw std::invalid_argument("duplicate entry name " + inputs[i].name);
+                }
+            }
+        }
+
+        std::vector<std::vector<uint8_t>> payloads;
+        std::vector<ArchiveEntry> entries(inputs.size());
+        std::string nameTable;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            payloads.push_back(read_file(inputs[i].path));
+            entries[i].nameOffset = nameTable.size();
+            entries[i].nameLength = inputs[i].name.size();
+            entries[i].size = payloads[i].size();
+            entries[i].hash = asset_hash(payloads[i].data(), payloads[i].size());
+            nameTable += inputs[i].name;
+        }
+
+        ArchiveHeader header = {};
+        memcpy(header.magic, ASSET_ARCHIVE_MAGIC, sizeof(header.magic));
+        header.version = ASSET_ARCHIVE_VERSION;
+        header.entryCount = entries.size();
+        header.nameTableSize = nameTable.size();
+
+        uint64_t offset = sizeof(header) + sizeof(ArchiveEntry) * entries.size() + nameTable.size();
+        for (auto& entry : entries) {
+            offset = align_up(offset, ASSET_ARCHIVE_ALIGNMENT);
+            entry.offset = offset;
+            offset += entry.size;
+        }
+
+        std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open " + outputPath + " for writing");
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()), sizeof(ArchiveEntry) * entries.size());
+        file.write(nameTable.data(), nameTable.size());
+        for (size_t i = 0; i < entries.size(); ++i) {
+            std::vector<char> padding(entries[i].offset - static_cast<uint64_t>(file.tellp()), 0);
+            file.write(padding.data(), padding.size());
+            file.write(reinterpret_cast<const char*>(payloads[i].data()), payloads[i].size());
+            std::cout << inputs[i].name << ": " << payloads[i].size() << " bytes at " << entries[i].offset << "\n";
+        }
+        if (!file) {
+            throw std::runtime_error("failed to write " + outputPath);
+        }
+        std::cout << "wrote " << outputPath << ": " << entries.size() << " entries, " << offset << " bytes\n";
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "../engine/headers/BlockCompression.h"
+#include "../engine/headers/MipChain.h"
+#include "../engine/headers/TextureFile.h"
+
+// Offline texture cooker: decodes a JPEG/PNG, builds its mip chain and writes every requested
+// GPU format into one .mtex file, most preferred format first.
+
+struct CookFormat {
+    const char* name;
+    VkFormat srgbFormat;
+    VkFormat unormFormat;
+    std::vector<uint8_t> (*encode)(const uint8_t*, uint32_t, uint32_t);
+};
+
+static std::vector<uint8_t> copy_rgba8(const uint8_t* rgba, uint32_t width, uint32_t height) {
+    return std::vector<uint8_t>(rgba, rgba + size_t(width) * height * 4);
+}
+
+const CookFormat COOK_FORMATS[] = {
+        {"bc7", VK_FORMAT_BC7_SRGB_BLOCK, VK_FORMAT_BC7_UNORM_BLOCK, encode_bc7},
+        {"etc2", VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK, VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, encode_etc2_rgb},
+        {"bc1", VK_FORMAT_BC1_RGB_SRGB_BLOCK, VK_FORMAT_BC1_RGB_UNORM_BLOCK, encode_bc1},
+        {"rgba8", VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_R8G8B8A8_UNORM, copy_rgba8},
+};
+
+static void print_usage(const char* program) {
+    std::cout << "usage: " << program << " <input.jpg|png> <output.mtex> [options]\n"
+              << "\t--formats <list>\tcomma separated, in order of preference (default bc7,etc2,bc1,rgba8)\n"
+              << "\t--linear\t\tthe image holds linear data (normal maps, masks), not sRGB colors\n";
+}
+
+static const CookFormat& find_cook_format(const std::string& name) {
+    for (const auto& format : COOK_FORMATS) {
+        if (name == format.name) return format;
+    }
+    throw std::invalid_argument("unknown format '" + name + "' (bc7, etc2, bc1 or rgba8)");
+}
+
+int main(int argc, char** argv) {
+    try {
+        std::vector<std::string> positional;
+        std::string formatList = "bc7,etc2,bc1,rgba8";
+        bool srgb = true;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--formats" && i + 1 < argc) {
+                formatList = argv[++i];
+            } else if (arg == "--linear") {
+                srgb = false;
+            } else if (arg == "--help" || arg == "-h") {
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            } else if (arg.rfind("--", 0) == 0) {
+                throw std::invalid_argument("unknown argument '" + arg + "' (see --help)");
+            } else {
+                positional.push_back(arg);
+            }
+        }
+        if (positional.size() != 2) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        std::vector<const CookFormat*> formats;
+        std::stringstream list(formatList);
+        for (std::string name; std::getline(list, name, ',');) {
+            formats.push_back(&find_cook_format(name));
+        }
+
+        int width, height, channels;
+        stbi_uc* pixels = stbi_load(positional[0].c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error("failed to load " + positional[0] + ": " + stbi_failure_reason());
+        }
+
+        TextureFile texture;
+        texture.width = width;
+        texture.height = height;
+        std::vector<ImageLevel> sourceLevels;
+        std::vector<uint8_t> chain = build_mip_chain_rgba8(pixels, width, height, srgb, sourceLevels);
+        stbi_image_free(pixels);
+        texture.mipLevels = sourceLevels.size();
+
+        VkDeviceSize uncompressedSize = chain.size();
+        for (const CookFormat* format : formats) {
+            TextureVariant variant;
+            variant.format = srgb ? format->srgbFormat : format->unormFormat;
+            variant.data.resize(texture_level_layout(variant.format, texture.width, texture.height,
+                                                     texture.mipLevels, variant.levels));
+            for (uint32_t level = 0; level < texture.mipLevels; ++level) {
+                const ImageLevel& source = sourceLevels[level];
+                std::vector<uint8_t> encoded = format->encode(chain.data() + source.offset, source.width, source.height);
+                std::copy(encoded.begin(), encoded.end(), variant.data.begin() + variant.levels[level].offset);
+            }
+            variant.payload = variant.data.data();
+            variant.size = variant.data.size();
+            std::cout << format->name << ": " << variant.data.size() / 1024 << " KiB ("
+                      << double(uncompressedSize) / variant.data.size() << "x smaller than RGBA8)\n";
+            texture.variants.push_back(std::move(variant));
+        }
+
+        write_texture_file(positional[1], texture);
+        std::cout << "wrote " << positional[1] << ": " << width << "x" << height << ", "
+                  << texture.mipLevels << " mip levels, " << texture.variants.size() << " format(s)\n";
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
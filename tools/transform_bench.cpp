@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "../engine/headers/JobSystem.h"
+#include "../engine/headers/TransformStore.h"
+
+// Times the per-frame transform update of the engine for a large scene: the per-object glm path
+// (translate * rotate from the elapsed time), the structure of arrays kernel one object at a time,
+// the SIMD kernel and the SIMD kernel split across threads. Matrices are written 80 bytes apart
+// like the instance buffer, and with --mvp also combined with a view-projection like the uniform path.
+
+// the engine's rotating objects
+struct BenchObject {
+    glm::vec3 position;
+    glm::vec3 axis;
+    // radians per second
+    float speed;
+    float phase;
+};
+
+struct BenchResult {
+    double minMs = 0.0;
+    double meanMs = 0.0;
+};
+
+const size_t INSTANCE_STRIDE = 80;
+const float FRAME_TIME = 1.0f / 60.0f;
+// SIMD and scalar kernels run the same arithmetic, only rounding and fused multiply-adds may differ
+const float MAX_KERNEL_DIFFERENCE = 1e-3f;
+
+static void print_usage(const char* program) {
+    std::cout << "usage: " << program << " [options]\n"
+              << "\t--objects <n>\t\tobjects updated per frame (default 100000)\n"
+              << "\t--frames <n>\t\tmeasured frames per variant (default 200)\n"
+              << "\t--threads <n>\t\tthreads of the threaded variant (default hardware threads)\n"
+              << "\t--mvp\t\t\talso write viewProj * model, like the uniform transform path\n";
+}
+
+static uint32_t parse_count(const std::string& arg, int& i, int argc, char** argv) {
+    if (i + 1 >= argc) {
+        throw std::invalid_argument(arg + " needs a value");
+    }
+    std::string value = argv[++i];
+    size_t end = 0;
+    unsigned long result = 0;
+    try {
+        result = std::stoul(value, &end);
+    } catch (const std::exception&) {
+        end = 0;
+    }
+    if (end != value.size() || result == 0 || result > 100000000) {
+        throw std::invalid_argument(arg + " expects a positive count, got " + value);
+    }
+    return static_cast<uint32_t>(result);
+}
+
+static BenchResult measure(uint32_t frames, const std::function<void(uint32_t)>& update) {
+    // one untimed frame to fault the output pages in
+    update(0);
+    BenchResult result = {1e30, 0.0};
+    for (uint32_t frame = 1; frame <= frames; ++frame) {
+        auto start = std::chrono::steady_clock::now();
+        update(frame);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.minMs = std::min(result.minMs, ms);
+        result.meanMs += ms / frames;
+    }
+    return result;
+}
+
+static void print_result(const char* name, const BenchResult& result, const BenchResult& baseline, uint32_t objectCount) {
+    std::cout << "  " << name << std::string(24 - std::min<size_t>(std::strlen(name), 23), ' ')
+              << result.minMs << " ms min, " << result.meanMs << " ms mean, "
+              << result.minMs * 1e6 / objectCount << " ns/object, "
+              << baseline.minMs / result.minMs << "x\n";
+}
+
+// largest difference between two sets of strided matrices
+static float max_difference(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, size_t stride, size_t count) {
+    float difference = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        const float* x = reinterpret_cast<const float*>(a.data() + i * stride);
+        const float* y = reinterpret_cast<const float*>(b.data() + i * stride);
+        for (int element = 0; element < 16; ++element) difference = std::max(difference, std::abs(x[element] - y[element]));
+    }
+    return difference;
+}
+
+int main(int argc, char** argv) {
+    uint32_t objectCount = 100000;
+    uint32_t frames = 200;
+    uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    bool mvp = false;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            } else if (arg == "--objects") {
+                objectCount = parse_count(arg, i, argc, argv);
+            } else if (arg == "--frames") {
+                frames = parse_count(arg, i, argc, argv);
+            } else if (arg == "--threads") {
+                threadCount = parse_count(arg, i, argc, argv);
+            } else if (arg == "--mvp") {
+                mvp = true;
+            } else {
+                throw std::invalid_argument("unknown option " + arg);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // same distribution as the engine's scene
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<BenchObject> objects(objectCount);
+    for (auto& object : objects) {
+        object.position = glm::vec3(unit(random), unit(random), unit(random)) * 100.0f;
+        glm::vec3 axis(unit(random), unit(random), unit(random));
+        object.axis = glm::length(axis) > 0.01f ? glm::normalize(axis) : glm::vec3(0.0f, 0.0f, 1.0f);
+        object.speed = glm::radians(45.0f + 90.0f * (unit(random) * 0.5f + 0.5f));
+        object.phase = glm::radians(180.0f * unit(random));
+    }
+
+    auto make_store = [&] {
+        TransformStore store;
+        store.resize(objectCount);
+        for (uint32_t i = 0; i < objectCount; ++i) {
+            const BenchObject& object = objects[i];
+            store.set(i, object.position, glm::angleAxis(object.phase, object.axis), glm::vec3(1.0f),
+                      object.axis * object.speed);
+        }
+        return store;
+    };
+
+    glm::mat4 viewProj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f)
+                         * glm::lookAt(glm::vec3(300.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    auto make_output = [&](std::vector<uint8_t>& models, std::vector<uint8_t>& mvps) {
+        models.assign(INSTANCE_STRIDE * objectCount, 0);
+        mvps.assign(mvp ? sizeof(glm::mat4) * objectCount : 0, 0);
+        TransformOutput output;
+        output.models = models.data();
+        output.modelStride = INSTANCE_STRIDE;
+        output.mvps = mvp ? mvps.data() : nullptr;
+        output.viewProj = viewProj;
+        return output;
+    };
+
+    std::cout << objectCount << " objects, " << frames << " frames, " << TransformStore::simd_name()
+              << " kernel (" << TransformStore::simd_width() << " wide), "
+              << (mvp ? "model + mvp" : "model") << " matrices\n";
+
+    std::vector<uint8_t> glmModels, glmMvps;
+    make_output(glmModels, glmMvps);
+    BenchResult glmResult = measure(frames, [&](uint32_t frame) {
+        float time = frame * FRAME_TIME;
+        for (uint32_t i = 0; i < objectCount; ++i) {
+            const BenchObject& object = objects[i];
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), object.position);
+            model = glm::rotate(model, object.phase + time * object.speed, object.axis);
+            std::memcpy(glmModels.data() + i * INSTANCE_STRIDE, &model, sizeof(model));
+            if (mvp) {
+                glm::mat4 combined = viewProj * model;
+                std::memcpy(glmMvps.data() + i * sizeof(glm::mat4), &combined, sizeof(combined));
+            }
+        }
+    });
+    print_result("glm per object", glmResult, glmResult, objectCount);
+
+    std::vector<uint8_t> scalarModels, scalarMvps;
+    TransformStore scalarStore = make_store();
+    TransformOutput scalarOutput = make_output(scalarModels, scalarMvps);
+    BenchResult scalarResult = measure(frames, [&](uint32_t frame) {
+        scalarStore.update_scalar(0, objectCount, frame == 0 ? 0.0f : FRAME_TIME, scalarOutput);
+    });
+    print_result("soa scalar", scalarResult, glmResult, objectCount);
+
+    std::vector<uint8_t> simdModels, simdMvps;
+    TransformStore simdStore = make_store();
+    TransformOutput simdOutput = make_output(simdModels, simdMvps);
+    BenchResult simdResult = measure(frames, [&](uint32_t frame) {
+        simdStore.update(0, objectCount, frame == 0 ? 0.0f : FRAME_TIME, simdOutput);
+    });
+    print_result("soa simd", simdResult, glmResult, objectCount);
+
+    // same chunking as the engine: a few jobs per thread, chunk sizes a multiple of the vector width
+    JobSystem jobs(threadCount);
+    uint32_t jobCount = std::min(objectCount, threadCount * 4);
+    size_t chunk = (objectCount + jobCount - 1) / jobCount;
+    chunk = (chunk + TransformStore::simd_width() - 1) / TransformStore::simd_width() * TransformStore::simd_width();
+    std::vector<uint8_t> threadedModels, threadedMvps;
+    TransformStore threadedStore = make_store();
+    TransformOutput threadedOutput = make_output(threadedModels, threadedMvps);
+    BenchResult threadedResult = measure(frames, [&](uint32_t frame) {
+        float dt = frame == 0 ? 0.0f : FRAME_TIME;
+        jobs.run(jobCount, [&](uint32_t job, uint32_t) {
+            threadedStore.update(job * chunk, (job + 1) * chunk, dt, threadedOutput);
+        });
+    });
+    std::string threadedName = "soa simd, " + std::to_string(threadCount) + " threads";
+    print_result(threadedName.c_str(), threadedResult, glmResult, objectCount);
+
+    // every variant simulated the same time span, the integrated rotations drift slightly from the closed form
+    std::cout << "max difference to glm: scalar " << max_difference(glmModels, scalarModels, INSTANCE_STRIDE, objectCount)
+              << ", simd " << max_difference(glmModels, simdModels, INSTANCE_STRIDE, objectCount)
+              << ", threaded " << max_difference(glmModels, threadedModels, INSTANCE_STRIDE, objectCount) << "\n";
+
+    float kernelDifference = std::max(max_difference(scalarModels, simdModels, INSTANCE_STRIDE, objectCount),
+                                      max_difference(scalarModels, threadedModels, INSTANCE_STRIDE, objectCount));
+    if (mvp) {
+        kernelDifference = std::max({kernelDifference,
+                                     max_difference(scalarMvps, simdMvps, sizeof(glm::mat4), objectCount),
+                                     max_difference(scalarMvps, threadedMvps, sizeof(glm::mat4), objectCount)});
+    }
+    std::cout << "max difference simd to scalar: " << kernelDifference << "\n";
+    if (kernelDifference > MAX_KERNEL_DIFFERENCE) {
+        std::cerr << "simd kernel differs from the scalar one by more than " << MAX_KERNEL_DIFFERENCE << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}